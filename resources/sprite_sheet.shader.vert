@@ -3,15 +3,22 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aUV;
 
+// Per-instance
+layout (location = 2) in vec4 aPositionScale;
+layout (location = 3) in vec4 aUVRect; // atlas rect: min.xy, max.zw
+layout (location = 4) in vec4 aTint;
+
 out vec4 vColor;
 out vec2 vUV;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// Written once per frame by the camera, shared by every program
+layout (std140) uniform Camera {
+    mat4 viewProjection;
+};
 
 void main() {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
-    vColor = vec4(1.0);
-    vUV = aUV;
+    vec3 worldPos = aPositionScale.xyz + aPos * aPositionScale.w;
+    gl_Position = viewProjection * vec4(worldPos, 1.0);
+    vColor = aTint;
+    vUV = mix(aUVRect.xy, aUVRect.zw, aUV);
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "allocator.h"
+#include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 
 void *DefaultAllocator(enum AllocOp op, usize newSize, usize oldSize, void *oldPtr, void *user)
 {
@@ -20,3 +22,200 @@ void *DefaultAllocator(enum AllocOp op, usize newSize, usize oldSize, void *oldP
 
     return NULL;
 }
+
+static usize AlignUp(usize value, usize alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+void ArenaInit(struct Arena *arena, void *base, usize size)
+{
+    arena->base = base;
+    arena->size = size;
+    arena->used = 0;
+    arena->lastOffset = 0;
+}
+
+void *ArenaPush(struct Arena *arena, usize size, usize alignment)
+{
+    usize address = (usize)arena->base + arena->used;
+    usize offset = AlignUp(address, alignment) - (usize)arena->base;
+
+    if (offset + size > arena->size)
+    {
+        return NULL;
+    }
+
+    arena->lastOffset = offset;
+    arena->used = offset + size;
+
+    return arena->base + offset;
+}
+
+void ArenaReset(struct Arena *arena)
+{
+    arena->used = 0;
+    arena->lastOffset = 0;
+}
+
+struct ArenaMarker ArenaSave(struct Arena *arena)
+{
+    return (struct ArenaMarker){arena->used, arena->lastOffset};
+}
+
+void ArenaRestore(struct Arena *arena, struct ArenaMarker marker)
+{
+    assert(marker.used <= arena->used);
+    arena->used = marker.used;
+    arena->lastOffset = marker.lastOffset;
+}
+
+void *ArenaAllocator(enum AllocOp op, usize newSize, usize oldSize, void *oldPtr, void *user)
+{
+    struct Arena *arena = user;
+    assert(arena);
+
+    bool isLast = oldPtr == arena->base + arena->lastOffset;
+
+    switch (op)
+    {
+    case AllocOp_Alloc:
+        return ArenaPush(arena, newSize, ARENA_DEFAULT_ALIGNMENT);
+    case AllocOp_Free:
+        // Only the most recent allocation can be given back
+        if (oldPtr && isLast)
+        {
+            arena->used = arena->lastOffset;
+        }
+        return NULL;
+    case AllocOp_Realloc:
+        if (!oldPtr)
+        {
+            return ArenaPush(arena, newSize, ARENA_DEFAULT_ALIGNMENT);
+        }
+        if (isLast && arena->lastOffset + newSize <= arena->size)
+        {
+            arena->used = arena->lastOffset + newSize;
+            return oldPtr;
+        }
+        else
+        {
+            void *newPtr = ArenaPush(arena, newSize, ARENA_DEFAULT_ALIGNMENT);
+            if (newPtr)
+            {
+                memcpy(newPtr, oldPtr, oldSize < newSize ? oldSize : newSize);
+            }
+            return newPtr;
+        }
+    case AllocOp_ZeroAlloc:
+    {
+        void *ptr = ArenaPush(arena, newSize, ARENA_DEFAULT_ALIGNMENT);
+        if (ptr)
+        {
+            memset(ptr, 0, newSize);
+        }
+        return ptr;
+    }
+    }
+
+    return NULL;
+}
+
+void FrameArenaInit(struct FrameArena *frame, void *base, usize size)
+{
+    usize half = size / 2;
+    ArenaInit(&frame->arenas[0], base, half);
+    ArenaInit(&frame->arenas[1], (u8 *)base + half, half);
+    frame->current = 0;
+}
+
+struct Arena *FrameArenaBegin(struct FrameArena *frame)
+{
+    frame->current ^= 1;
+    struct Arena *arena = &frame->arenas[frame->current];
+    ArenaReset(arena);
+    return arena;
+}
+
+struct Arena *FrameArenaCurrent(struct FrameArena *frame)
+{
+    return &frame->arenas[frame->current];
+}
+
+struct Arena *FrameArenaPrevious(struct FrameArena *frame)
+{
+    return &frame->arenas[frame->current ^ 1];
+}
+
+static usize PoolBlockSize(usize blockSize)
+{
+    if (blockSize < sizeof(void *))
+    {
+        blockSize = sizeof(void *);
+    }
+    return AlignUp(blockSize, ARENA_DEFAULT_ALIGNMENT);
+}
+
+usize PoolRequiredSize(usize blockSize, u32 blockCount)
+{
+    return PoolBlockSize(blockSize) * blockCount;
+}
+
+void PoolInit(struct Pool *pool, void *base, usize blockSize, u32 blockCount)
+{
+    pool->base = base;
+    pool->blockSize = PoolBlockSize(blockSize);
+    pool->blockCount = blockCount;
+    pool->freeList = NULL;
+
+    // Thread the free list through the blocks, lowest address first
+    for (u32 i = blockCount; i > 0; --i)
+    {
+        void **block = (void **)(pool->base + (i - 1) * pool->blockSize);
+        *block = pool->freeList;
+        pool->freeList = block;
+    }
+}
+
+void *PoolAllocator(enum AllocOp op, usize newSize, usize oldSize, void *oldPtr, void *user)
+{
+    UNUSED(oldSize);
+
+    struct Pool *pool = user;
+    assert(pool);
+
+    switch (op)
+    {
+    case AllocOp_Alloc:
+    case AllocOp_ZeroAlloc:
+    {
+        if (newSize > pool->blockSize || !pool->freeList)
+        {
+            return NULL;
+        }
+        void **block = pool->freeList;
+        pool->freeList = *block;
+        if (op == AllocOp_ZeroAlloc)
+        {
+            memset(block, 0, pool->blockSize);
+        }
+        return block;
+    }
+    case AllocOp_Free:
+        if (oldPtr)
+        {
+            assert((u8 *)oldPtr >= pool->base && (u8 *)oldPtr < pool->base + pool->blockSize * pool->blockCount);
+            *(void **)oldPtr = pool->freeList;
+            pool->freeList = oldPtr;
+        }
+        return NULL;
+    case AllocOp_Realloc:
+        if (!oldPtr)
+        {
+            return PoolAllocator(AllocOp_Alloc, newSize, 0, NULL, user);
+        }
+        return newSize <= pool->blockSize ? oldPtr : NULL;
+    }
+
+    return NULL;
+}
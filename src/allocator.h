@@ -13,17 +13,80 @@ enum AllocOp
 
 typedef void *(Allocator)(enum AllocOp operation, usize newSize, usize oldSize, void *oldPtr, void *user);
 
-#define MemAlloc(allocator, size) ((allocator)(AllocOp_Alloc, (size), 0, 0, 0))
-#define MemFree(allocator, ptr) ((allocator)(AllocOp_Free, 0, 0, (ptr), 0))
-#define MemRealloc(allocator, size, oldSize, oldPtr) ((allocator)(AllocOp_Realloc, (size), (oldSize), (oldPtr), 0))
-#define MemZeroAlloc(allocator, size) ((allocator)(AllocOp_ZeroAlloc, (size), 0, 0, 0))
+// With FEJNANDO_MEMORY_CALL_SITES every Mem* call first notes where it is,
+// for the tracking allocator's leak report
+#ifdef FEJNANDO_MEMORY_CALL_SITES
+void MemorySetCallSite(const char *file, u32 line);
+#define MEM_CALL_SITE() MemorySetCallSite(__FILE__, __LINE__),
+#else
+#define MEM_CALL_SITE()
+#endif
 
-#define MemAllocUser(allocator, size, user) ((allocator)(AllocOp_Alloc, (size), 0, 0, (user)))
-#define MemFreeUser(allocator, ptr, user) ((allocator)(AllocOp_Free, 0, 0, (ptr), (user)))
-#define MemReallocUser(allocator, size, oldSize, oldPtr, user) ((allocator)(AllocOp_Realloc, (size), (oldSize), (oldPtr), (user)))
-#define MemZeroAllocUser(allocator, size, user) ((allocator)(AllocOp_ZeroAlloc, (size), 0, 0, (user)))
+#define MemAlloc(allocator, size) (MEM_CALL_SITE() (allocator)(AllocOp_Alloc, (size), 0, 0, 0))
+#define MemFree(allocator, ptr) (MEM_CALL_SITE() (allocator)(AllocOp_Free, 0, 0, (ptr), 0))
+#define MemRealloc(allocator, size, oldSize, oldPtr) (MEM_CALL_SITE() (allocator)(AllocOp_Realloc, (size), (oldSize), (oldPtr), 0))
+#define MemZeroAlloc(allocator, size) (MEM_CALL_SITE() (allocator)(AllocOp_ZeroAlloc, (size), 0, 0, 0))
+
+#define MemAllocUser(allocator, size, user) (MEM_CALL_SITE() (allocator)(AllocOp_Alloc, (size), 0, 0, (user)))
+#define MemFreeUser(allocator, ptr, user) (MEM_CALL_SITE() (allocator)(AllocOp_Free, 0, 0, (ptr), (user)))
+#define MemReallocUser(allocator, size, oldSize, oldPtr, user) (MEM_CALL_SITE() (allocator)(AllocOp_Realloc, (size), (oldSize), (oldPtr), (user)))
+#define MemZeroAllocUser(allocator, size, user) (MEM_CALL_SITE() (allocator)(AllocOp_ZeroAlloc, (size), 0, 0, (user)))
+
+#define ARENA_DEFAULT_ALIGNMENT 16
+
+// Linear allocator over a caller-provided block. Passed as `user` to ArenaAllocator.
+struct Arena
+{
+    u8 *base;
+    usize size;
+    usize used;
+    usize lastOffset; // start of the most recent allocation, so it can be grown or popped in place
+};
+
+struct ArenaMarker
+{
+    usize used;
+    usize lastOffset;
+};
+
+// Two arenas used on alternate frames, so data produced during the previous
+// frame stays valid while the current one is being built.
+struct FrameArena
+{
+    struct Arena arenas[2];
+    u32 current;
+};
+
+// Fixed-size block allocator. Passed as `user` to PoolAllocator.
+struct Pool
+{
+    u8 *base;
+    usize blockSize;
+    u32 blockCount;
+    void *freeList;
+};
+
+void ArenaInit(struct Arena *arena, void *base, usize size);
+void *ArenaPush(struct Arena *arena, usize size, usize alignment);
+void ArenaReset(struct Arena *arena);
+struct ArenaMarker ArenaSave(struct Arena *arena);
+void ArenaRestore(struct Arena *arena, struct ArenaMarker marker);
+
+#define ArenaPushStruct(arena, type) ((type *)ArenaPush((arena), sizeof(type), ARENA_DEFAULT_ALIGNMENT))
+#define ArenaPushArray(arena, type, count) ((type *)ArenaPush((arena), sizeof(type) * (count), ARENA_DEFAULT_ALIGNMENT))
+
+// Splits `size` bytes at `base` into the two frame halves.
+void FrameArenaInit(struct FrameArena *frame, void *base, usize size);
+// Flips to the other half and resets it. Call once at the start of every frame.
+struct Arena *FrameArenaBegin(struct FrameArena *frame);
+struct Arena *FrameArenaCurrent(struct FrameArena *frame);
+struct Arena *FrameArenaPrevious(struct FrameArena *frame);
+
+void PoolInit(struct Pool *pool, void *base, usize blockSize, u32 blockCount);
+usize PoolRequiredSize(usize blockSize, u32 blockCount);
 
 Allocator DefaultAllocator;
 Allocator ArenaAllocator;
+Allocator PoolAllocator;
 
 #endif /* ifndef MEMORY_H */
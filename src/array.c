@@ -0,0 +1,20 @@
+#include "array.h"
+
+void *ArrayGrow(void *items, u32 *capacity, u32 minCapacity, usize itemSize, Allocator *alloc, void *user)
+{
+    u32 newCapacity = *capacity < ARRAY_MIN_CAPACITY ? ARRAY_MIN_CAPACITY : *capacity;
+    while (newCapacity < minCapacity)
+    {
+        // Saturate rather than wrap; the allocation below fails long before
+        newCapacity = newCapacity > UINT32_MAX / 2 ? UINT32_MAX : newCapacity * 2;
+    }
+
+    void *newItems = MemReallocUser(alloc, newCapacity * itemSize, *capacity * itemSize, items, user);
+    if (!newItems)
+    {
+        return items;
+    }
+
+    *capacity = newCapacity;
+    return newItems;
+}
@@ -0,0 +1,67 @@
+#ifndef ARRAY_H
+#define ARRAY_H
+
+// Growable arrays of any type, backed by an Allocator. Declare one with
+// ARRAY_OF and use it through the macros:
+//
+//   ARRAY_OF(struct SpriteInstance) sprites;
+//   ArrayInit(&sprites, alloc, user);
+//   ArrayPush(&sprites, instance);
+//   for (u32 i = 0; i < sprites.count; ++i) ... sprites.items[i] ...
+//   ArrayFree(&sprites);
+//
+// Capacity doubles when it runs out, so a push is amortized constant time
+// and a filled array wastes at most half its memory. Pointers into `items`
+// are invalidated by anything that can grow it; reserve up front when the
+// final size is known. Macros that can grow return false when the
+// allocator fails, leaving the array as it was.
+
+#include "common.h"
+#include "allocator.h"
+
+#define ARRAY_MIN_CAPACITY 8
+
+#define ARRAY_OF(type)       \
+    struct                   \
+    {                        \
+        type *items;         \
+        u32 count;           \
+        u32 capacity;        \
+        Allocator *alloc;    \
+        void *user;          \
+    }
+
+// Reallocates `items` to hold at least `minCapacity` items of `itemSize`.
+// Returns the new items, or `items` unchanged with `*capacity` untouched
+// when the allocation fails.
+void *ArrayGrow(void *items, u32 *capacity, u32 minCapacity, usize itemSize, Allocator *alloc, void *user);
+
+#define ArrayInit(array, allocator, userData) \
+    ((array)->items = NULL, (array)->count = 0, (array)->capacity = 0, \
+     (array)->alloc = (allocator), (array)->user = (userData))
+
+#define ArrayFree(array) \
+    (MemFreeUser((array)->alloc, (array)->items, (array)->user), \
+     (array)->items = NULL, (array)->count = 0, (array)->capacity = 0)
+
+#define ArrayReserve(array, n) \
+    ((u32)(n) <= (array)->capacity || \
+     ((array)->items = ArrayGrow((array)->items, &(array)->capacity, (u32)(n), sizeof(*(array)->items), \
+                                 (array)->alloc, (array)->user), \
+      (u32)(n) <= (array)->capacity))
+
+#define ArrayPush(array, value) \
+    (ArrayReserve((array), (array)->count + 1) && ((array)->items[(array)->count++] = (value), true))
+
+// Appends `n` uninitialized items and returns the first, or NULL
+#define ArrayAddN(array, n) \
+    (ArrayReserve((array), (array)->count + (n)) ? ((array)->count += (n), &(array)->items[(array)->count - (n)]) : NULL)
+
+#define ArrayPop(array) ((array)->items[--(array)->count])
+#define ArrayLast(array) ((array)->items[(array)->count - 1])
+#define ArrayClear(array) ((array)->count = 0)
+
+// O(1); moves the last item into the hole, so order is not kept
+#define ArrayRemoveSwap(array, index) ((array)->items[(index)] = (array)->items[--(array)->count])
+
+#endif // ARRAY_H
@@ -0,0 +1,98 @@
+#include "asset_pack.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool AssetPackOpen(struct AssetPack *pack, const char *path)
+{
+    memset(pack, 0, sizeof(*pack));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Could not open asset pack %s.\n", path);
+        return false;
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || (usize)fileStat.st_size < sizeof(struct AssetPackHeader))
+    {
+        fprintf(stderr, "Asset pack %s is truncated.\n", path);
+        close(fd);
+        return false;
+    }
+
+    usize size = (usize)fileStat.st_size;
+    void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED)
+    {
+        fprintf(stderr, "Could not map asset pack %s.\n", path);
+        return false;
+    }
+
+    const struct AssetPackHeader *header = data;
+    if (header->magic != ASSET_PACK_MAGIC ||
+        header->version != ASSET_PACK_VERSION ||
+        header->fileSize != size ||
+        header->tocOffset + (u64)header->entryCount * sizeof(struct AssetPackEntry) > size)
+    {
+        fprintf(stderr, "Asset pack %s is invalid or out of date.\n", path);
+        munmap(data, size);
+        return false;
+    }
+
+    pack->data = data;
+    pack->size = size;
+    pack->entries = (const struct AssetPackEntry *)(pack->data + header->tocOffset);
+    pack->entryCount = header->entryCount;
+
+    return true;
+}
+
+void AssetPackClose(struct AssetPack *pack)
+{
+    if (pack->data)
+    {
+        munmap((void *)pack->data, pack->size);
+    }
+    memset(pack, 0, sizeof(*pack));
+}
+
+const struct AssetPackEntry *AssetPackFind(const struct AssetPack *pack, const char *name)
+{
+    // The packer sorts the table of contents by name
+    u32 low = 0;
+    u32 high = pack->entryCount;
+    while (low < high)
+    {
+        u32 mid = low + (high - low) / 2;
+        int cmp = strncmp(name, pack->entries[mid].name, ASSET_NAME_LENGTH);
+        if (cmp == 0)
+        {
+            return &pack->entries[mid];
+        }
+        if (cmp < 0)
+        {
+            high = mid;
+        }
+        else
+        {
+            low = mid + 1;
+        }
+    }
+
+    return NULL;
+}
+
+const void *AssetPackData(const struct AssetPack *pack, const struct AssetPackEntry *entry)
+{
+    if (entry->offset + entry->size > pack->size)
+    {
+        return NULL;
+    }
+    return pack->data + entry->offset;
+}
@@ -0,0 +1,75 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+// Binary asset pack baked offline by assetpack (asset_packer.c) and mapped
+// read-only at runtime. Layout:
+//
+//   AssetPackHeader
+//   payloads, each starting on an ASSET_PACK_ALIGNMENT boundary
+//   AssetPackEntry[entryCount], sorted by name
+//
+// Texture payloads are raw RGBA8, already flipped for GL, with the full mip
+// chain stored level after level. Shader payloads are NUL-terminated source.
+
+#include "common.h"
+
+#define ASSET_PACK_MAGIC 0x4B504A46u // "FJPK"
+#define ASSET_PACK_VERSION 1
+#define ASSET_PACK_ALIGNMENT 64
+#define ASSET_NAME_LENGTH 48
+
+enum AssetType
+{
+    AssetType_Blob = 0,
+    AssetType_Texture = 1,
+    AssetType_Shader = 2,
+};
+
+struct AssetPackHeader
+{
+    u32 magic;
+    u32 version;
+    u32 entryCount;
+    u32 reserved;
+    u64 tocOffset;
+    u64 fileSize;
+};
+
+struct AssetPackEntry
+{
+    char name[ASSET_NAME_LENGTH];
+    u32 type;
+    u32 reserved;
+    u64 offset;
+    u64 size;
+
+    // AssetType_Texture only
+    u32 width;
+    u32 height;
+    u32 mipCount;
+    u32 reserved2;
+};
+
+struct AssetPack
+{
+    const u8 *data;
+    usize size;
+    const struct AssetPackEntry *entries;
+    u32 entryCount;
+};
+
+bool AssetPackOpen(struct AssetPack *pack, const char *path);
+void AssetPackClose(struct AssetPack *pack);
+
+const struct AssetPackEntry *AssetPackFind(const struct AssetPack *pack, const char *name);
+const void *AssetPackData(const struct AssetPack *pack, const struct AssetPackEntry *entry);
+
+// Byte size of one level of an RGBA8 mip chain
+static inline usize AssetTextureMipSize(u32 width, u32 height, u32 level)
+{
+    u32 w = width >> level;
+    u32 h = height >> level;
+    return (usize)(w ? w : 1) * (h ? h : 1) * 4;
+}
+
+#endif // ASSET_PACK_H
@@ -0,0 +1,290 @@
+// Offline asset packer. Bakes textures, shaders and any other files into one
+// pack that the game maps at startup (see asset_pack.h).
+//
+// usage: assetpack <output.pack> [--max-mips N] <input>...
+//
+// Textures get their full mip chain down to 1x1, or only the first N
+// levels for the textures after a --max-mips; atlas pages need that, since
+// past a point every texel mixes neighboring sprites (see atlas_packer.c).
+
+#include <stdlib.h>
+#include <string.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include "common.h"
+#include "allocator.h"
+#include "asset_pack.h"
+
+struct PendingAsset
+{
+    struct AssetPackEntry entry;
+    u8 *payload;
+};
+
+static bool HasSuffix(const char *string, const char *suffix)
+{
+    usize length = strlen(string);
+    usize suffixLength = strlen(suffix);
+    return length >= suffixLength && strcmp(string + length - suffixLength, suffix) == 0;
+}
+
+static const char *BaseName(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    const char *backslash = strrchr(path, '\\');
+    if (backslash > slash)
+    {
+        slash = backslash;
+    }
+    return slash ? slash + 1 : path;
+}
+
+static u8 *ReadEntireFile(const char *path, usize *size, usize padding)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    u8 *data = length >= 0 ? MemZeroAlloc(DefaultAllocator, (usize)length + padding) : NULL;
+    if (data && fread(data, 1, (usize)length, file) != (usize)length)
+    {
+        MemFree(DefaultAllocator, data);
+        data = NULL;
+    }
+    fclose(file);
+
+    *size = (usize)length;
+    return data;
+}
+
+// 2x2 box filter from one RGBA8 level into the next, clamping at odd edges
+static void Downsample(const u8 *src, u32 srcWidth, u32 srcHeight, u8 *dst, u32 dstWidth, u32 dstHeight)
+{
+    for (u32 y = 0; y < dstHeight; ++y)
+    {
+        u32 y0 = y * 2 < srcHeight ? y * 2 : srcHeight - 1;
+        u32 y1 = y * 2 + 1 < srcHeight ? y * 2 + 1 : srcHeight - 1;
+        for (u32 x = 0; x < dstWidth; ++x)
+        {
+            u32 x0 = x * 2 < srcWidth ? x * 2 : srcWidth - 1;
+            u32 x1 = x * 2 + 1 < srcWidth ? x * 2 + 1 : srcWidth - 1;
+            for (u32 c = 0; c < 4; ++c)
+            {
+                u32 sum = src[(y0 * srcWidth + x0) * 4 + c] +
+                          src[(y0 * srcWidth + x1) * 4 + c] +
+                          src[(y1 * srcWidth + x0) * 4 + c] +
+                          src[(y1 * srcWidth + x1) * 4 + c];
+                dst[(y * dstWidth + x) * 4 + c] = (u8)((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+// `maxMips` 0 keeps the full chain
+static bool BakeTexture(const char *path, u32 maxMips, struct PendingAsset *asset)
+{
+    s32 width;
+    s32 height;
+    s32 channels;
+    stbi_set_flip_vertically_on_load(true);
+    u8 *pixels = stbi_load(path, &width, &height, &channels, 4);
+    if (!pixels)
+    {
+        fprintf(stderr, "Could not load image %s: %s\n", path, stbi_failure_reason());
+        return false;
+    }
+
+    u32 mipCount = 1;
+    while ((((u32)width >> mipCount) | ((u32)height >> mipCount)) != 0 && (maxMips == 0 || mipCount < maxMips))
+    {
+        ++mipCount;
+    }
+
+    usize totalSize = 0;
+    for (u32 level = 0; level < mipCount; ++level)
+    {
+        totalSize += AssetTextureMipSize(width, height, level);
+    }
+
+    u8 *payload = MemAlloc(DefaultAllocator, totalSize);
+    memcpy(payload, pixels, AssetTextureMipSize(width, height, 0));
+    stbi_image_free(pixels);
+
+    u8 *level = payload;
+    for (u32 i = 1; i < mipCount; ++i)
+    {
+        u32 srcWidth = (u32)width >> (i - 1);
+        u32 srcHeight = (u32)height >> (i - 1);
+        u32 dstWidth = (u32)width >> i;
+        u32 dstHeight = (u32)height >> i;
+        u8 *next = level + AssetTextureMipSize(width, height, i - 1);
+        Downsample(level, srcWidth ? srcWidth : 1, srcHeight ? srcHeight : 1, next, dstWidth ? dstWidth : 1, dstHeight ? dstHeight : 1);
+        level = next;
+    }
+
+    asset->entry.type = AssetType_Texture;
+    asset->entry.size = totalSize;
+    asset->entry.width = (u32)width;
+    asset->entry.height = (u32)height;
+    asset->entry.mipCount = mipCount;
+    asset->payload = payload;
+    return true;
+}
+
+static bool BakeFile(const char *path, struct PendingAsset *asset, enum AssetType type)
+{
+    // Shaders keep a terminating NUL so they can be handed to GL as is
+    usize padding = type == AssetType_Shader ? 1 : 0;
+    usize size;
+    u8 *data = ReadEntireFile(path, &size, padding);
+    if (!data)
+    {
+        fprintf(stderr, "Could not read %s.\n", path);
+        return false;
+    }
+
+    asset->entry.type = type;
+    asset->entry.size = size + padding;
+    asset->payload = data;
+    return true;
+}
+
+static int CompareAssets(const void *a, const void *b)
+{
+    const struct PendingAsset *assetA = a;
+    const struct PendingAsset *assetB = b;
+    return strncmp(assetA->entry.name, assetB->entry.name, ASSET_NAME_LENGTH);
+}
+
+static bool WritePadding(FILE *file, u64 *offset)
+{
+    static const u8 zeros[ASSET_PACK_ALIGNMENT];
+    u64 aligned = (*offset + ASSET_PACK_ALIGNMENT - 1) & ~(u64)(ASSET_PACK_ALIGNMENT - 1);
+    usize padding = (usize)(aligned - *offset);
+    *offset = aligned;
+    return fwrite(zeros, 1, padding, file) == padding;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "usage: %s <output.pack> [--max-mips N] <input>...\n", argv[0]);
+        return 1;
+    }
+
+    const char *outputPath = argv[1];
+    u32 assetCount = 0;
+    u32 maxMips = 0;
+    struct PendingAsset *assets = MemZeroAlloc(DefaultAllocator, (usize)(argc - 2) * sizeof(*assets));
+
+    for (s32 i = 2; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--max-mips") == 0 && i + 1 < argc)
+        {
+            maxMips = (u32)strtoul(argv[++i], NULL, 10);
+            continue;
+        }
+
+        const char *path = argv[i];
+        const char *name = BaseName(path);
+        struct PendingAsset *asset = &assets[assetCount++];
+
+        if (strlen(name) >= ASSET_NAME_LENGTH)
+        {
+            fprintf(stderr, "Asset name %s is longer than %d characters.\n", name, ASSET_NAME_LENGTH - 1);
+            return 1;
+        }
+        strncpy(asset->entry.name, name, ASSET_NAME_LENGTH - 1);
+
+        bool ok;
+        if (HasSuffix(name, ".png") || HasSuffix(name, ".jpg") || HasSuffix(name, ".tga"))
+        {
+            ok = BakeTexture(path, maxMips, asset);
+        }
+        else if (HasSuffix(name, ".vert") || HasSuffix(name, ".frag") || HasSuffix(name, ".glsl"))
+        {
+            ok = BakeFile(path, asset, AssetType_Shader);
+        }
+        else
+        {
+            ok = BakeFile(path, asset, AssetType_Blob);
+        }
+
+        if (!ok)
+        {
+            return 1;
+        }
+    }
+
+    qsort(assets, assetCount, sizeof(*assets), CompareAssets);
+    for (u32 i = 1; i < assetCount; ++i)
+    {
+        if (CompareAssets(&assets[i - 1], &assets[i]) == 0)
+        {
+            fprintf(stderr, "Duplicate asset name %s.\n", assets[i].entry.name);
+            return 1;
+        }
+    }
+
+    FILE *file = fopen(outputPath, "wb");
+    if (!file)
+    {
+        fprintf(stderr, "Could not open %s for writing.\n", outputPath);
+        return 1;
+    }
+
+    struct AssetPackHeader header = {
+        .magic = ASSET_PACK_MAGIC,
+        .version = ASSET_PACK_VERSION,
+        .entryCount = assetCount,
+    };
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    u64 offset = sizeof(header);
+
+    for (u32 i = 0; ok && i < assetCount; ++i)
+    {
+        ok = WritePadding(file, &offset);
+        assets[i].entry.offset = offset;
+        ok = ok && fwrite(assets[i].payload, 1, assets[i].entry.size, file) == assets[i].entry.size;
+        offset += assets[i].entry.size;
+    }
+
+    ok = ok && WritePadding(file, &offset);
+    header.tocOffset = offset;
+    for (u32 i = 0; ok && i < assetCount; ++i)
+    {
+        ok = fwrite(&assets[i].entry, sizeof(assets[i].entry), 1, file) == 1;
+        offset += sizeof(assets[i].entry);
+    }
+    header.fileSize = offset;
+
+    ok = ok && fseek(file, 0, SEEK_SET) == 0;
+    ok = ok && fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = (fclose(file) == 0) && ok;
+
+    if (!ok)
+    {
+        fprintf(stderr, "Could not write %s.\n", outputPath);
+        remove(outputPath);
+        return 1;
+    }
+
+    for (u32 i = 0; i < assetCount; ++i)
+    {
+        MemFree(DefaultAllocator, assets[i].payload);
+    }
+    MemFree(DefaultAllocator, assets);
+
+    printf("Packed %u assets into %s (%llu bytes).\n", assetCount, outputPath, (unsigned long long)offset);
+    return 0;
+}
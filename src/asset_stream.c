@@ -0,0 +1,388 @@
+#include "asset_stream.h"
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <glad/gl.h>
+
+#include "gl_state.h"
+#include "profiler.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+static void PrefaultPages(const u8 *data, usize size)
+{
+    usize pageSize = (usize)sysconf(_SC_PAGESIZE);
+    usize start = (usize)data & ~(pageSize - 1);
+    madvise((void *)start, size + ((usize)data - start), MADV_WILLNEED);
+
+    // Touch every page so the GL thread never blocks on disk while uploading
+    volatile u8 sink = 0;
+    for (usize offset = 0; offset < size; offset += pageSize)
+    {
+        sink ^= data[offset];
+    }
+    UNUSED(sink);
+}
+
+// Worker side: get the pixels into memory
+static void LoadTexture(struct AssetStream *stream, struct StreamedTexture *texture)
+{
+    const struct AssetPackEntry *entry = AssetPackFind(stream->pack, texture->name);
+    if (entry)
+    {
+        const u8 *pixels = AssetPackData(stream->pack, entry);
+        if (entry->type != AssetType_Texture || !pixels)
+        {
+            texture->loadFailed = true;
+            return;
+        }
+
+        PrefaultPages(pixels, entry->size);
+        texture->pixels = pixels;
+        texture->ownsPixels = false;
+        texture->width = entry->width;
+        texture->height = entry->height;
+        texture->mipCount = entry->mipCount;
+        return;
+    }
+
+    s32 width;
+    s32 height;
+    s32 channels;
+    stbi_set_flip_vertically_on_load_thread(true);
+    u8 *pixels = stbi_load(texture->name, &width, &height, &channels, 4);
+    if (!pixels)
+    {
+        texture->loadFailed = true;
+        return;
+    }
+
+    texture->pixels = pixels;
+    texture->ownsPixels = true;
+    texture->width = (u32)width;
+    texture->height = (u32)height;
+    texture->mipCount = 1;
+}
+
+static void *WorkerMain(void *user)
+{
+    struct AssetStream *stream = user;
+    PROFILE_THREAD_NAME("Asset stream");
+
+    for (;;)
+    {
+        pthread_mutex_lock(&stream->requestMutex);
+        while (stream->requestHead == stream->requestTail && !stream->quit)
+        {
+            pthread_cond_wait(&stream->requestAvailable, &stream->requestMutex);
+        }
+        if (stream->quit)
+        {
+            pthread_mutex_unlock(&stream->requestMutex);
+            break;
+        }
+        u32 handle = stream->requests[stream->requestHead++ % ASSET_STREAM_MAX_TEXTURES];
+        pthread_mutex_unlock(&stream->requestMutex);
+
+        struct StreamedTexture *texture = &stream->textures[handle];
+        PROFILE_BEGIN("LoadTexture");
+        LoadTexture(stream, texture);
+        PROFILE_END();
+
+        // Publish; the release pairs with the exchange in AssetStreamUpdate
+        struct StreamedTexture *head = atomic_load_explicit(&stream->completed, memory_order_relaxed);
+        do
+        {
+            texture->next = head;
+        } while (!atomic_compare_exchange_weak_explicit(&stream->completed, &head, texture,
+                                                        memory_order_release, memory_order_relaxed));
+    }
+
+    return NULL;
+}
+
+bool AssetStreamInit(struct AssetStream *stream, const struct AssetPack *pack, u32 workerCount, bool usePixelBuffers)
+{
+    memset(stream, 0, sizeof(*stream));
+    stream->pack = pack;
+    stream->usePixelBuffers = usePixelBuffers;
+    atomic_init(&stream->completed, NULL);
+
+    pthread_mutex_init(&stream->requestMutex, NULL);
+    pthread_cond_init(&stream->requestAvailable, NULL);
+
+    // Plain white, so tinted sprites still read as something while loading
+    static const u8 white[4] = {0xff, 0xff, 0xff, 0xff};
+    glGenTextures(1, &stream->placeholderTexture);
+    GLStateBindTexture(stream->placeholderTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+
+    if (usePixelBuffers)
+    {
+        glGenBuffers(1, &stream->pixelBuffer);
+    }
+
+    if (workerCount > ASSET_STREAM_MAX_WORKERS)
+    {
+        workerCount = ASSET_STREAM_MAX_WORKERS;
+    }
+
+    for (u32 i = 0; i < workerCount; ++i)
+    {
+        if (pthread_create(&stream->workers[i], NULL, WorkerMain, stream) != 0)
+        {
+            break;
+        }
+        ++stream->workerCount;
+    }
+
+    return stream->workerCount > 0;
+}
+
+void AssetStreamShutdown(struct AssetStream *stream)
+{
+    pthread_mutex_lock(&stream->requestMutex);
+    stream->quit = true;
+    pthread_cond_broadcast(&stream->requestAvailable);
+    pthread_mutex_unlock(&stream->requestMutex);
+
+    for (u32 i = 0; i < stream->workerCount; ++i)
+    {
+        pthread_join(stream->workers[i], NULL);
+    }
+
+    // Anything still in flight has finished loading by now
+    AssetStreamUpdate(stream, 0);
+
+    for (u32 i = 0; i < stream->textureCount; ++i)
+    {
+        struct StreamedTexture *texture = &stream->textures[i];
+        if (texture->ownsPixels)
+        {
+            stbi_image_free((void *)texture->pixels);
+        }
+        if (texture->texture)
+        {
+            glDeleteTextures(1, &texture->texture);
+        }
+    }
+
+    glDeleteTextures(1, &stream->placeholderTexture);
+    if (stream->pixelBuffer)
+    {
+        glDeleteBuffers(1, &stream->pixelBuffer);
+    }
+
+    pthread_mutex_destroy(&stream->requestMutex);
+    pthread_cond_destroy(&stream->requestAvailable);
+}
+
+u32 AssetStreamRequestTexture(struct AssetStream *stream, const char *name)
+{
+    if (stream->textureCount == ASSET_STREAM_MAX_TEXTURES || strlen(name) >= sizeof(stream->textures[0].name))
+    {
+        return ASSET_STREAM_INVALID_HANDLE;
+    }
+
+    u32 handle = stream->textureCount++;
+    struct StreamedTexture *texture = &stream->textures[handle];
+    memcpy(texture->name, name, strlen(name) + 1);
+    texture->state = StreamState_Queued;
+
+    pthread_mutex_lock(&stream->requestMutex);
+    stream->requests[stream->requestTail++ % ASSET_STREAM_MAX_TEXTURES] = handle;
+    pthread_cond_signal(&stream->requestAvailable);
+    pthread_mutex_unlock(&stream->requestMutex);
+
+    return handle;
+}
+
+static void CreateTextureStorage(struct StreamedTexture *texture)
+{
+    glGenTextures(1, &texture->texture);
+    GLStateBindTexture(texture->texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    // Minified sprites and tiles sample the mip chain rather than alias;
+    // loose files get theirs generated once uploaded, and until then the
+    // single level is a complete texture on its own
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, texture->mipCount - 1);
+
+    for (u32 level = 0; level < texture->mipCount; ++level)
+    {
+        s32 width = (s32)(texture->width >> level);
+        s32 height = (s32)(texture->height >> level);
+        glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, width ? width : 1, height ? height : 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    }
+}
+
+static void UploadRows(struct AssetStream *stream, u32 level, u32 row, u32 width, u32 rows, const u8 *pixels)
+{
+    usize size = (usize)width * rows * 4;
+
+    if (stream->usePixelBuffers)
+    {
+        // Orphaned each time so the copy never waits on a transfer in flight
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, stream->pixelBuffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+        void *mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (mapped)
+        {
+            memcpy(mapped, pixels, size);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            glTexSubImage2D(GL_TEXTURE_2D, level, 0, row, width, rows, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            return;
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    glTexSubImage2D(GL_TEXTURE_2D, level, 0, row, width, rows, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+}
+
+// Uploads whole rows of the current mip level until the budget is spent.
+// Returns the number of bytes uploaded.
+static usize UploadSome(struct AssetStream *stream, struct StreamedTexture *texture, usize budget)
+{
+    if (texture->state == StreamState_Loaded)
+    {
+        CreateTextureStorage(texture);
+        texture->state = StreamState_Uploading;
+    }
+
+    GLStateBindTexture(texture->texture);
+
+    usize uploaded = 0;
+    while (texture->uploadLevel < texture->mipCount && uploaded < budget)
+    {
+        u32 level = texture->uploadLevel;
+        u32 width = texture->width >> level;
+        u32 height = texture->height >> level;
+        width = width ? width : 1;
+        height = height ? height : 1;
+
+        usize levelOffset = 0;
+        for (u32 i = 0; i < level; ++i)
+        {
+            levelOffset += AssetTextureMipSize(texture->width, texture->height, i);
+        }
+
+        usize rowSize = (usize)width * 4;
+        u32 rows = (u32)((budget - uploaded) / rowSize);
+        if (rows == 0)
+        {
+            rows = 1;
+        }
+        if (rows > height - texture->uploadRow)
+        {
+            rows = height - texture->uploadRow;
+        }
+
+        const u8 *pixels = texture->pixels + levelOffset + texture->uploadRow * rowSize;
+        UploadRows(stream, level, texture->uploadRow, width, rows, pixels);
+
+        uploaded += rows * rowSize;
+        texture->uploadRow += rows;
+        if (texture->uploadRow == height)
+        {
+            texture->uploadRow = 0;
+            ++texture->uploadLevel;
+        }
+    }
+
+    if (texture->uploadLevel == texture->mipCount)
+    {
+        if (texture->mipCount == 1)
+        {
+            // Loose image files come without a mip chain
+            glGenerateMipmap(GL_TEXTURE_2D);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000);
+        }
+
+        if (texture->ownsPixels)
+        {
+            stbi_image_free((void *)texture->pixels);
+        }
+        texture->pixels = NULL;
+        texture->ownsPixels = false;
+        texture->state = StreamState_Ready;
+    }
+
+    return uploaded;
+}
+
+void AssetStreamUpdate(struct AssetStream *stream, usize byteBudget)
+{
+    struct StreamedTexture *completed = atomic_exchange_explicit(&stream->completed, NULL, memory_order_acquire);
+
+    // The list comes out newest first; reverse it so uploads keep request order
+    struct StreamedTexture *ordered = NULL;
+    while (completed)
+    {
+        struct StreamedTexture *next = completed->next;
+        completed->next = ordered;
+        ordered = completed;
+        completed = next;
+    }
+
+    while (ordered)
+    {
+        struct StreamedTexture *texture = ordered;
+        ordered = ordered->next;
+        texture->next = NULL;
+
+        if (texture->loadFailed)
+        {
+            fprintf(stderr, "Could not load texture %s.\n", texture->name);
+            texture->state = StreamState_Failed;
+            continue;
+        }
+
+        texture->state = StreamState_Loaded;
+        if (stream->uploadTail)
+        {
+            stream->uploadTail->next = texture;
+        }
+        else
+        {
+            stream->uploadHead = texture;
+        }
+        stream->uploadTail = texture;
+    }
+
+    usize uploaded = 0;
+    while (stream->uploadHead && uploaded < byteBudget)
+    {
+        struct StreamedTexture *texture = stream->uploadHead;
+        uploaded += UploadSome(stream, texture, byteBudget - uploaded);
+
+        if (texture->state == StreamState_Ready)
+        {
+            stream->uploadHead = texture->next;
+            if (!stream->uploadHead)
+            {
+                stream->uploadTail = NULL;
+            }
+            texture->next = NULL;
+        }
+    }
+}
+
+u32 AssetStreamGetTexture(const struct AssetStream *stream, u32 handle)
+{
+    if (AssetStreamIsReady(stream, handle))
+    {
+        return stream->textures[handle].texture;
+    }
+    return stream->placeholderTexture;
+}
+
+bool AssetStreamIsReady(const struct AssetStream *stream, u32 handle)
+{
+    return handle < stream->textureCount && stream->textures[handle].state == StreamState_Ready;
+}
@@ -0,0 +1,95 @@
+#ifndef ASSET_STREAM_H
+#define ASSET_STREAM_H
+
+// Asynchronous texture loading. Worker threads do the file I/O and image
+// decoding, then hand finished pixels to the GL thread through a lock-free
+// completion list. The GL thread uploads a bounded number of bytes per frame,
+// and until a texture is complete, lookups return a placeholder.
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "common.h"
+#include "asset_pack.h"
+
+#define ASSET_STREAM_MAX_TEXTURES 64
+#define ASSET_STREAM_MAX_WORKERS 8
+#define ASSET_STREAM_INVALID_HANDLE UINT32_MAX
+
+enum StreamState
+{
+    StreamState_Free = 0,
+    StreamState_Queued,    // waiting for a worker
+    StreamState_Loaded,    // pixels ready, waiting for upload
+    StreamState_Uploading,
+    StreamState_Ready,
+    StreamState_Failed,
+};
+
+struct StreamedTexture
+{
+    char name[128]; // asset pack entry name, or a file path
+
+    // Written by the worker before the texture is published as completed
+    const u8 *pixels;
+    bool ownsPixels;
+    bool loadFailed;
+    u32 width;
+    u32 height;
+    u32 mipCount;
+
+    // GL thread only
+    enum StreamState state;
+    u32 texture;
+    u32 uploadLevel;
+    u32 uploadRow;
+
+    struct StreamedTexture *next;
+};
+
+struct AssetStream
+{
+    const struct AssetPack *pack;
+
+    struct StreamedTexture textures[ASSET_STREAM_MAX_TEXTURES];
+    u32 textureCount;
+    u32 placeholderTexture;
+
+    // Pending load requests, guarded by requestMutex
+    pthread_mutex_t requestMutex;
+    pthread_cond_t requestAvailable;
+    u32 requests[ASSET_STREAM_MAX_TEXTURES];
+    u32 requestHead;
+    u32 requestTail;
+    bool quit;
+
+    pthread_t workers[ASSET_STREAM_MAX_WORKERS];
+    u32 workerCount;
+
+    // Lock-free list of loaded textures, pushed by workers, drained by the GL thread
+    _Atomic(struct StreamedTexture *) completed;
+
+    // GL thread only, in the order uploads happen
+    struct StreamedTexture *uploadHead;
+    struct StreamedTexture *uploadTail;
+
+    bool usePixelBuffers;
+    u32 pixelBuffer;
+};
+
+bool AssetStreamInit(struct AssetStream *stream, const struct AssetPack *pack, u32 workerCount, bool usePixelBuffers);
+void AssetStreamShutdown(struct AssetStream *stream);
+
+// Queues a texture load. `name` is looked up in the asset pack first and
+// otherwise treated as an image file path.
+u32 AssetStreamRequestTexture(struct AssetStream *stream, const char *name);
+
+// Picks up finished loads and uploads at most about `byteBudget` bytes.
+// Call once per frame on the GL thread.
+void AssetStreamUpdate(struct AssetStream *stream, usize byteBudget);
+
+// The GL texture for `handle`, or the placeholder while it is still loading
+u32 AssetStreamGetTexture(const struct AssetStream *stream, u32 handle);
+bool AssetStreamIsReady(const struct AssetStream *stream, u32 handle);
+
+#endif // ASSET_STREAM_H
@@ -0,0 +1,25 @@
+#ifndef ATLAS_H
+#define ATLAS_H
+
+// Where a sprite ended up in the atlas baked by atlaspack (atlas_packer.c).
+// The packer generates atlas_sprites.h, which holds:
+//
+//   SPRITE_ATLAS_PAGE_COUNT and spriteAtlasPages[], the page names in the
+//   asset pack
+//   enum Sprite { Sprite_<image>, Sprite_<sheet>_<cell>, ..., Sprite_Count }
+//   spriteRects[Sprite_Count], one AtlasRect per sprite
+//
+// Sheets sliced into cells number them from the bottom left, row by row,
+// the way the old 8x8 tile coordinates did.
+
+#include "common.h"
+
+struct AtlasRect
+{
+    u32 page;   // index into spriteAtlasPages
+    u32 width;  // pixels
+    u32 height;
+    f32 uv[4];  // minU, minV, maxU, maxV, GL orientation (v up)
+};
+
+#endif // ATLAS_H
@@ -0,0 +1,616 @@
+// Offline sprite atlas packer. Packs many images, and the cells of sprite
+// sheets, into a few large pages, so a scene draws from one texture instead
+// of binding one per image. Writes:
+//
+//   <output dir>/<name>_<page>.tga  pages for assetpack, which bakes the mips
+//   <output dir>/atlas_<name>.h     Sprite enum and spriteRects table (atlas.h)
+//
+// usage: atlaspack <output dir> <name> [--page-size N] [--padding N] [--pages N]
+//                  <image>[:<columns>x<rows>][@<scale>]...
+//
+// ":8x8" slices an image into a grid of cells, "@0.25" shrinks it first.
+// Each sprite is surrounded by `padding` pixels copied from its edges and
+// placed on a PACK_ALIGNMENT grid, so filtering and the first mip levels
+// don't bleed in neighbors. Deeper levels would, so the pages have to be
+// baked with at most log2(PACK_ALIGNMENT) + 1 levels (assetpack's
+// --max-mips; the build keeps ATLAS_MIP_COUNT in step). Rects are placed with the skyline bottom-left
+// heuristic, tallest first.
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include "common.h"
+#include "allocator.h"
+
+#define DEFAULT_PAGE_SIZE 2048
+#define DEFAULT_PADDING 2
+#define DEFAULT_MAX_PAGES 8
+// Rects start and end on multiples of this, which keeps mip levels up to
+// log2(PACK_ALIGNMENT) from mixing two sprites
+#define PACK_ALIGNMENT 4
+#define SPRITE_NAME_LENGTH 64
+
+struct SourceImage
+{
+    u8 *pixels; // RGBA8, top row first
+    u32 width;
+    u32 height;
+    bool shrunk; // pixels are ours rather than stb_image's
+};
+
+struct PackedSprite
+{
+    char name[SPRITE_NAME_LENGTH];
+
+    const struct SourceImage *image;
+    u32 sourceX;
+    u32 sourceY;
+    u32 width;
+    u32 height;
+
+    // Placement of the sprite's own pixels, inside the padding
+    u32 page;
+    u32 x;
+    u32 y;
+};
+
+struct SkylineNode
+{
+    u32 x;
+    u32 y; // top edge of the free space above this span, pages grow down
+    u32 width;
+};
+
+struct Skyline
+{
+    struct SkylineNode *nodes;
+    u32 count;
+};
+
+static const char *BaseName(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    const char *backslash = strrchr(path, '\\');
+    if (backslash > slash)
+    {
+        slash = backslash;
+    }
+    return slash ? slash + 1 : path;
+}
+
+static u32 AlignUp(u32 value)
+{
+    return (value + PACK_ALIGNMENT - 1) & ~(u32)(PACK_ALIGNMENT - 1);
+}
+
+// Base name without the extension, made into a C identifier
+static void SpriteName(char *name, usize size, const char *path)
+{
+    const char *base = BaseName(path);
+    usize length = 0;
+    for (const char *c = base; *c && *c != '.' && length + 1 < size; ++c)
+    {
+        name[length++] = isalnum((unsigned char)*c) ? *c : '_';
+    }
+    name[length] = '\0';
+}
+
+// Box filter down to `width` x `height`; every destination pixel averages
+// the source pixels that fall in it
+static u8 *Shrink(const u8 *pixels, u32 sourceWidth, u32 sourceHeight, u32 width, u32 height)
+{
+    u8 *result = MemAlloc(DefaultAllocator, (usize)width * height * 4);
+    for (u32 y = 0; y < height; ++y)
+    {
+        u32 y0 = y * sourceHeight / height;
+        u32 y1 = (y + 1) * sourceHeight / height;
+        y1 = y1 > y0 ? y1 : y0 + 1;
+        for (u32 x = 0; x < width; ++x)
+        {
+            u32 x0 = x * sourceWidth / width;
+            u32 x1 = (x + 1) * sourceWidth / width;
+            x1 = x1 > x0 ? x1 : x0 + 1;
+
+            u32 sum[4] = {0};
+            for (u32 sy = y0; sy < y1; ++sy)
+            {
+                for (u32 sx = x0; sx < x1; ++sx)
+                {
+                    for (u32 c = 0; c < 4; ++c)
+                    {
+                        sum[c] += pixels[((usize)sy * sourceWidth + sx) * 4 + c];
+                    }
+                }
+            }
+
+            u32 count = (y1 - y0) * (x1 - x0);
+            for (u32 c = 0; c < 4; ++c)
+            {
+                result[((usize)y * width + x) * 4 + c] = (u8)((sum[c] + count / 2) / count);
+            }
+        }
+    }
+    return result;
+}
+
+// Parses "<path>[:<columns>x<rows>][@<scale>]", loads the image and adds a
+// sprite per cell
+static bool AddInput(const char *argument, struct SourceImage *image, struct PackedSprite **sprites, u32 *spriteCount)
+{
+    char path[1024];
+    strncpy(path, argument, sizeof(path) - 1);
+    path[sizeof(path) - 1] = '\0';
+
+    f32 scale = 1.0f;
+    char *at = strrchr(path, '@');
+    if (at && at > BaseName(path))
+    {
+        *at = '\0';
+        scale = strtof(at + 1, NULL);
+        if (scale <= 0.0f || scale > 1.0f)
+        {
+            fprintf(stderr, "Scale in %s must be in (0, 1].\n", argument);
+            return false;
+        }
+    }
+
+    u32 columns = 1;
+    u32 rows = 1;
+    char *colon = strrchr(path, ':');
+    if (colon && colon > BaseName(path))
+    {
+        *colon = '\0';
+        if (sscanf(colon + 1, "%ux%u", &columns, &rows) != 2 || columns == 0 || rows == 0)
+        {
+            fprintf(stderr, "Bad grid in %s, expected <columns>x<rows>.\n", argument);
+            return false;
+        }
+    }
+
+    s32 width;
+    s32 height;
+    s32 channels;
+    u8 *pixels = stbi_load(path, &width, &height, &channels, 4);
+    if (!pixels)
+    {
+        fprintf(stderr, "Could not load image %s: %s\n", path, stbi_failure_reason());
+        return false;
+    }
+
+    image->pixels = pixels;
+    image->width = (u32)width;
+    image->height = (u32)height;
+    if (scale < 1.0f)
+    {
+        u32 scaledWidth = (u32)((f32)width * scale + 0.5f);
+        u32 scaledHeight = (u32)((f32)height * scale + 0.5f);
+        image->pixels = Shrink(pixels, (u32)width, (u32)height, scaledWidth ? scaledWidth : 1, scaledHeight ? scaledHeight : 1);
+        image->width = scaledWidth ? scaledWidth : 1;
+        image->height = scaledHeight ? scaledHeight : 1;
+        image->shrunk = true;
+        stbi_image_free(pixels);
+    }
+
+    if (image->width % columns != 0 || image->height % rows != 0)
+    {
+        fprintf(stderr, "%s is %ux%u, which doesn't split into %ux%u cells.\n",
+                path, image->width, image->height, columns, rows);
+        return false;
+    }
+
+    // Leaves room for a cell number
+    char name[SPRITE_NAME_LENGTH - 12];
+    SpriteName(name, sizeof(name), path);
+    u32 cellWidth = image->width / columns;
+    u32 cellHeight = image->height / rows;
+    u32 cellCount = columns * rows;
+
+    *sprites = MemRealloc(DefaultAllocator, (*spriteCount + cellCount) * sizeof(**sprites),
+                          *spriteCount * sizeof(**sprites), *sprites);
+    for (u32 cell = 0; cell < cellCount; ++cell)
+    {
+        struct PackedSprite *sprite = &(*sprites)[(*spriteCount)++];
+        memset(sprite, 0, sizeof(*sprite));
+        if (cellCount == 1)
+        {
+            snprintf(sprite->name, sizeof(sprite->name), "%s", name);
+        }
+        else
+        {
+            snprintf(sprite->name, sizeof(sprite->name), "%s_%u", name, cell);
+        }
+
+        // Cells count from the bottom left, images are stored top row first
+        u32 column = cell % columns;
+        u32 rowFromBottom = cell / columns;
+        sprite->image = image;
+        sprite->sourceX = column * cellWidth;
+        sprite->sourceY = (rows - 1 - rowFromBottom) * cellHeight;
+        sprite->width = cellWidth;
+        sprite->height = cellHeight;
+    }
+
+    return true;
+}
+
+static int CompareByHeight(const void *a, const void *b)
+{
+    const struct PackedSprite *spriteA = *(const struct PackedSprite *const *)a;
+    const struct PackedSprite *spriteB = *(const struct PackedSprite *const *)b;
+    if (spriteA->height != spriteB->height)
+    {
+        return spriteA->height > spriteB->height ? -1 : 1;
+    }
+    if (spriteA->width != spriteB->width)
+    {
+        return spriteA->width > spriteB->width ? -1 : 1;
+    }
+    return strcmp(spriteA->name, spriteB->name);
+}
+
+// Where a width x height rect would rest if its left edge were at node
+// `index`: on the highest skyline span under it. False if it won't fit.
+static bool SkylineFit(const struct Skyline *skyline, u32 index, u32 width, u32 height, u32 pageSize, u32 *y)
+{
+    u32 x = skyline->nodes[index].x;
+    if (x + width > pageSize)
+    {
+        return false;
+    }
+
+    u32 top = 0;
+    u32 covered = 0;
+    for (u32 i = index; covered < width; ++i)
+    {
+        top = skyline->nodes[i].y > top ? skyline->nodes[i].y : top;
+        covered += skyline->nodes[i].width;
+    }
+
+    *y = top;
+    return top + height <= pageSize;
+}
+
+// Bottom-left: the spot that leaves the rect's bottom edge highest up the
+// page, leftmost on ties
+static bool SkylineInsert(struct Skyline *skyline, u32 width, u32 height, u32 pageSize, u32 *outX, u32 *outY)
+{
+    u32 bestIndex = UINT32_MAX;
+    u32 bestBottom = UINT32_MAX;
+    u32 bestY = 0;
+    for (u32 i = 0; i < skyline->count; ++i)
+    {
+        u32 y;
+        if (SkylineFit(skyline, i, width, height, pageSize, &y) && y + height < bestBottom)
+        {
+            bestIndex = i;
+            bestBottom = y + height;
+            bestY = y;
+        }
+    }
+
+    if (bestIndex == UINT32_MAX)
+    {
+        return false;
+    }
+
+    u32 x = skyline->nodes[bestIndex].x;
+
+    // The new span replaces everything under the rect, and the last node
+    // it partly covers is cut down to what sticks out to the right
+    u32 end = x + width;
+    u32 last = bestIndex;
+    while (last < skyline->count && skyline->nodes[last].x + skyline->nodes[last].width <= end)
+    {
+        ++last;
+    }
+    if (last < skyline->count && skyline->nodes[last].x < end)
+    {
+        u32 nodeEnd = skyline->nodes[last].x + skyline->nodes[last].width;
+        skyline->nodes[last].x = end;
+        skyline->nodes[last].width = nodeEnd - end;
+    }
+
+    u32 removed = last - bestIndex;
+    memmove(&skyline->nodes[bestIndex + 1], &skyline->nodes[last], (skyline->count - last) * sizeof(*skyline->nodes));
+    skyline->count = skyline->count - removed + 1;
+    skyline->nodes[bestIndex] = (struct SkylineNode){x, bestY + height, width};
+
+    // Merge neighbors at the same height, so the node count stays small
+    for (u32 i = 0; i + 1 < skyline->count;)
+    {
+        if (skyline->nodes[i].y == skyline->nodes[i + 1].y)
+        {
+            skyline->nodes[i].width += skyline->nodes[i + 1].width;
+            memmove(&skyline->nodes[i + 1], &skyline->nodes[i + 2], (skyline->count - i - 2) * sizeof(*skyline->nodes));
+            skyline->count -= 1;
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    *outX = x;
+    *outY = bestY;
+    return true;
+}
+
+// Copies the sprite in and extrudes its edge pixels into the padding
+static void Blit(u8 *page, u32 pageSize, const struct PackedSprite *sprite, u32 padding)
+{
+    const struct SourceImage *image = sprite->image;
+    s32 width = (s32)sprite->width;
+    s32 height = (s32)sprite->height;
+
+    for (s32 y = -(s32)padding; y < height + (s32)padding; ++y)
+    {
+        s32 sy = y < 0 ? 0 : (y >= height ? height - 1 : y);
+        for (s32 x = -(s32)padding; x < width + (s32)padding; ++x)
+        {
+            s32 sx = x < 0 ? 0 : (x >= width ? width - 1 : x);
+            const u8 *from = image->pixels + (((usize)sprite->sourceY + sy) * image->width + sprite->sourceX + sx) * 4;
+            u8 *to = page + (((usize)sprite->y + y) * pageSize + sprite->x + x) * 4;
+            memcpy(to, from, 4);
+        }
+    }
+}
+
+// Uncompressed 32 bit TGA, top row first, which stb_image (and so
+// assetpack) reads back without any extra dependency
+static bool WriteTga(const char *path, const u8 *pixels, u32 width, u32 height)
+{
+    FILE *file = fopen(path, "wb");
+    if (!file)
+    {
+        return false;
+    }
+
+    u8 header[18] = {0};
+    header[2] = 2; // uncompressed true color
+    header[12] = (u8)(width & 0xFF);
+    header[13] = (u8)(width >> 8);
+    header[14] = (u8)(height & 0xFF);
+    header[15] = (u8)(height >> 8);
+    header[16] = 32;
+    header[17] = 0x28; // 8 alpha bits, top-left origin
+
+    bool ok = fwrite(header, sizeof(header), 1, file) == 1;
+
+    u8 *row = MemAlloc(DefaultAllocator, (usize)width * 4);
+    for (u32 y = 0; ok && y < height; ++y)
+    {
+        const u8 *from = pixels + (usize)y * width * 4;
+        for (u32 x = 0; x < width; ++x)
+        {
+            row[x * 4 + 0] = from[x * 4 + 2];
+            row[x * 4 + 1] = from[x * 4 + 1];
+            row[x * 4 + 2] = from[x * 4 + 0];
+            row[x * 4 + 3] = from[x * 4 + 3];
+        }
+        ok = fwrite(row, 4, width, file) == width;
+    }
+    MemFree(DefaultAllocator, row);
+
+    return (fclose(file) == 0) && ok;
+}
+
+static bool WriteHeader(const char *path, const char *name, u32 pageSize, u32 pageCount,
+                        const struct PackedSprite *sprites, u32 spriteCount)
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+    {
+        return false;
+    }
+
+    fprintf(file, "// Generated by atlaspack, don't edit. See atlas.h.\n\n");
+    fprintf(file, "#ifndef ATLAS_SPRITES_H\n#define ATLAS_SPRITES_H\n\n#include \"atlas.h\"\n\n");
+    fprintf(file, "#define SPRITE_ATLAS_PAGE_COUNT %u\n", pageCount);
+    fprintf(file, "#define SPRITE_ATLAS_PAGE_SIZE %u\n\n", pageSize);
+
+    fprintf(file, "static const char *const spriteAtlasPages[SPRITE_ATLAS_PAGE_COUNT] = {\n");
+    for (u32 page = 0; page < pageCount; ++page)
+    {
+        fprintf(file, "    \"%s_%u.tga\",\n", name, page);
+    }
+    fprintf(file, "};\n\n");
+
+    fprintf(file, "enum Sprite\n{\n");
+    for (u32 i = 0; i < spriteCount; ++i)
+    {
+        fprintf(file, "    Sprite_%s,\n", sprites[i].name);
+    }
+    fprintf(file, "    Sprite_Count,\n};\n\n");
+
+    // Pages are flipped on load, so v counts from the bottom row
+    f32 texel = 1.0f / (f32)pageSize;
+    fprintf(file, "static const struct AtlasRect spriteRects[Sprite_Count] = {\n");
+    for (u32 i = 0; i < spriteCount; ++i)
+    {
+        const struct PackedSprite *sprite = &sprites[i];
+        fprintf(file, "    [Sprite_%s] = {%u, %u, %u, {%.9gf, %.9gf, %.9gf, %.9gf}},\n",
+                sprite->name, sprite->page, sprite->width, sprite->height,
+                (f32)sprite->x * texel, 1.0f - (f32)(sprite->y + sprite->height) * texel,
+                (f32)(sprite->x + sprite->width) * texel, 1.0f - (f32)sprite->y * texel);
+    }
+    fprintf(file, "};\n\n#endif // ATLAS_SPRITES_H\n");
+
+    return fclose(file) == 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 4)
+    {
+        fprintf(stderr, "usage: %s <output dir> <name> [--page-size N] [--padding N] [--pages N] "
+                        "<image>[:<columns>x<rows>][@<scale>]...\n", argv[0]);
+        return 1;
+    }
+
+    const char *outputDirectory = argv[1];
+    const char *name = argv[2];
+    u32 pageSize = DEFAULT_PAGE_SIZE;
+    u32 padding = DEFAULT_PADDING;
+    u32 maxPages = DEFAULT_MAX_PAGES;
+    bool exactPages = false;
+
+    u32 inputCount = 0;
+    struct SourceImage *images = MemZeroAlloc(DefaultAllocator, (usize)argc * sizeof(*images));
+    struct PackedSprite *sprites = NULL;
+    u32 spriteCount = 0;
+
+    for (s32 i = 3; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--page-size") == 0 && i + 1 < argc)
+        {
+            pageSize = (u32)strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--padding") == 0 && i + 1 < argc)
+        {
+            padding = (u32)strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--pages") == 0 && i + 1 < argc)
+        {
+            // The build lists the page files up front, so it asks for an exact count
+            maxPages = (u32)strtoul(argv[++i], NULL, 10);
+            exactPages = true;
+        }
+        else if (!AddInput(argv[i], &images[inputCount++], &sprites, &spriteCount))
+        {
+            return 1;
+        }
+    }
+
+    if (pageSize == 0 || pageSize > 0xFFFF || (pageSize & (pageSize - 1)) != 0 || maxPages == 0)
+    {
+        fprintf(stderr, "The page size must be a power of two up to 32768, and there must be at least one page.\n");
+        return 1;
+    }
+
+    for (u32 i = 1; i < spriteCount; ++i)
+    {
+        for (u32 j = 0; j < i; ++j)
+        {
+            if (strcmp(sprites[i].name, sprites[j].name) == 0)
+            {
+                fprintf(stderr, "Duplicate sprite name %s.\n", sprites[i].name);
+                return 1;
+            }
+        }
+    }
+
+    // Pack tallest first, but keep the table in input order
+    struct PackedSprite **order = MemAlloc(DefaultAllocator, spriteCount * sizeof(*order));
+    for (u32 i = 0; i < spriteCount; ++i)
+    {
+        order[i] = &sprites[i];
+    }
+    qsort(order, spriteCount, sizeof(*order), CompareByHeight);
+
+    struct Skyline *skylines = MemZeroAlloc(DefaultAllocator, maxPages * sizeof(*skylines));
+    u32 pageCount = 0;
+
+    for (u32 i = 0; i < spriteCount; ++i)
+    {
+        struct PackedSprite *sprite = order[i];
+        u32 slotWidth = AlignUp(sprite->width + 2 * padding);
+        u32 slotHeight = AlignUp(sprite->height + 2 * padding);
+
+        bool placed = false;
+        for (u32 page = 0; !placed && page < maxPages; ++page)
+        {
+            if (page == pageCount)
+            {
+                skylines[page].nodes = MemAlloc(DefaultAllocator, (pageSize / PACK_ALIGNMENT + 1) * sizeof(*skylines[page].nodes));
+                skylines[page].nodes[0] = (struct SkylineNode){0, 0, pageSize};
+                skylines[page].count = 1;
+                pageCount += 1;
+            }
+
+            u32 x, y;
+            if (SkylineInsert(&skylines[page], slotWidth, slotHeight, pageSize, &x, &y))
+            {
+                sprite->page = page;
+                sprite->x = x + padding;
+                sprite->y = y + padding;
+                placed = true;
+            }
+        }
+
+        if (!placed)
+        {
+            fprintf(stderr, "%s (%ux%u) doesn't fit in %u pages of %u.\n",
+                    sprite->name, sprite->width, sprite->height, maxPages, pageSize);
+            return 1;
+        }
+    }
+
+    if (exactPages)
+    {
+        pageCount = maxPages;
+    }
+
+    usize pageBytes = (usize)pageSize * pageSize * 4;
+    u8 *pixels = MemAlloc(DefaultAllocator, pageBytes);
+    char path[1024];
+    for (u32 page = 0; page < pageCount; ++page)
+    {
+        memset(pixels, 0, pageBytes);
+        for (u32 i = 0; i < spriteCount; ++i)
+        {
+            if (sprites[i].page == page)
+            {
+                Blit(pixels, pageSize, &sprites[i], padding);
+            }
+        }
+
+        snprintf(path, sizeof(path), "%s/%s_%u.tga", outputDirectory, name, page);
+        if (!WriteTga(path, pixels, pageSize, pageSize))
+        {
+            fprintf(stderr, "Could not write %s.\n", path);
+            return 1;
+        }
+    }
+
+    snprintf(path, sizeof(path), "%s/atlas_%s.h", outputDirectory, name);
+    if (!WriteHeader(path, name, pageSize, pageCount, sprites, spriteCount))
+    {
+        fprintf(stderr, "Could not write %s.\n", path);
+        remove(path);
+        return 1;
+    }
+
+    u64 usedArea = 0;
+    for (u32 i = 0; i < spriteCount; ++i)
+    {
+        usedArea += (u64)sprites[i].width * sprites[i].height;
+    }
+    printf("Packed %u sprites into %u %ux%u pages (%.1f%% used).\n", spriteCount, pageCount, pageSize, pageSize,
+           100.0 * (f64)usedArea / ((f64)pageSize * pageSize * pageCount));
+
+    MemFree(DefaultAllocator, pixels);
+    for (u32 page = 0; page < pageCount && page < maxPages; ++page)
+    {
+        MemFree(DefaultAllocator, skylines[page].nodes);
+    }
+    MemFree(DefaultAllocator, skylines);
+    MemFree(DefaultAllocator, order);
+    MemFree(DefaultAllocator, sprites);
+    for (u32 i = 0; i < inputCount; ++i)
+    {
+        if (images[i].shrunk)
+        {
+            MemFree(DefaultAllocator, images[i].pixels);
+        }
+        else
+        {
+            stbi_image_free(images[i].pixels);
+        }
+    }
+    MemFree(DefaultAllocator, images);
+    return 0;
+}
@@ -0,0 +1,781 @@
+#include "audio.h"
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#define AUDIO_PERIOD_NS ((u64)AUDIO_PERIOD_FRAMES * 1000000000ull / AUDIO_SAMPLE_RATE)
+
+#define FIXED_ONE (1ull << 32)
+
+// Bytes read from a WAV file at a time; a whole number of frames for every
+// supported format
+#define WAV_READ_BLOCK 6144
+
+static u64 Now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (u64)now.tv_sec * 1000000000ull + (u64)now.tv_nsec;
+}
+
+static void SleepUntil(u64 deadline)
+{
+    struct timespec wake = {
+        .tv_sec = (time_t)(deadline / 1000000000ull),
+        .tv_nsec = (long)(deadline % 1000000000ull),
+    };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL) == EINTR)
+    {
+    }
+}
+
+static void AtomicMax(_Atomic u64 *target, u64 value)
+{
+    u64 current = atomic_load_explicit(target, memory_order_relaxed);
+    while (value > current &&
+           !atomic_compare_exchange_weak_explicit(target, &current, value, memory_order_relaxed, memory_order_relaxed))
+    {
+    }
+}
+
+// Command ring
+
+// Everything but Stop leaves this many slots free, so a flood of SetVoice
+// can't keep a voice from being stopped
+#define AUDIO_STOP_RESERVE AUDIO_MAX_VOICES
+
+static bool PushCommand(struct AudioMixer *mixer, struct AudioCommand *command)
+{
+    u32 head = atomic_load_explicit(&mixer->commandHead, memory_order_relaxed);
+    u32 tail = atomic_load_explicit(&mixer->commandTail, memory_order_acquire);
+    u32 capacity = command->kind == AudioCommand_Stop ? AUDIO_COMMAND_CAPACITY
+                                                      : AUDIO_COMMAND_CAPACITY - AUDIO_STOP_RESERVE;
+    if (head - tail >= capacity)
+    {
+        atomic_fetch_add_explicit(&mixer->stats.droppedCommands, 1, memory_order_relaxed);
+        return false;
+    }
+
+    command->time = Now();
+    mixer->commands[head & (AUDIO_COMMAND_CAPACITY - 1)] = *command;
+    atomic_store_explicit(&mixer->commandHead, head + 1, memory_order_release);
+    return true;
+}
+
+static bool PopCommand(struct AudioMixer *mixer, struct AudioCommand *command)
+{
+    u32 tail = atomic_load_explicit(&mixer->commandTail, memory_order_relaxed);
+    u32 head = atomic_load_explicit(&mixer->commandHead, memory_order_acquire);
+    if (tail == head)
+    {
+        return false;
+    }
+
+    *command = mixer->commands[tail & (AUDIO_COMMAND_CAPACITY - 1)];
+    atomic_store_explicit(&mixer->commandTail, tail + 1, memory_order_release);
+    return true;
+}
+
+// Game thread
+
+Handle AudioPlay(struct AudioMixer *mixer, const struct AudioClip *clip, f32 volume, f32 pan, f32 pitch, bool loop)
+{
+    if (!clip || !clip->frameCount)
+    {
+        return HANDLE_INVALID;
+    }
+
+    Handle voice = HandlePoolAlloc(&mixer->handles);
+    if (voice == HANDLE_INVALID)
+    {
+        return HANDLE_INVALID;
+    }
+
+    struct AudioCommand command = {
+        .kind = AudioCommand_Play,
+        .voice = voice,
+        .clip = clip,
+        .volume = volume,
+        .pan = pan,
+        .pitch = pitch,
+        .loop = loop,
+    };
+    if (!PushCommand(mixer, &command))
+    {
+        HandlePoolRelease(&mixer->handles, voice);
+        return HANDLE_INVALID;
+    }
+
+    return voice;
+}
+
+bool AudioStop(struct AudioMixer *mixer, Handle voice)
+{
+    if (!HandlePoolIsValid(&mixer->handles, voice))
+    {
+        return false;
+    }
+
+    // Only a queued Stop frees the handle, so a dropped one leaves the
+    // voice stoppable. Once freed, the slot can only be reused by a later
+    // Play, which the mixer sees after this Stop.
+    struct AudioCommand command = {.kind = AudioCommand_Stop, .voice = voice};
+    if (!PushCommand(mixer, &command))
+    {
+        return false;
+    }
+
+    HandlePoolRelease(&mixer->handles, voice);
+    return true;
+}
+
+void AudioSetVoice(struct AudioMixer *mixer, Handle voice, f32 volume, f32 pan, f32 pitch)
+{
+    if (!HandlePoolIsValid(&mixer->handles, voice))
+    {
+        return;
+    }
+
+    struct AudioCommand command = {
+        .kind = AudioCommand_SetVoice,
+        .voice = voice,
+        .volume = volume,
+        .pan = pan,
+        .pitch = pitch,
+    };
+    PushCommand(mixer, &command);
+}
+
+void AudioSetMasterVolume(struct AudioMixer *mixer, f32 volume)
+{
+    struct AudioCommand command = {.kind = AudioCommand_SetMasterVolume, .volume = volume};
+    PushCommand(mixer, &command);
+}
+
+void AudioUpdate(struct AudioMixer *mixer)
+{
+    for (u32 i = 0; i < AUDIO_MAX_VOICES; ++i)
+    {
+        Handle voice = atomic_load_explicit(&mixer->finished[i], memory_order_acquire);
+        if (voice != HANDLE_INVALID)
+        {
+            // Fails harmlessly when the game stopped it in the meantime
+            HandlePoolRelease(&mixer->handles, voice);
+            atomic_compare_exchange_strong_explicit(&mixer->finished[i], &voice, HANDLE_INVALID,
+                                                    memory_order_relaxed, memory_order_relaxed);
+        }
+    }
+}
+
+// Mixer thread
+
+static u64 StepOf(const struct AudioClip *clip, f32 pitch)
+{
+    pitch = pitch > AUDIO_MAX_PITCH ? AUDIO_MAX_PITCH : pitch;
+    f64 rate = (f64)clip->sampleRate / AUDIO_SAMPLE_RATE * (pitch > 0.0f ? pitch : 0.0f);
+    return (u64)(rate * (f64)FIXED_ONE);
+}
+
+// Constant power pan, so a voice sounds as loud in the middle as at the sides
+static void GainsOf(f32 volume, f32 pan, f32 *left, f32 *right)
+{
+    pan = pan < -1.0f ? -1.0f : (pan > 1.0f ? 1.0f : pan);
+    f32 angle = (pan + 1.0f) * 0.25f * 3.14159265f;
+    *left = volume * cosf(angle);
+    *right = volume * sinf(angle);
+}
+
+static void ApplyCommand(struct AudioMixer *mixer, const struct AudioCommand *command, u64 now)
+{
+    struct AudioVoice *voice = &mixer->voices[HandleIndex(command->voice)];
+
+    switch (command->kind)
+    {
+    case AudioCommand_Play:
+        *voice = (struct AudioVoice){
+            .handle = command->voice,
+            .clip = command->clip,
+            .step = StepOf(command->clip, command->pitch),
+            .volume = command->volume,
+            .pan = command->pan,
+            .loop = command->loop,
+        };
+        break;
+    case AudioCommand_Stop:
+        if (voice->handle == command->voice)
+        {
+            voice->handle = HANDLE_INVALID;
+        }
+        break;
+    case AudioCommand_SetVoice:
+        if (voice->handle == command->voice)
+        {
+            voice->step = StepOf(voice->clip, command->pitch);
+            voice->volume = command->volume;
+            voice->pan = command->pan;
+        }
+        break;
+    case AudioCommand_SetMasterVolume:
+        mixer->masterVolume = command->volume;
+        break;
+    }
+
+    u64 latency = now > command->time ? now - command->time : 0;
+    atomic_fetch_add_explicit(&mixer->stats.commands, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&mixer->stats.commandLatencyNanoseconds, latency, memory_order_relaxed);
+    AtomicMax(&mixer->stats.maxCommandLatencyNanoseconds, latency);
+}
+
+// Resamples up to `frames` frames of one channel into `out`, advancing
+// `position`. Returns the frames written; fewer means a one-shot ended.
+static u32 ResampleChannel(f32 *out, const f32 *samples, u32 frameCount, bool loop, u64 *positionInOut, u64 step,
+                           u32 frames)
+{
+    u64 end = (u64)frameCount << 32;
+    u64 lastInterpolated = (u64)(frameCount - 1) << 32;
+    u64 position = *positionInOut;
+    u32 written = 0;
+
+    // Pitch zero holds the voice in place, silent
+    if (step == 0)
+    {
+        memset(out, 0, frames * sizeof(f32));
+        return frames;
+    }
+
+    while (written < frames)
+    {
+        if (position >= end)
+        {
+            if (!loop)
+            {
+                break;
+            }
+            position %= end;
+        }
+
+        // Unpitched at the clip's own rate, the common case: a plain copy
+        if (step == FIXED_ONE && (u32)position == 0)
+        {
+            u32 index = (u32)(position >> 32);
+            u32 count = frameCount - index;
+            count = count < frames - written ? count : frames - written;
+            memcpy(out + written, samples + index, count * sizeof(f32));
+            written += count;
+            position += (u64)count << 32;
+            continue;
+        }
+
+        // Frames whose next sample is still inside the clip, without a
+        // bounds check each
+        u64 count = position < lastInterpolated ? (lastInterpolated - position + step - 1) / step : 0;
+        count = count < frames - written ? count : frames - written;
+        for (u32 i = 0; i < (u32)count; ++i)
+        {
+            u32 at = (u32)(position >> 32);
+            f32 fraction = (f32)(u32)position * (1.0f / 4294967296.0f);
+            out[written + i] = samples[at] + (samples[at + 1] - samples[at]) * fraction;
+            position += step;
+        }
+        written += (u32)count;
+
+        // The last frame blends toward the loop start, or holds
+        if (written < frames && position < end && position >= lastInterpolated)
+        {
+            u32 at = (u32)(position >> 32);
+            u32 next = loop ? 0 : at;
+            f32 fraction = (f32)(u32)position * (1.0f / 4294967296.0f);
+            out[written] = samples[at] + (samples[next] - samples[at]) * fraction;
+            written += 1;
+            position += step;
+        }
+    }
+
+    *positionInOut = position;
+    return written;
+}
+
+// Fills the voice buffers with the voice's next `frames` frames, the second
+// only for stereo clips, and advances it
+static u32 ReadVoice(struct AudioMixer *mixer, struct AudioVoice *voice, u32 frames)
+{
+    const struct AudioClip *clip = voice->clip;
+    u64 position = voice->position;
+    u32 written = ResampleChannel(mixer->voiceBuffers[0], clip->samples[0], clip->frameCount, voice->loop,
+                                  &position, voice->step, frames);
+
+    if (clip->channels > 1)
+    {
+        // Same start, same step, so the same number of frames
+        u64 rightPosition = voice->position;
+        ResampleChannel(mixer->voiceBuffers[1], clip->samples[1], clip->frameCount, voice->loop,
+                        &rightPosition, voice->step, frames);
+    }
+
+    voice->position = position;
+    return written;
+}
+
+// out[i] += in[i] * (gain + i * delta), for whole groups of 8
+static void MixRamp(f32 *out, const f32 *in, u32 count, f32 gain, f32 delta)
+{
+#if defined(__AVX__)
+    __m256 g = _mm256_add_ps(_mm256_set1_ps(gain),
+                             _mm256_mul_ps(_mm256_set_ps(7, 6, 5, 4, 3, 2, 1, 0), _mm256_set1_ps(delta)));
+    __m256 step = _mm256_set1_ps(8.0f * delta);
+    for (u32 i = 0; i < count; i += 8)
+    {
+        __m256 o = _mm256_loadu_ps(out + i);
+        o = _mm256_add_ps(o, _mm256_mul_ps(_mm256_loadu_ps(in + i), g));
+        _mm256_storeu_ps(out + i, o);
+        g = _mm256_add_ps(g, step);
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    __m128 g = _mm_add_ps(_mm_set1_ps(gain), _mm_mul_ps(_mm_set_ps(3, 2, 1, 0), _mm_set1_ps(delta)));
+    __m128 step = _mm_set1_ps(4.0f * delta);
+    for (u32 i = 0; i < count; i += 4)
+    {
+        __m128 o = _mm_loadu_ps(out + i);
+        o = _mm_add_ps(o, _mm_mul_ps(_mm_loadu_ps(in + i), g));
+        _mm_storeu_ps(out + i, o);
+        g = _mm_add_ps(g, step);
+    }
+#else
+    for (u32 i = 0; i < count; ++i)
+    {
+        out[i] += in[i] * (gain + (f32)i * delta);
+    }
+#endif
+}
+
+// Scales by the master gain, ramped like the voice gains from `gain` by
+// `delta` per frame, saturates and interleaves into s16 frames
+static void ConvertOutput(s16 *out, const f32 *left, const f32 *right, u32 count, f32 gain, f32 delta)
+{
+    gain *= 32767.0f;
+    delta *= 32767.0f;
+#if defined(__SSE2__) || defined(_M_X64)
+    // cvtps rounds, packs saturates, unpack interleaves
+    __m128 s0 = _mm_add_ps(_mm_set1_ps(gain), _mm_mul_ps(_mm_set_ps(3, 2, 1, 0), _mm_set1_ps(delta)));
+    __m128 s1 = _mm_add_ps(s0, _mm_set1_ps(4.0f * delta));
+    __m128 step = _mm_set1_ps(8.0f * delta);
+    for (u32 i = 0; i < count; i += 8)
+    {
+        __m128i l0 = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(left + i), s0));
+        __m128i l1 = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(left + i + 4), s1));
+        __m128i r0 = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(right + i), s0));
+        __m128i r1 = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(right + i + 4), s1));
+        __m128i l = _mm_packs_epi32(l0, l1);
+        __m128i r = _mm_packs_epi32(r0, r1);
+        _mm_storeu_si128((__m128i *)(out + 2 * i), _mm_unpacklo_epi16(l, r));
+        _mm_storeu_si128((__m128i *)(out + 2 * i + 8), _mm_unpackhi_epi16(l, r));
+        s0 = _mm_add_ps(s0, step);
+        s1 = _mm_add_ps(s1, step);
+    }
+#else
+    for (u32 i = 0; i < count; ++i)
+    {
+        f32 scale = gain + (f32)i * delta;
+        f32 l = left[i] * scale;
+        f32 r = right[i] * scale;
+        l = l < -32768.0f ? -32768.0f : (l > 32767.0f ? 32767.0f : l);
+        r = r < -32768.0f ? -32768.0f : (r > 32767.0f ? 32767.0f : r);
+        out[2 * i] = (s16)lrintf(l);
+        out[2 * i + 1] = (s16)lrintf(r);
+    }
+#endif
+}
+
+static void MixPeriod(struct AudioMixer *mixer)
+{
+    memset(mixer->mixBuffers, 0, sizeof(mixer->mixBuffers));
+    u32 active = 0;
+
+    for (u32 v = 0; v < AUDIO_MAX_VOICES; ++v)
+    {
+        struct AudioVoice *voice = &mixer->voices[v];
+        if (voice->handle == HANDLE_INVALID)
+        {
+            continue;
+        }
+
+        // Mono clips mix the one buffer into both sides
+        const f32 *left = mixer->voiceBuffers[0];
+        const f32 *right = mixer->voiceBuffers[voice->clip->channels > 1];
+
+        u32 frames = ReadVoice(mixer, voice, AUDIO_PERIOD_FRAMES);
+        bool ended = frames < AUDIO_PERIOD_FRAMES;
+        if (ended)
+        {
+            // The kernels work on whole periods
+            memset(mixer->voiceBuffers[0] + frames, 0, (AUDIO_PERIOD_FRAMES - frames) * sizeof(f32));
+            memset(mixer->voiceBuffers[1] + frames, 0, (AUDIO_PERIOD_FRAMES - frames) * sizeof(f32));
+        }
+
+        f32 targetLeft;
+        f32 targetRight;
+        GainsOf(voice->volume, voice->pan, &targetLeft, &targetRight);
+        if (!voice->started)
+        {
+            voice->gainLeft = targetLeft;
+            voice->gainRight = targetRight;
+            voice->started = true;
+        }
+
+        MixRamp(mixer->mixBuffers[0], left, AUDIO_PERIOD_FRAMES,
+                voice->gainLeft, (targetLeft - voice->gainLeft) / AUDIO_PERIOD_FRAMES);
+        MixRamp(mixer->mixBuffers[1], right, AUDIO_PERIOD_FRAMES,
+                voice->gainRight, (targetRight - voice->gainRight) / AUDIO_PERIOD_FRAMES);
+        voice->gainLeft = targetLeft;
+        voice->gainRight = targetRight;
+
+        if (ended)
+        {
+            atomic_store_explicit(&mixer->finished[v], voice->handle, memory_order_release);
+            voice->handle = HANDLE_INVALID;
+        }
+        else
+        {
+            active += 1;
+        }
+    }
+
+    ConvertOutput(mixer->output, mixer->mixBuffers[0], mixer->mixBuffers[1], AUDIO_PERIOD_FRAMES,
+                  mixer->masterGain, (mixer->masterVolume - mixer->masterGain) / AUDIO_PERIOD_FRAMES);
+    mixer->masterGain = mixer->masterVolume;
+    atomic_store_explicit(&mixer->stats.activeVoices, active, memory_order_relaxed);
+}
+
+// Backends
+
+static void WriteU16(FILE *file, u16 value)
+{
+    u8 bytes[2] = {(u8)value, (u8)(value >> 8)};
+    fwrite(bytes, 1, sizeof(bytes), file);
+}
+
+static void WriteU32(FILE *file, u32 value)
+{
+    u8 bytes[4] = {(u8)value, (u8)(value >> 8), (u8)(value >> 16), (u8)(value >> 24)};
+    fwrite(bytes, 1, sizeof(bytes), file);
+}
+
+// 16 bit stereo PCM; the sizes are filled in again when the file is closed
+static void WriteWavHeader(FILE *file, u64 frames)
+{
+    u32 dataSize = (u32)(frames * AUDIO_CHANNELS * sizeof(s16));
+    fwrite("RIFF", 1, 4, file);
+    WriteU32(file, 36 + dataSize);
+    fwrite("WAVEfmt ", 1, 8, file);
+    WriteU32(file, 16);
+    WriteU16(file, 1);
+    WriteU16(file, AUDIO_CHANNELS);
+    WriteU32(file, AUDIO_SAMPLE_RATE);
+    WriteU32(file, AUDIO_SAMPLE_RATE * AUDIO_CHANNELS * sizeof(s16));
+    WriteU16(file, AUDIO_CHANNELS * sizeof(s16));
+    WriteU16(file, 16);
+    fwrite("data", 1, 4, file);
+    WriteU32(file, dataSize);
+}
+
+static bool OpenBackend(struct AudioMixer *mixer)
+{
+    switch (mixer->config.backend)
+    {
+    case AudioBackend_Null:
+        return true;
+    case AudioBackend_WavFile:
+        mixer->file = fopen(mixer->config.path, "wb");
+        if (!mixer->file)
+        {
+            fprintf(stderr, "Could not open %s for audio output.\n", mixer->config.path);
+            return false;
+        }
+        // Our own buffer, so stdio doesn't allocate one on the mixer thread
+        setvbuf(mixer->file, mixer->fileBuffer, _IOFBF, sizeof(mixer->fileBuffer));
+        WriteWavHeader(mixer->file, 0);
+        return true;
+    }
+    return false;
+}
+
+static void WriteBackend(struct AudioMixer *mixer)
+{
+    if (mixer->file)
+    {
+        // The output is little endian s16, which is what WAV stores
+        fwrite(mixer->output, sizeof(s16) * AUDIO_CHANNELS, AUDIO_PERIOD_FRAMES, mixer->file);
+    }
+    mixer->framesWritten += AUDIO_PERIOD_FRAMES;
+}
+
+static void CloseBackend(struct AudioMixer *mixer)
+{
+    if (mixer->file)
+    {
+        fseek(mixer->file, 0, SEEK_SET);
+        WriteWavHeader(mixer->file, mixer->framesWritten);
+        fclose(mixer->file);
+        mixer->file = NULL;
+    }
+}
+
+static void *MixerMain(void *data)
+{
+    struct AudioMixer *mixer = data;
+    u64 deadline = Now();
+
+    while (!atomic_load_explicit(&mixer->quit, memory_order_acquire))
+    {
+        if (mixer->config.realtime)
+        {
+            // A device asks for the next period once it starts playing the
+            // current one; waking late means it would have run dry
+            u64 now = Now();
+            if (now > deadline + AUDIO_PERIOD_NS)
+            {
+                atomic_fetch_add_explicit(&mixer->stats.latePeriods, 1, memory_order_relaxed);
+                deadline = now;
+            }
+            else if (now < deadline)
+            {
+                SleepUntil(deadline);
+            }
+            deadline += AUDIO_PERIOD_NS;
+        }
+
+        u64 start = Now();
+        struct AudioCommand command;
+        while (PopCommand(mixer, &command))
+        {
+            ApplyCommand(mixer, &command, start);
+        }
+
+        MixPeriod(mixer);
+
+        u64 mixTime = Now() - start;
+        atomic_fetch_add_explicit(&mixer->stats.mixNanoseconds, mixTime, memory_order_relaxed);
+        AtomicMax(&mixer->stats.maxMixNanoseconds, mixTime);
+        atomic_fetch_add_explicit(&mixer->stats.periods, 1, memory_order_relaxed);
+
+        WriteBackend(mixer);
+    }
+
+    return NULL;
+}
+
+bool AudioInit(struct AudioMixer *mixer, const struct AudioConfig *config, Allocator *alloc, void *user)
+{
+    memset(mixer, 0, sizeof(*mixer));
+    mixer->config = *config;
+    mixer->masterVolume = 1.0f;
+    mixer->masterGain = 1.0f;
+    for (u32 i = 0; i < AUDIO_MAX_VOICES; ++i)
+    {
+        mixer->voices[i].handle = HANDLE_INVALID;
+        atomic_init(&mixer->finished[i], HANDLE_INVALID);
+    }
+    atomic_init(&mixer->commandHead, 0);
+    atomic_init(&mixer->commandTail, 0);
+    atomic_init(&mixer->quit, false);
+
+    HandlePoolInit(&mixer->handles, AUDIO_MAX_VOICES, alloc, user);
+    if (!mixer->handles.memory)
+    {
+        return false;
+    }
+
+    if (!OpenBackend(mixer))
+    {
+        HandlePoolFree(&mixer->handles, alloc, user);
+        return false;
+    }
+
+    if (pthread_create(&mixer->thread, NULL, MixerMain, mixer) != 0)
+    {
+        fprintf(stderr, "Could not start the audio mixer thread.\n");
+        CloseBackend(mixer);
+        HandlePoolFree(&mixer->handles, alloc, user);
+        return false;
+    }
+
+    // Best effort: real-time scheduling needs privileges most users lack.
+    // Flat out, the thread never sleeps, and at FIFO priority it would
+    // starve everything else on its core.
+    if (config->realtime)
+    {
+        struct sched_param param = {.sched_priority = sched_get_priority_min(SCHED_FIFO)};
+        pthread_setschedparam(mixer->thread, SCHED_FIFO, &param);
+    }
+
+    return true;
+}
+
+void AudioShutdown(struct AudioMixer *mixer, Allocator *alloc, void *user)
+{
+    atomic_store_explicit(&mixer->quit, true, memory_order_release);
+    pthread_join(mixer->thread, NULL);
+    CloseBackend(mixer);
+    HandlePoolFree(&mixer->handles, alloc, user);
+}
+
+// WAV decoding
+
+static u32 ReadU16(const u8 *bytes)
+{
+    return (u32)bytes[0] | ((u32)bytes[1] << 8);
+}
+
+static u32 ReadU32(const u8 *bytes)
+{
+    return (u32)bytes[0] | ((u32)bytes[1] << 8) | ((u32)bytes[2] << 16) | ((u32)bytes[3] << 24);
+}
+
+static f32 DecodeSample(const u8 *bytes, u32 bits, bool isFloat)
+{
+    if (isFloat)
+    {
+        f32 value;
+        u32 raw = ReadU32(bytes);
+        memcpy(&value, &raw, sizeof(value));
+        return value;
+    }
+
+    switch (bits)
+    {
+    case 8:
+        return ((f32)bytes[0] - 128.0f) * (1.0f / 128.0f);
+    case 16:
+        return (f32)(s16)ReadU16(bytes) * (1.0f / 32768.0f);
+    case 24:
+        return (f32)((s32)(((u32)bytes[0] << 8) | ((u32)bytes[1] << 16) | ((u32)bytes[2] << 24)) >> 8) * (1.0f / 8388608.0f);
+    default:
+        return (f32)(s32)ReadU32(bytes) * (1.0f / 2147483648.0f);
+    }
+}
+
+bool AudioClipLoadWav(struct AudioClip *clip, const char *path, struct Arena *arena)
+{
+    memset(clip, 0, sizeof(*clip));
+
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        fprintf(stderr, "Could not open %s.\n", path);
+        return false;
+    }
+
+    u8 header[12];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header) ||
+        memcmp(header, "RIFF", 4) != 0 || memcmp(header + 8, "WAVE", 4) != 0)
+    {
+        fprintf(stderr, "%s is not a WAV file.\n", path);
+        fclose(file);
+        return false;
+    }
+
+    // Walk the chunks up to the data, picking up the format on the way
+    u32 format = 0;
+    u32 channels = 0;
+    u32 sampleRate = 0;
+    u32 bits = 0;
+    u32 dataSize = 0;
+    bool foundData = false;
+
+    u8 chunk[8];
+    while (!foundData && fread(chunk, 1, sizeof(chunk), file) == sizeof(chunk))
+    {
+        u32 chunkSize = ReadU32(chunk + 4);
+        if (memcmp(chunk, "fmt ", 4) == 0 && chunkSize >= 16)
+        {
+            u8 fmt[40] = {0};
+            u32 readSize = chunkSize < sizeof(fmt) ? chunkSize : (u32)sizeof(fmt);
+            if (fread(fmt, 1, readSize, file) != readSize)
+            {
+                break;
+            }
+            format = ReadU16(fmt);
+            channels = ReadU16(fmt + 2);
+            sampleRate = ReadU32(fmt + 4);
+            bits = ReadU16(fmt + 14);
+
+            // WAVE_FORMAT_EXTENSIBLE keeps the real format in its subformat
+            if (format == 0xFFFE && readSize >= 26)
+            {
+                format = ReadU16(fmt + 24);
+            }
+            fseek(file, (long)(chunkSize - readSize + (chunkSize & 1)), SEEK_CUR);
+        }
+        else if (memcmp(chunk, "data", 4) == 0)
+        {
+            dataSize = chunkSize;
+            foundData = true;
+        }
+        else
+        {
+            fseek(file, (long)(chunkSize + (chunkSize & 1)), SEEK_CUR);
+        }
+    }
+
+    bool isFloat = format == 3 && bits == 32;
+    bool isPcm = format == 1 && (bits == 8 || bits == 16 || bits == 24 || bits == 32);
+    if (!foundData || !(isFloat || isPcm) || channels < 1 || channels > AUDIO_CHANNELS || !sampleRate)
+    {
+        fprintf(stderr, "%s is not a mono or stereo PCM or float WAV file.\n", path);
+        fclose(file);
+        return false;
+    }
+
+    u32 sampleSize = bits / 8;
+    u32 frameSize = sampleSize * channels;
+    u32 frameCount = dataSize / frameSize;
+
+    struct ArenaMarker marker = ArenaSave(arena);
+    f32 *samples = ArenaPushArray(arena, f32, (usize)frameCount * channels);
+    if (!samples || !frameCount)
+    {
+        fprintf(stderr, "No room for %s in the audio arena.\n", path);
+        ArenaRestore(arena, marker);
+        fclose(file);
+        return false;
+    }
+
+    // Decode straight into the planar arrays, one block at a time
+    u8 block[WAV_READ_BLOCK];
+    u32 framesPerBlock = WAV_READ_BLOCK / frameSize;
+    for (u32 frame = 0; frame < frameCount;)
+    {
+        u32 count = frameCount - frame < framesPerBlock ? frameCount - frame : framesPerBlock;
+        if (fread(block, frameSize, count, file) != count)
+        {
+            fprintf(stderr, "%s is truncated.\n", path);
+            ArenaRestore(arena, marker);
+            fclose(file);
+            return false;
+        }
+
+        for (u32 i = 0; i < count; ++i)
+        {
+            for (u32 c = 0; c < channels; ++c)
+            {
+                samples[c * frameCount + frame + i] = DecodeSample(block + i * frameSize + c * sampleSize, bits, isFloat);
+            }
+        }
+        frame += count;
+    }
+    fclose(file);
+
+    clip->channels = channels;
+    clip->frameCount = frameCount;
+    clip->sampleRate = sampleRate;
+    clip->samples[0] = samples;
+    clip->samples[1] = samples + (channels > 1 ? frameCount : 0);
+    return true;
+}
@@ -0,0 +1,173 @@
+#ifndef AUDIO_H
+#define AUDIO_H
+
+// Software mixer on its own thread. Clips are decoded up front into an
+// arena as planar f32, so mixing never decodes, allocates or locks: the
+// mixer wakes once per period, applies the commands the game queued, mixes
+// every playing voice and hands the period to the output backend.
+//
+// The game thread talks to it through a single producer, single consumer
+// command ring, the same way the input queue works. Voices are named by
+// generational handles the game thread allocates itself, so AudioPlay
+// returns one right away. When a one-shot ends, the mixer posts its handle
+// back in a per-voice slot and AudioUpdate frees it.
+//
+// Voices resample with linear interpolation and are mixed with volume and
+// pan ramped across the period, so changes don't click. The gain and
+// output conversion kernels use AVX or SSE when the build enables them.
+//
+// There is no sound card backend yet. The null backend discards the
+// output and the WAV backend writes it to a file. The file writes go
+// through stdio, which locks the FILE and may block on the disk, so the
+// WAV backend is for capture, not for measuring worst case latency.
+// Either backend can keep real time, like a device would, or run flat out
+// to measure throughput.
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "common.h"
+#include "allocator.h"
+#include "handle_pool.h"
+
+#define AUDIO_SAMPLE_RATE 48000
+#define AUDIO_CHANNELS 2
+#define AUDIO_PERIOD_FRAMES 256 // 5.3 ms; a multiple of 8 for the AVX kernels
+#define AUDIO_MAX_VOICES 128
+#define AUDIO_COMMAND_CAPACITY 1024 // power of two
+#define AUDIO_MAX_PITCH 16.0f
+#define AUDIO_FILE_BUFFER_SIZE (64u << 10) // WAV backend, a dozen periods
+
+struct AudioClip
+{
+    // Planar samples; both point at the same data for mono clips
+    const f32 *samples[AUDIO_CHANNELS];
+    u32 channels;
+    u32 frameCount;
+    u32 sampleRate;
+};
+
+enum AudioCommandKind
+{
+    AudioCommand_Play,
+    AudioCommand_Stop,
+    AudioCommand_SetVoice,
+    AudioCommand_SetMasterVolume,
+};
+
+struct AudioCommand
+{
+    u32 kind;
+    Handle voice;
+    const struct AudioClip *clip;
+    f32 volume;
+    f32 pan; // -1 left to 1 right
+    f32 pitch;
+    bool loop;
+    u64 time; // when it was queued, for the latency stats
+};
+
+// Mixer thread only
+struct AudioVoice
+{
+    Handle handle; // HANDLE_INVALID when idle
+    const struct AudioClip *clip;
+    u64 position;  // in clip frames, 32.32 fixed point
+    u64 step;      // per output frame, 32.32 fixed point
+    f32 volume;
+    f32 pan;
+    f32 gainLeft;  // as of the end of the last period, ramped toward volume and pan
+    f32 gainRight;
+    bool loop;
+    bool started;  // false until the first period, which starts at full gain
+};
+
+enum AudioBackendKind
+{
+    AudioBackend_Null,
+    AudioBackend_WavFile,
+};
+
+struct AudioConfig
+{
+    enum AudioBackendKind backend;
+    const char *path; // AudioBackend_WavFile only
+    bool realtime;    // pace periods like a device would, rather than flat out
+};
+
+// Written by the mixer thread, read by anyone
+struct AudioStats
+{
+    _Atomic u64 periods;
+    _Atomic u64 mixNanoseconds; // spent mixing, summed over periods
+    _Atomic u64 maxMixNanoseconds;
+    _Atomic u64 commands;
+    _Atomic u64 commandLatencyNanoseconds; // queued to applied, summed
+    _Atomic u64 maxCommandLatencyNanoseconds;
+    _Atomic u32 activeVoices;
+    _Atomic u32 latePeriods; // realtime only: periods that started after their deadline
+    _Atomic u32 droppedCommands; // pushed while the ring was full
+};
+
+struct AudioMixer
+{
+    // Game thread -> mixer thread
+    struct AudioCommand commands[AUDIO_COMMAND_CAPACITY];
+    _Alignas(64) _Atomic u32 commandHead; // next slot the game thread writes
+    _Alignas(64) _Atomic u32 commandTail; // next slot the mixer reads
+
+    // Mixer thread -> game thread: the handle of the voice that last ended
+    // on its own in each slot
+    _Alignas(64) _Atomic Handle finished[AUDIO_MAX_VOICES];
+
+    // Game thread only
+    struct HandlePool handles;
+
+    // Mixer thread only
+    struct AudioVoice voices[AUDIO_MAX_VOICES];
+    f32 masterVolume;
+    f32 masterGain; // as of the end of the last period, ramped toward masterVolume
+    f32 mixBuffers[AUDIO_CHANNELS][AUDIO_PERIOD_FRAMES];
+    f32 voiceBuffers[AUDIO_CHANNELS][AUDIO_PERIOD_FRAMES];
+    s16 output[AUDIO_PERIOD_FRAMES * AUDIO_CHANNELS];
+
+    struct AudioConfig config;
+    FILE *file;
+    char fileBuffer[AUDIO_FILE_BUFFER_SIZE];
+    u64 framesWritten;
+
+    pthread_t thread;
+    _Atomic bool quit;
+
+    struct AudioStats stats;
+};
+
+// Starts the mixer thread. The mixer must stay put until AudioShutdown.
+bool AudioInit(struct AudioMixer *mixer, const struct AudioConfig *config, Allocator *alloc, void *user);
+void AudioShutdown(struct AudioMixer *mixer, Allocator *alloc, void *user);
+
+// Decodes a PCM (8, 16, 24 or 32 bit) or float WAV file, mono or stereo,
+// into `arena`. The clip points into the arena, which has to outlive every
+// voice playing it.
+bool AudioClipLoadWav(struct AudioClip *clip, const char *path, struct Arena *arena);
+
+// Game thread. Returns HANDLE_INVALID when every voice is taken or the
+// command ring is full. `pitch` scales the playback rate on top of the
+// conversion from the clip's sample rate.
+Handle AudioPlay(struct AudioMixer *mixer, const struct AudioClip *clip, f32 volume, f32 pan, f32 pitch, bool loop);
+// Returns false, with the voice still playing and its handle valid, when
+// the command ring is full; try again next frame
+bool AudioStop(struct AudioMixer *mixer, Handle voice);
+void AudioSetVoice(struct AudioMixer *mixer, Handle voice, f32 volume, f32 pan, f32 pitch);
+void AudioSetMasterVolume(struct AudioMixer *mixer, f32 volume);
+
+// Game thread, once per frame: frees the handles of voices that ended
+void AudioUpdate(struct AudioMixer *mixer);
+
+// False once the voice was stopped or, after AudioUpdate, ended on its own
+static inline bool AudioIsPlaying(const struct AudioMixer *mixer, Handle voice)
+{
+    return HandlePoolIsValid(&mixer->handles, voice);
+}
+
+#endif // AUDIO_H
@@ -0,0 +1,254 @@
+// Headless audio mixer benchmark. Plays synthesized engine loops and
+// one-shots through the null backend and prints JSON:
+//
+//   audiobench [output.json] [voices] [capture.wav]
+//
+// "throughput" mixes flat out and reports the cost of a period and how many
+// times faster than real time that is. "latency" keeps real time like a
+// device would while the game side streams commands at it, and reports how
+// long commands wait before the mixer applies them. With a capture path the
+// latency run goes to that WAV file instead, to listen to.
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "common.h"
+#include "allocator.h"
+#include "audio.h"
+
+#define AUDIO_BENCH_DEFAULT_VOICES 64
+#define AUDIO_BENCH_THROUGHPUT_SECONDS 60 // of audio
+#define AUDIO_BENCH_LATENCY_SECONDS 2
+#define AUDIO_BENCH_ARENA_SIZE (8u << 20)
+
+// Engine loops are made at 44.1 kHz so they go through the resampler even
+// unpitched, like most source material would
+#define AUDIO_BENCH_ENGINE_RATE 44100
+#define AUDIO_BENCH_ENGINE_FRAMES 44100
+#define AUDIO_BENCH_HIT_FRAMES 12000
+
+// The game side of the latency run
+#define AUDIO_BENCH_TICK_NS 1000000ull
+#define AUDIO_BENCH_HIT_INTERVAL_TICKS 20
+
+struct AudioBenchClips
+{
+    struct AudioClip engine; // mono, loops
+    struct AudioClip hit;    // stereo one-shot at the output rate
+};
+
+static void SleepFor(u64 nanoseconds)
+{
+    struct timespec wait = {
+        .tv_sec = (time_t)(nanoseconds / 1000000000ull),
+        .tv_nsec = (long)(nanoseconds % 1000000000ull),
+    };
+    nanosleep(&wait, NULL);
+}
+
+static f32 RandomUnit(u32 *seed)
+{
+    *seed = *seed * 1664525u + 1013904223u;
+    return (f32)(*seed >> 8) * (1.0f / 16777216.0f);
+}
+
+static bool MakeClips(struct AudioBenchClips *clips, struct Arena *arena)
+{
+    f32 *engine = ArenaPushArray(arena, f32, AUDIO_BENCH_ENGINE_FRAMES);
+    f32 *hit = ArenaPushArray(arena, f32, 2 * AUDIO_BENCH_HIT_FRAMES);
+    if (!engine || !hit)
+    {
+        return false;
+    }
+
+    // A buzzy 55 Hz loop with a firing pulse, a whole number of cycles so it
+    // loops cleanly
+    for (u32 i = 0; i < AUDIO_BENCH_ENGINE_FRAMES; ++i)
+    {
+        f32 t = (f32)i / AUDIO_BENCH_ENGINE_RATE;
+        f32 phase = fmodf(t * 55.0f, 1.0f);
+        engine[i] = 0.3f * (2.0f * phase - 1.0f) + 0.2f * sinf(t * 2.0f * 3.14159265f * 110.0f) * expf(-8.0f * phase);
+    }
+    clips->engine = (struct AudioClip){
+        .samples = {engine, engine},
+        .channels = 1,
+        .frameCount = AUDIO_BENCH_ENGINE_FRAMES,
+        .sampleRate = AUDIO_BENCH_ENGINE_RATE,
+    };
+
+    // Decaying noise, slightly different per side
+    u32 seed = 1;
+    for (u32 i = 0; i < AUDIO_BENCH_HIT_FRAMES; ++i)
+    {
+        f32 envelope = expf(-(f32)i / (AUDIO_BENCH_HIT_FRAMES / 6));
+        hit[i] = envelope * (2.0f * RandomUnit(&seed) - 1.0f) * 0.5f;
+        hit[AUDIO_BENCH_HIT_FRAMES + i] = envelope * (2.0f * RandomUnit(&seed) - 1.0f) * 0.5f;
+    }
+    clips->hit = (struct AudioClip){
+        .samples = {hit, hit + AUDIO_BENCH_HIT_FRAMES},
+        .channels = 2,
+        .frameCount = AUDIO_BENCH_HIT_FRAMES,
+        .sampleRate = AUDIO_SAMPLE_RATE,
+    };
+    return true;
+}
+
+// Spread over the stereo field and a range of engine speeds
+static void StartEngines(struct AudioMixer *mixer, const struct AudioBenchClips *clips, Handle *engines, u32 count)
+{
+    for (u32 i = 0; i < count; ++i)
+    {
+        f32 pan = count > 1 ? -1.0f + 2.0f * (f32)i / (f32)(count - 1) : 0.0f;
+        f32 pitch = 0.5f + 1.5f * (f32)(i % 16) / 15.0f;
+        engines[i] = AudioPlay(mixer, &clips->engine, 0.5f / sqrtf((f32)count), pan, pitch, true);
+    }
+}
+
+static void PrintStats(FILE *out, const char *name, const struct AudioMixer *mixer, u32 voices, bool last)
+{
+    const struct AudioStats *stats = &mixer->stats;
+    u64 periods = atomic_load(&stats->periods);
+    u64 commands = atomic_load(&stats->commands);
+    f64 mixNs = periods ? (f64)atomic_load(&stats->mixNanoseconds) / (f64)periods : 0.0;
+    f64 periodNs = 1e9 * AUDIO_PERIOD_FRAMES / AUDIO_SAMPLE_RATE;
+
+    fprintf(out, "    {\"name\": \"%s\", \"voices\": %u, \"periods\": %llu, "
+                 "\"mix_us_per_period\": %.2f, \"max_mix_us\": %.2f, \"ns_per_voice_frame\": %.3f, \"realtime_factor\": %.1f, "
+                 "\"commands\": %llu, \"command_latency_us\": %.2f, \"max_command_latency_us\": %.2f, "
+                 "\"late_periods\": %u, \"dropped_commands\": %u}%s\n",
+            name, voices, (unsigned long long)periods,
+            mixNs / 1000.0, (f64)atomic_load(&stats->maxMixNanoseconds) / 1000.0,
+            voices ? mixNs / ((f64)voices * AUDIO_PERIOD_FRAMES) : 0.0, mixNs > 0.0 ? periodNs / mixNs : 0.0,
+            (unsigned long long)commands,
+            commands ? (f64)atomic_load(&stats->commandLatencyNanoseconds) / (f64)commands / 1000.0 : 0.0,
+            (f64)atomic_load(&stats->maxCommandLatencyNanoseconds) / 1000.0,
+            atomic_load(&stats->latePeriods), atomic_load(&stats->droppedCommands), last ? "" : ",");
+}
+
+static bool RunThroughput(FILE *out, const struct AudioBenchClips *clips, u32 voices, Handle *engines)
+{
+    struct AudioMixer *mixer = MemAlloc(DefaultAllocator, sizeof(*mixer));
+    struct AudioConfig config = {.backend = AudioBackend_Null, .realtime = false};
+    if (!mixer || !AudioInit(mixer, &config, DefaultAllocator, NULL))
+    {
+        MemFree(DefaultAllocator, mixer);
+        return false;
+    }
+
+    StartEngines(mixer, clips, engines, voices);
+
+    // Commands are only picked up at period starts, so wait until they all
+    // are and count from there
+    while (atomic_load(&mixer->stats.commands) < voices)
+    {
+        SleepFor(AUDIO_BENCH_TICK_NS);
+    }
+    atomic_store(&mixer->stats.mixNanoseconds, 0);
+    atomic_store(&mixer->stats.maxMixNanoseconds, 0);
+    atomic_store(&mixer->stats.periods, 0);
+
+    u64 target = (u64)AUDIO_BENCH_THROUGHPUT_SECONDS * AUDIO_SAMPLE_RATE / AUDIO_PERIOD_FRAMES;
+    while (atomic_load(&mixer->stats.periods) < target)
+    {
+        SleepFor(AUDIO_BENCH_TICK_NS);
+    }
+
+    AudioShutdown(mixer, DefaultAllocator, NULL);
+    PrintStats(out, "throughput", mixer, voices, false);
+    MemFree(DefaultAllocator, mixer);
+    return true;
+}
+
+static bool RunLatency(FILE *out, const struct AudioBenchClips *clips, u32 voices, Handle *engines, const char *capturePath)
+{
+    struct AudioMixer *mixer = MemAlloc(DefaultAllocator, sizeof(*mixer));
+    struct AudioConfig config = {
+        .backend = capturePath ? AudioBackend_WavFile : AudioBackend_Null,
+        .path = capturePath,
+        .realtime = true,
+    };
+    if (!mixer || !AudioInit(mixer, &config, DefaultAllocator, NULL))
+    {
+        MemFree(DefaultAllocator, mixer);
+        return false;
+    }
+
+    // Leave room for the one-shots
+    u32 engineCount = voices > 8 ? voices - 8 : voices / 2;
+    StartEngines(mixer, clips, engines, engineCount);
+
+    // Every tick revs the engines; every few, something hits
+    u32 seed = 7;
+    u64 ticks = (u64)AUDIO_BENCH_LATENCY_SECONDS * 1000000000ull / AUDIO_BENCH_TICK_NS;
+    for (u64 tick = 0; tick < ticks; ++tick)
+    {
+        AudioUpdate(mixer);
+
+        f32 rev = 0.75f + 0.5f * sinf((f32)tick * 0.005f);
+        for (u32 i = 0; i < engineCount; ++i)
+        {
+            f32 pan = engineCount > 1 ? -1.0f + 2.0f * (f32)i / (f32)(engineCount - 1) : 0.0f;
+            f32 pitch = rev * (0.5f + 1.5f * (f32)(i % 16) / 15.0f);
+            AudioSetVoice(mixer, engines[i], 0.5f / sqrtf((f32)engineCount), pan, pitch);
+        }
+
+        if (tick % AUDIO_BENCH_HIT_INTERVAL_TICKS == 0)
+        {
+            AudioPlay(mixer, &clips->hit, 0.5f, 2.0f * RandomUnit(&seed) - 1.0f, 0.8f + 0.4f * RandomUnit(&seed), false);
+        }
+
+        SleepFor(AUDIO_BENCH_TICK_NS);
+    }
+
+    AudioShutdown(mixer, DefaultAllocator, NULL);
+    PrintStats(out, "latency", mixer, voices, true);
+    MemFree(DefaultAllocator, mixer);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    const char *outputPath = argc > 1 ? argv[1] : NULL;
+    u32 voices = argc > 2 ? (u32)strtoul(argv[2], NULL, 10) : AUDIO_BENCH_DEFAULT_VOICES;
+    const char *capturePath = argc > 3 ? argv[3] : NULL;
+    if (voices == 0 || voices > AUDIO_MAX_VOICES)
+    {
+        fprintf(stderr, "Usage: %s [output.json] [voices, 1 to %u] [capture.wav]\n", argv[0], AUDIO_MAX_VOICES);
+        return 1;
+    }
+
+    void *arenaMemory = MemAlloc(DefaultAllocator, AUDIO_BENCH_ARENA_SIZE);
+    struct Arena arena;
+    ArenaInit(&arena, arenaMemory, AUDIO_BENCH_ARENA_SIZE);
+
+    struct AudioBenchClips clips;
+    if (!arenaMemory || !MakeClips(&clips, &arena))
+    {
+        fprintf(stderr, "Could not make the test clips.\n");
+        return 1;
+    }
+
+    FILE *out = outputPath ? fopen(outputPath, "w") : stdout;
+    if (!out)
+    {
+        fprintf(stderr, "Could not open %s.\n", outputPath);
+        return 1;
+    }
+
+    Handle engines[AUDIO_MAX_VOICES];
+    fprintf(out, "{\n  \"sample_rate\": %u,\n  \"period_frames\": %u,\n  \"scenarios\": [\n",
+            AUDIO_SAMPLE_RATE, AUDIO_PERIOD_FRAMES);
+    bool ok = RunThroughput(out, &clips, voices, engines) &&
+              RunLatency(out, &clips, voices, engines, capturePath);
+    fprintf(out, "  ]\n}\n");
+
+    if (out != stdout)
+    {
+        fclose(out);
+    }
+    MemFree(DefaultAllocator, arenaMemory);
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,714 @@
+// Headless benchmark. Runs scripted sprite workloads for a fixed number of
+// frames against an invisible window and an offscreen framebuffer, then
+// prints frame-time percentiles as JSON:
+//
+//   benchmark [output.json] [frames]
+//
+// Run from the build directory so ./resources.pack is found. Without a
+// display GLFW 3.4 falls back to its null platform (OSMesa, e.g. llvmpipe);
+// with older GLFW use xvfb-run.
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#include <glad/gl.h>
+
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+
+#include <cglm/cglm.h>
+
+#include "common.h"
+#include "allocator.h"
+#include "atlas_sprites.h"
+#include "shaders.h"
+#include "sprite_batch.h"
+#include "asset_pack.h"
+#include "asset_stream.h"
+#include "entity_store.h"
+#include "particles.h"
+#include "spatial_hash.h"
+#include "jobs.h"
+#include "tilemap.h"
+#include "gpu_stream.h"
+#include "gl_state.h"
+#include "render_queue.h"
+#include "camera.h"
+
+#define BENCH_ASSET_PACK_PATH "./resources.pack"
+#define BENCH_WIDTH 1280
+#define BENCH_HEIGHT 720
+#define BENCH_DEFAULT_FRAMES 600
+#define BENCH_WARMUP_FRAMES 30
+#define BENCH_SPRITE_CAPACITY (1u << 16)
+#define BENCH_UPLOAD_BUDGET_PER_FRAME (1u << 20)
+#define BENCH_GPU_STREAM_REGION_SIZE (16u << 20)
+#define BENCH_TICK (1.0f / 60.0f)
+
+// Matches the ortho projection the game renders with
+#define BENCH_WORLD_WIDTH 8.0f
+#define BENCH_WORLD_HEIGHT 6.0f
+
+#define BENCH_RENDER_QUEUE_CAPACITY (1u << 18)
+#define BENCH_PROGRAM_SLOT 0
+
+// Sprites cycle through the vehicle sheet's cells
+#define BENCH_VEHICLE_SPRITES 64
+
+// Entities per job; a multiple of ENTITY_STORE_LANES
+#define BENCH_ENTITY_JOB_BATCH 4096
+
+// Vehicle sized boxes at about three per cell, spread well past the view
+#define BENCH_BROADPHASE_WORLD_WIDTH 200.0f
+#define BENCH_BROADPHASE_WORLD_HEIGHT 150.0f
+#define BENCH_BROADPHASE_ENTITY_SIZE 0.5f
+#define BENCH_BROADPHASE_CELL_SIZE 1.0f
+#define BENCH_BROADPHASE_MAX_PAIRS (1u << 20)
+
+struct BenchContext
+{
+    GLFWwindow *window;
+    GLuint framebuffer;
+    GLuint colorBuffer;
+    GLuint depthBuffer;
+
+    GLuint program;
+
+    struct AssetPack assets;
+    struct AssetStream assetStream;
+    u32 texture; // asset stream handle
+    struct GpuStreamBuffer gpuStream;
+    struct SpriteBatch spriteBatch;
+    struct RenderQueue renderQueue;
+    struct Camera camera;
+    struct JobSystem jobs;
+
+    // Per-scenario state
+    struct SpriteInstance *sprites;
+    u32 spriteCount;
+    struct SpriteInstance *runSprites; // drawn as one run, e.g. particles
+    u32 runSpriteCount;
+    struct ParticleEmitter particles;
+    struct SpatialHash broadphase;
+    struct SpatialPair *pairs;
+    u32 pairCount;
+    struct EntityStore entities;
+    struct Tilemap tilemap;
+    struct AssetPack coldAssets;
+    struct AssetStream coldStream;
+    u32 coldTexture;
+    bool coldLoaded;
+    u32 framesToReady;
+};
+
+struct BenchScenario
+{
+    const char *name;
+    u32 count;
+    void (*Setup)(struct BenchContext *context, u32 count);
+    void (*Update)(struct BenchContext *context);
+    void (*Teardown)(struct BenchContext *context);
+};
+
+struct BenchStats
+{
+    f64 mean;
+    f64 p50;
+    f64 p95;
+    f64 p99;
+    f64 max;
+};
+
+static f64 Now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (f64)now.tv_sec + (f64)now.tv_nsec * 1e-9;
+}
+
+static f32 RandomRange(u32 *seed, f32 min, f32 max)
+{
+    *seed = *seed * 1664525u + 1013904223u;
+    return min + (max - min) * (f32)(*seed >> 8) * (1.0f / 16777216.0f);
+}
+
+static int CompareF64(const void *a, const void *b)
+{
+    f64 x = *(const f64 *)a;
+    f64 y = *(const f64 *)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentiles; sorts `samples`
+static struct BenchStats ComputeStats(f64 *samples, u32 count)
+{
+    struct BenchStats stats = {0};
+    if (count == 0)
+    {
+        return stats;
+    }
+
+    qsort(samples, count, sizeof(*samples), CompareF64);
+
+    f64 sum = 0.0;
+    for (u32 i = 0; i < count; ++i)
+    {
+        sum += samples[i];
+    }
+
+    stats.mean = sum / count;
+    stats.p50 = samples[(count - 1) * 50 / 100];
+    stats.p95 = samples[(count - 1) * 95 / 100];
+    stats.p99 = samples[(count - 1) * 99 / 100];
+    stats.max = samples[count - 1];
+    return stats;
+}
+
+//
+// Scenarios
+//
+
+static void SetupStaticSprites(struct BenchContext *context, u32 count)
+{
+    u32 seed = 1;
+    context->sprites = MemAlloc(DefaultAllocator, count * sizeof(*context->sprites));
+    context->spriteCount = count;
+    for (u32 i = 0; i < count; ++i)
+    {
+        const f32 *uv = spriteRects[Sprite_vehicles_0 + i % BENCH_VEHICLE_SPRITES].uv;
+        context->sprites[i] = (struct SpriteInstance){
+            .position = {RandomRange(&seed, 0.0f, BENCH_WORLD_WIDTH), RandomRange(&seed, 0.0f, BENCH_WORLD_HEIGHT), 0.0f},
+            .scale = 0.05f,
+            .uv = {uv[0], uv[1], uv[2], uv[3]},
+            .tint = {1.0f, 1.0f, 1.0f, 1.0f},
+        };
+    }
+}
+
+static void TeardownSprites(struct BenchContext *context)
+{
+    MemFree(DefaultAllocator, context->sprites);
+    context->sprites = NULL;
+    context->spriteCount = 0;
+}
+
+static void SetupMovingEntities(struct BenchContext *context, u32 count)
+{
+    u32 seed = 2;
+    EntityStoreInit(&context->entities, count, DefaultAllocator, NULL);
+    for (u32 i = 0; i < count; ++i)
+    {
+        struct Entity entity = {
+            .position = {RandomRange(&seed, 0.0f, BENCH_WORLD_WIDTH), RandomRange(&seed, 0.0f, BENCH_WORLD_HEIGHT)},
+            .velocity = {RandomRange(&seed, -1.0f, 1.0f), RandomRange(&seed, -1.0f, 1.0f)},
+            .dimension = {0.05f, 0.05f},
+        };
+        EntityStoreAdd(&context->entities, &entity);
+    }
+
+    context->sprites = MemAlloc(DefaultAllocator, count * sizeof(*context->sprites));
+    context->spriteCount = count;
+}
+
+static void IntegrateEntities(void *data, u32 start, u32 end)
+{
+    struct EntityStore *entities = data;
+    EntityStoreSavePreviousRange(entities, start, end);
+    EntityStoreIntegrateRange(entities, start, end, BENCH_TICK);
+}
+
+static void BuildEntitySprites(void *data, u32 start, u32 end)
+{
+    struct BenchContext *context = data;
+    const struct EntityStore *entities = &context->entities;
+    for (u32 i = start; i < end; ++i)
+    {
+        const f32 *uv = spriteRects[Sprite_vehicles_0 + i % BENCH_VEHICLE_SPRITES].uv;
+        context->sprites[i] = (struct SpriteInstance){
+            .position = {entities->positionX[i], entities->positionY[i], 0.0f},
+            .scale = 0.5f*(entities->dimensionX[i] + entities->dimensionY[i]),
+            .uv = {uv[0], uv[1], uv[2], uv[3]},
+            .tint = {1.0f, 1.0f, 1.0f, 1.0f},
+        };
+    }
+}
+
+static void UpdateMovingEntities(struct BenchContext *context)
+{
+    JobParallelFor(&context->jobs, context->entities.count, BENCH_ENTITY_JOB_BATCH, IntegrateEntities, &context->entities);
+    JobParallelFor(&context->jobs, context->entities.count, BENCH_ENTITY_JOB_BATCH, BuildEntitySprites, context);
+}
+
+static void TeardownMovingEntities(struct BenchContext *context)
+{
+    EntityStoreFree(&context->entities, DefaultAllocator, NULL);
+    TeardownSprites(context);
+}
+
+// A fresh mapping and stream, so the texture goes through read, decode and
+// upload from scratch. The pack's pages are dropped from our own mapping
+// first, since the kernel won't evict pages that are still mapped, and
+// then from the page cache, so the read comes from the disk as it would
+// on a first run. Other processes holding the pack mapped can still keep
+// some of it cached.
+static void SetupColdLoad(struct BenchContext *context, u32 count)
+{
+    SetupStaticSprites(context, count);
+
+    madvise((void *)context->assets.data, context->assets.size, MADV_DONTNEED);
+    int fd = open(BENCH_ASSET_PACK_PATH, O_RDONLY);
+    if (fd >= 0)
+    {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+
+    if (!AssetPackOpen(&context->coldAssets, BENCH_ASSET_PACK_PATH))
+    {
+        fprintf(stderr, "Could not reopen %s for the cold load.\n", BENCH_ASSET_PACK_PATH);
+    }
+    AssetStreamInit(&context->coldStream, &context->coldAssets, 2, true);
+    context->coldTexture = AssetStreamRequestTexture(&context->coldStream, spriteAtlasPages[0]);
+    context->coldLoaded = false;
+    context->framesToReady = 0;
+}
+
+static void UpdateColdLoad(struct BenchContext *context)
+{
+    AssetStreamUpdate(&context->coldStream, BENCH_UPLOAD_BUDGET_PER_FRAME);
+    if (!context->coldLoaded)
+    {
+        context->framesToReady += 1;
+        context->coldLoaded = AssetStreamIsReady(&context->coldStream, context->coldTexture);
+    }
+}
+
+static void TeardownColdLoad(struct BenchContext *context)
+{
+    AssetStreamShutdown(&context->coldStream);
+    AssetPackClose(&context->coldAssets);
+    TeardownSprites(context);
+}
+
+// `count` is the map's side in tiles; only the few chunks on screen get drawn
+static void SetupTilemap(struct BenchContext *context, u32 count)
+{
+    TilemapInit(&context->tilemap, count, count, 0.25f, DefaultAllocator, NULL);
+    context->tilemap.palette = &spriteRects[Sprite_vehicles_0];
+    for (u32 y = 0; y < count; ++y)
+    {
+        for (u32 x = 0; x < count; ++x)
+        {
+            TilemapSet(&context->tilemap, x, y, (Tile)(1 + (x ^ y) % 64));
+        }
+    }
+}
+
+static void TeardownTilemap(struct BenchContext *context)
+{
+    TilemapFree(&context->tilemap, DefaultAllocator, NULL);
+}
+
+// One emitter kept at about `count` live particles: spawned, simulated,
+// compacted and drawn as a single run every frame
+static void SetupParticles(struct BenchContext *context, u32 count)
+{
+    struct ParticleEmitter *emitter = &context->particles;
+    ParticleEmitterInit(emitter, count, 3, DefaultAllocator, NULL);
+    emitter->position[0] = 0.5f*BENCH_WORLD_WIDTH;
+    emitter->position[1] = 0.5f*BENCH_WORLD_HEIGHT;
+    emitter->positionJitter = 0.5f;
+    emitter->spread = 3.14159265f;
+    emitter->speedMin = 0.2f;
+    emitter->speedMax = 2.0f;
+    emitter->lifetimeMin = 1.0f;
+    emitter->lifetimeMax = 2.0f;
+    emitter->rate = (f32)count / 1.5f; // mean lifetime
+    emitter->sizeMin = 0.01f;
+    emitter->sizeMax = 0.04f;
+    emitter->acceleration[1] = -0.5f;
+    emitter->drag = 0.5f;
+
+    // Run up to the steady state before measuring
+    for (u32 i = 0; i < 180; ++i)
+    {
+        ParticleEmitterUpdate(emitter, BENCH_TICK);
+    }
+
+    context->runSprites = MemAlloc(DefaultAllocator, emitter->pool.capacity * sizeof(*context->runSprites));
+}
+
+static void UpdateParticles(struct BenchContext *context)
+{
+    struct ParticleEmitter *emitter = &context->particles;
+    ParticleEmitterUpdate(emitter, BENCH_TICK);
+    context->runSpriteCount = ParticleBuildSprites(&emitter->pool, spriteRects, context->runSprites, emitter->pool.capacity, 0.0f);
+}
+
+static void TeardownParticles(struct BenchContext *context)
+{
+    ParticleEmitterFree(&context->particles, DefaultAllocator, NULL);
+    MemFree(DefaultAllocator, context->runSprites);
+    context->runSprites = NULL;
+    context->runSpriteCount = 0;
+}
+
+// Integrates, rebuilds the grid and finds every overlapping pair each
+// frame. Nothing is drawn, so update_ms is the broadphase's cost.
+static void SetupBroadphase(struct BenchContext *context, u32 count)
+{
+    u32 seed = 4;
+    EntityStoreInit(&context->entities, count, DefaultAllocator, NULL);
+    for (u32 i = 0; i < count; ++i)
+    {
+        struct Entity entity = {
+            .position = {RandomRange(&seed, 0.0f, BENCH_BROADPHASE_WORLD_WIDTH), RandomRange(&seed, 0.0f, BENCH_BROADPHASE_WORLD_HEIGHT)},
+            .velocity = {RandomRange(&seed, -1.0f, 1.0f), RandomRange(&seed, -1.0f, 1.0f)},
+            .dimension = {BENCH_BROADPHASE_ENTITY_SIZE, BENCH_BROADPHASE_ENTITY_SIZE},
+        };
+        EntityStoreAdd(&context->entities, &entity);
+    }
+
+    SpatialHashInit(&context->broadphase, count, BENCH_BROADPHASE_CELL_SIZE, DefaultAllocator, NULL);
+    context->pairs = MemAlloc(DefaultAllocator, BENCH_BROADPHASE_MAX_PAIRS * sizeof(*context->pairs));
+}
+
+static void UpdateBroadphase(struct BenchContext *context)
+{
+    struct EntityStore *entities = &context->entities;
+    JobParallelFor(&context->jobs, entities->count, BENCH_ENTITY_JOB_BATCH, IntegrateEntities, entities);
+
+    SpatialHashBuild(&context->broadphase, entities->count, entities->positionX, entities->positionY,
+                     entities->dimensionX, entities->dimensionY);
+    context->pairCount = SpatialHashOverlapPairs(&context->broadphase, context->pairs, BENCH_BROADPHASE_MAX_PAIRS);
+}
+
+static void TeardownBroadphase(struct BenchContext *context)
+{
+    SpatialHashFree(&context->broadphase, DefaultAllocator, NULL);
+    EntityStoreFree(&context->entities, DefaultAllocator, NULL);
+    MemFree(DefaultAllocator, context->pairs);
+    context->pairs = NULL;
+    context->pairCount = 0;
+}
+
+static const struct BenchScenario scenarios[] = {
+    {"static_sprites", 100000, SetupStaticSprites, NULL, TeardownSprites},
+    {"moving_entities", 100000, SetupMovingEntities, UpdateMovingEntities, TeardownMovingEntities},
+    {"asset_cold_load", 1000, SetupColdLoad, UpdateColdLoad, TeardownColdLoad},
+    {"tilemap", 2048, SetupTilemap, NULL, TeardownTilemap},
+    {"particles", 100000, SetupParticles, UpdateParticles, TeardownParticles},
+    {"broadphase", 100000, SetupBroadphase, UpdateBroadphase, TeardownBroadphase},
+};
+
+//
+// Harness
+//
+
+static bool CreateContext(struct BenchContext *context)
+{
+#ifdef GLFW_PLATFORM_NULL
+    if (!getenv("DISPLAY") && !getenv("WAYLAND_DISPLAY"))
+    {
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+    }
+#endif
+
+    if (!glfwInit())
+    {
+        return false;
+    }
+
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+
+    context->window = glfwCreateWindow(BENCH_WIDTH, BENCH_HEIGHT, "Fejnando benchmark", NULL, NULL);
+    if (!context->window)
+    {
+        // No native GL; try Mesa's software rasterizer
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+        context->window = glfwCreateWindow(BENCH_WIDTH, BENCH_HEIGHT, "Fejnando benchmark", NULL, NULL);
+    }
+    if (!context->window)
+    {
+        return false;
+    }
+
+    glfwMakeContextCurrent(context->window);
+    glfwSwapInterval(0);
+    if (!gladLoadGL(glfwGetProcAddress))
+    {
+        return false;
+    }
+
+    // Hidden windows may not own their pixels, so render into our own target
+    glGenRenderbuffers(1, &context->colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, context->colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, BENCH_WIDTH, BENCH_HEIGHT);
+    glGenRenderbuffers(1, &context->depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, context->depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, BENCH_WIDTH, BENCH_HEIGHT);
+
+    glGenFramebuffers(1, &context->framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, context->framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, context->colorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, context->depthBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        return false;
+    }
+
+    glViewport(0, 0, BENCH_WIDTH, BENCH_HEIGHT);
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    return true;
+}
+
+static bool LoadResources(struct BenchContext *context)
+{
+    if (!AssetPackOpen(&context->assets, BENCH_ASSET_PACK_PATH))
+    {
+        fprintf(stderr, "Could not open %s.\n", BENCH_ASSET_PACK_PATH);
+        return false;
+    }
+
+    const struct AssetPackEntry *vertexShader = AssetPackFind(&context->assets, "sprite_sheet.shader.vert");
+    const struct AssetPackEntry *fragmentShader = AssetPackFind(&context->assets, "sprite_sheet.shader.frag");
+    if (!vertexShader || !fragmentShader)
+    {
+        fprintf(stderr, "Sprite sheet shaders are missing from %s.\n", BENCH_ASSET_PACK_PATH);
+        return false;
+    }
+
+    context->program = CompileShaders((u8 *)AssetPackData(&context->assets, vertexShader),
+                                      (u8 *)AssetPackData(&context->assets, fragmentShader));
+    if (!context->program)
+    {
+        return false;
+    }
+
+    RenderQueueInit(&context->renderQueue, BENCH_RENDER_QUEUE_CAPACITY, DefaultAllocator, NULL);
+    struct RenderProgram program = {
+        .program = context->program,
+        .multiplyColorLocation = glGetUniformLocation(context->program, "multiplyColor"),
+    };
+    RenderQueueSetProgram(&context->renderQueue, BENCH_PROGRAM_SLOT, &program);
+    CameraBindProgram(context->program);
+
+    // Keep the world rectangle fixed rather than following the target's
+    // aspect, so results stay comparable
+    CameraInit(&context->camera, BENCH_WORLD_HEIGHT);
+    context->camera.position[0] = 0.5f*BENCH_WORLD_WIDTH;
+    context->camera.position[1] = 0.5f*BENCH_WORLD_HEIGHT;
+    context->camera.aspect = BENCH_WORLD_WIDTH / BENCH_WORLD_HEIGHT;
+
+    // The steady-state scenarios shouldn't measure streaming, so finish it up front
+    if (!AssetStreamInit(&context->assetStream, &context->assets, 2, true))
+    {
+        return false;
+    }
+    context->texture = AssetStreamRequestTexture(&context->assetStream, spriteAtlasPages[0]);
+    while (!AssetStreamIsReady(&context->assetStream, context->texture))
+    {
+        AssetStreamUpdate(&context->assetStream, SIZE_MAX);
+    }
+
+    if (!GpuStreamInit(&context->gpuStream, BENCH_GPU_STREAM_REGION_SIZE, glfwGetProcAddress))
+    {
+        return false;
+    }
+    SpriteBatchInit(&context->spriteBatch, BENCH_SPRITE_CAPACITY, DefaultAllocator, NULL);
+    context->spriteBatch.stream = &context->gpuStream;
+    if (!JobSystemInit(&context->jobs, 0))
+    {
+        return false;
+    }
+    JobRegisterSubmitThread();
+    return true;
+}
+
+// Same path as the game's Render(): everything goes through the render queue
+static void DrawSprites(struct BenchContext *context, u32 texture)
+{
+    GLStateInvalidate();
+    GpuStreamBeginFrame(&context->gpuStream);
+
+    GLStateSetDepthWrite(true);
+    glClearColor(0.3f, 0.3f, 0.3f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    CameraUpdate(&context->camera);
+
+    struct RenderQueue *queue = &context->renderQueue;
+    RenderQueueReset(queue);
+
+    if (context->tilemap.chunks)
+    {
+        u64 key = RenderKeyOpaque(0, BENCH_PROGRAM_SLOT, texture, 0.5f);
+        TilemapSubmit(&context->tilemap, queue, key, BENCH_PROGRAM_SLOT, texture, 0.0f, 0.0f, BENCH_WORLD_WIDTH, BENCH_WORLD_HEIGHT);
+    }
+
+    for (u32 i = 0; i < context->spriteCount; ++i)
+    {
+        struct RenderCommand command = {
+            .kind = RenderCommand_Sprite,
+            .program = BENCH_PROGRAM_SLOT,
+            .texture = texture,
+            .sprite = context->sprites[i],
+        };
+        RenderQueuePush(queue, RenderKeyTranslucent(0, BENCH_PROGRAM_SLOT, texture, 0.1f), &command);
+    }
+
+    if (context->runSpriteCount > 0)
+    {
+        struct RenderCommand command = {
+            .kind = RenderCommand_SpriteRun,
+            .program = BENCH_PROGRAM_SLOT,
+            .texture = texture,
+            .run = {context->runSprites, context->runSpriteCount},
+        };
+        RenderQueuePush(queue, RenderKeyTranslucent(0, BENCH_PROGRAM_SLOT, texture, 0.1f), &command);
+    }
+
+    RenderQueueSort(queue);
+    RenderQueueExecute(queue, &context->spriteBatch);
+
+    GpuStreamEndFrame(&context->gpuStream);
+}
+
+static void PrintStats(FILE *out, const char *name, struct BenchStats stats)
+{
+    fprintf(out, "      \"%s\": {\"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f}",
+            name, stats.mean, stats.p50, stats.p95, stats.p99, stats.max);
+}
+
+static void RunScenario(struct BenchContext *context, const struct BenchScenario *scenario, u32 frameCount, FILE *out, bool last)
+{
+    f64 *frameTimes = MemAlloc(DefaultAllocator, frameCount * sizeof(f64));
+    f64 *updateTimes = MemAlloc(DefaultAllocator, frameCount * sizeof(f64));
+    u64 drawCalls = 0;
+    u64 glCalls = 0;
+    u64 glCallsSkipped = 0;
+
+    scenario->Setup(context, scenario->count);
+    bool coldLoad = scenario->Setup == SetupColdLoad;
+
+    // The cold load has to be measured from its very first frame
+    u32 warmupFrames = coldLoad ? 0 : BENCH_WARMUP_FRAMES;
+    for (u32 frame = 0; frame < warmupFrames + frameCount; ++frame)
+    {
+        f64 frameStart = Now();
+        if (scenario->Update)
+        {
+            scenario->Update(context);
+        }
+        f64 updateEnd = Now();
+
+        u32 texture = coldLoad ? AssetStreamGetTexture(&context->coldStream, context->coldTexture)
+                               : AssetStreamGetTexture(&context->assetStream, context->texture);
+        context->spriteBatch.drawCalls = 0;
+        context->tilemap.drawCalls = 0;
+        GLStateResetStats();
+        DrawSprites(context, texture);
+
+        // Include the GPU's share of the frame
+        glFinish();
+        f64 frameEnd = Now();
+
+        if (frame >= warmupFrames)
+        {
+            frameTimes[frame - warmupFrames] = (frameEnd - frameStart) * 1000.0;
+            updateTimes[frame - warmupFrames] = (updateEnd - frameStart) * 1000.0;
+            drawCalls += context->spriteBatch.drawCalls + context->tilemap.drawCalls;
+            struct GLStateStats stats = GLStateGetStats();
+            glCalls += stats.calls;
+            glCallsSkipped += stats.skipped;
+        }
+    }
+
+    fprintf(out, "    {\n      \"name\": \"%s\",\n      \"count\": %u,\n      \"frames\": %u,\n",
+            scenario->name, scenario->count, frameCount);
+    PrintStats(out, "frame_ms", ComputeStats(frameTimes, frameCount));
+    fprintf(out, ",\n");
+    PrintStats(out, "update_ms", ComputeStats(updateTimes, frameCount));
+    fprintf(out, ",\n      \"draw_calls_per_frame\": %.2f", (f64)drawCalls / frameCount);
+    fprintf(out, ",\n      \"gl_calls_per_frame\": %.2f", (f64)glCalls / frameCount);
+    fprintf(out, ",\n      \"gl_calls_skipped_per_frame\": %.2f", (f64)glCallsSkipped / frameCount);
+    if (coldLoad)
+    {
+        fprintf(out, ",\n      \"frames_to_ready\": %d", context->coldLoaded ? (s32)context->framesToReady : -1);
+    }
+    fprintf(out, "\n    }%s\n", last ? "" : ",");
+
+    scenario->Teardown(context);
+    MemFree(DefaultAllocator, frameTimes);
+    MemFree(DefaultAllocator, updateTimes);
+}
+
+int main(int argc, char **argv)
+{
+    const char *outputPath = argc > 1 ? argv[1] : NULL;
+    u32 frameCount = argc > 2 ? (u32)strtoul(argv[2], NULL, 10) : BENCH_DEFAULT_FRAMES;
+    if (frameCount == 0)
+    {
+        fprintf(stderr, "Usage: %s [output.json] [frames]\n", argv[0]);
+        return 1;
+    }
+
+    struct BenchContext *context = MemZeroAlloc(DefaultAllocator, sizeof(*context));
+    if (!CreateContext(context))
+    {
+        fprintf(stderr, "Could not create an OpenGL 3.3 context.\n");
+        glfwTerminate();
+        return 1;
+    }
+    if (!LoadResources(context))
+    {
+        glfwTerminate();
+        return 1;
+    }
+
+    FILE *out = outputPath ? fopen(outputPath, "w") : stdout;
+    if (!out)
+    {
+        fprintf(stderr, "Could not open %s.\n", outputPath);
+        glfwTerminate();
+        return 1;
+    }
+
+    fprintf(out, "{\n  \"renderer\": \"%s\",\n  \"width\": %d,\n  \"height\": %d,\n  \"threads\": %u,\n  \"persistent_mapping\": %s,\n  \"scenarios\": [\n",
+            (const char *)glGetString(GL_RENDERER), BENCH_WIDTH, BENCH_HEIGHT, context->jobs.threadCount,
+            context->gpuStream.persistent ? "true" : "false");
+    for (u32 i = 0; i < ARRAY_LEN(scenarios); ++i)
+    {
+        RunScenario(context, &scenarios[i], frameCount, out, i + 1 == ARRAY_LEN(scenarios));
+    }
+    fprintf(out, "  ]\n}\n");
+
+    if (out != stdout)
+    {
+        fclose(out);
+    }
+
+    SpriteBatchFree(&context->spriteBatch, DefaultAllocator, NULL);
+    RenderQueueFree(&context->renderQueue, DefaultAllocator, NULL);
+    GpuStreamFree(&context->gpuStream);
+    JobSystemShutdown(&context->jobs);
+    AssetStreamShutdown(&context->assetStream);
+    glDeleteProgram(context->program);
+    glDeleteFramebuffers(1, &context->framebuffer);
+    glDeleteRenderbuffers(1, &context->colorBuffer);
+    glDeleteRenderbuffers(1, &context->depthBuffer);
+    AssetPackClose(&context->assets);
+    glfwTerminate();
+    MemFree(DefaultAllocator, context);
+
+    return 0;
+}
@@ -0,0 +1,90 @@
+#include "camera.h"
+#include <string.h>
+#include <glad/gl.h>
+
+#define CAMERA_DEFAULT_DISTANCE 10.0f
+#define CAMERA_DEFAULT_NEAR_Z 0.1f
+#define CAMERA_DEFAULT_FAR_Z 100.0f
+
+// std140 layout of the Camera block
+struct CameraUniforms
+{
+    f32 viewProjection[16];
+};
+
+void CameraInit(struct Camera *camera, f32 viewHeight)
+{
+    memset(camera, 0, sizeof(*camera));
+    camera->zoom = 1.0f;
+    camera->viewHeight = viewHeight;
+    camera->aspect = 1.0f;
+    camera->distance = CAMERA_DEFAULT_DISTANCE;
+    camera->nearZ = CAMERA_DEFAULT_NEAR_Z;
+    camera->farZ = CAMERA_DEFAULT_FAR_Z;
+    glm_mat4_identity(camera->viewProjection);
+
+    glGenBuffers(1, &camera->uniformBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, camera->uniformBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(struct CameraUniforms), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void CameraFree(struct Camera *camera)
+{
+    glDeleteBuffers(1, &camera->uniformBuffer);
+    camera->uniformBuffer = 0;
+}
+
+void CameraSetViewport(struct Camera *camera, s32 width, s32 height)
+{
+    if (width > 0 && height > 0)
+    {
+        camera->aspect = (f32)width / (f32)height;
+    }
+}
+
+void CameraVisibleRect(const struct Camera *camera, f32 *minX, f32 *minY, f32 *maxX, f32 *maxY)
+{
+    f32 halfHeight = 0.5f * camera->viewHeight / camera->zoom;
+    f32 halfWidth = halfHeight * camera->aspect;
+    *minX = camera->position[0] - halfWidth;
+    *maxX = camera->position[0] + halfWidth;
+    *minY = camera->position[1] - halfHeight;
+    *maxY = camera->position[1] + halfHeight;
+}
+
+f32 CameraDepthOf(const struct Camera *camera, f32 z)
+{
+    return (camera->distance - z - camera->nearZ) / (camera->farZ - camera->nearZ);
+}
+
+void CameraUpdate(struct Camera *camera)
+{
+    // The pan folds into the ortho bounds, leaving the view matrix a pull
+    // back along z
+    f32 minX, minY, maxX, maxY;
+    CameraVisibleRect(camera, &minX, &minY, &maxX, &maxY);
+
+    glm_ortho(minX, maxX, minY, maxY, camera->nearZ, camera->farZ, camera->viewProjection);
+    glm_translate(camera->viewProjection, (vec3){0.0f, 0.0f, -camera->distance});
+
+    struct CameraUniforms uniforms;
+    memcpy(uniforms.viewProjection, camera->viewProjection, sizeof(uniforms.viewProjection));
+
+    // Orphan, so this frame doesn't wait on last frame's draws reading it
+    glBindBuffer(GL_UNIFORM_BUFFER, camera->uniformBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(uniforms), NULL, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(uniforms), &uniforms);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_UNIFORM_BINDING, camera->uniformBuffer);
+}
+
+void CameraBindProgram(u32 program)
+{
+    GLuint blockIndex = glGetUniformBlockIndex(program, "Camera");
+    if (blockIndex != GL_INVALID_INDEX)
+    {
+        glUniformBlockBinding(program, blockIndex, CAMERA_UNIFORM_BINDING);
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+// 2D orthographic camera looking down -z. The view-projection matrix is
+// computed once per frame and uploaded into a uniform block that every
+// program using it reads from the same binding point:
+//
+//   layout (std140) uniform Camera { mat4 viewProjection; };
+//
+// Sprites only carry position and scale; the vertex shader does the rest.
+
+#include <cglm/cglm.h>
+
+#include "common.h"
+
+#define CAMERA_UNIFORM_BINDING 0
+
+struct Camera
+{
+    f32 position[2]; // world point at the center of the viewport
+    f32 zoom;        // 2 shows half as much of the world
+    f32 viewHeight;  // world units visible vertically at zoom 1
+    f32 aspect;      // viewport width / height
+
+    f32 distance; // from the z = 0 plane
+    f32 nearZ;
+    f32 farZ;
+
+    mat4 viewProjection;
+    u32 uniformBuffer;
+};
+
+// Needs a current GL context
+void CameraInit(struct Camera *camera, f32 viewHeight);
+void CameraFree(struct Camera *camera);
+
+void CameraSetViewport(struct Camera *camera, s32 width, s32 height);
+
+// Recomputes the view-projection matrix and uploads it to the uniform
+// block. Call once per frame, before drawing.
+void CameraUpdate(struct Camera *camera);
+
+// World rectangle the viewport shows, for culling
+void CameraVisibleRect(const struct Camera *camera, f32 *minX, f32 *minY, f32 *maxX, f32 *maxY);
+// Normalized distance from the camera of something at world height `z`,
+// 0 at the near plane
+f32 CameraDepthOf(const struct Camera *camera, f32 z);
+
+// Points `program`'s Camera uniform block at the camera's binding. Call
+// whenever the program is (re)linked; GL 3.3 can't set it in the shader.
+void CameraBindProgram(u32 program);
+
+#endif // CAMERA_H
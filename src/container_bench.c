@@ -0,0 +1,377 @@
+// Container micro-benchmarks. Times the growable array, hash map and handle
+// pool against the naive code they replace, and prints nanoseconds per
+// operation as JSON:
+//
+//   containerbench [output.json] [items]
+//
+// Each case runs a few times and keeps the fastest, which is the one least
+// disturbed by the rest of the machine.
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "common.h"
+#include "allocator.h"
+#include "array.h"
+#include "hash_map.h"
+#include "handle_pool.h"
+
+#define CONTAINER_BENCH_DEFAULT_ITEMS (1u << 20)
+#define CONTAINER_BENCH_REPEATS 5
+
+// Live handles while the pools churn, as a share of the capacity
+#define CONTAINER_BENCH_POOL_LIVE_SHARE 0.9
+
+static volatile u64 sink;
+
+static f64 Now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (f64)now.tv_sec + (f64)now.tv_nsec * 1e-9;
+}
+
+static u64 NextRandom(u64 *state)
+{
+    // xorshift64*
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1Dull;
+}
+
+struct ContainerBenchCase
+{
+    const char *name;
+    const char *baseline;
+    // Both return the operation count of one run
+    u64 (*Run)(u32 items);
+    u64 (*RunBaseline)(u32 items);
+};
+
+// Arrays
+
+static u64 RunArrayPush(u32 items)
+{
+    ARRAY_OF(u32) array;
+    ArrayInit(&array, DefaultAllocator, NULL);
+    for (u32 i = 0; i < items; ++i)
+    {
+        ArrayPush(&array, i);
+    }
+
+    sink = array.items[items / 2];
+    ArrayFree(&array);
+    return items;
+}
+
+// What every subsystem ends up writing: grow by exactly what is needed
+static u64 RunArrayPushNaive(u32 items)
+{
+    u32 *array = NULL;
+    u32 count = 0;
+    for (u32 i = 0; i < items; ++i)
+    {
+        array = MemRealloc(DefaultAllocator, (count + 1) * sizeof(u32), count * sizeof(u32), array);
+        array[count++] = i;
+    }
+
+    sink = array[items / 2];
+    MemFree(DefaultAllocator, array);
+    return items;
+}
+
+// Hash maps. Every run inserts `items` random keys, looks each up once,
+// misses as often, then removes half.
+
+struct ChainNode
+{
+    u64 key;
+    u32 value;
+    struct ChainNode *next;
+};
+
+struct ChainedMap
+{
+    struct ChainNode **buckets;
+    u32 bucketCount;
+};
+
+static struct ChainNode **ChainedFind(struct ChainedMap *map, u64 key)
+{
+    struct ChainNode **link = &map->buckets[key % map->bucketCount];
+    while (*link && (*link)->key != key)
+    {
+        link = &(*link)->next;
+    }
+    return link;
+}
+
+static u64 RunHashMap(u32 items)
+{
+    struct HashMap map;
+    HashMapInit(&map, 0, DefaultAllocator, NULL);
+
+    u64 state = 0x9E3779B97F4A7C15ull;
+    for (u32 i = 0; i < items; ++i)
+    {
+        HashMapPut(&map, NextRandom(&state), i);
+    }
+
+    u64 found = 0;
+    u32 value;
+    state = 0x9E3779B97F4A7C15ull;
+    for (u32 i = 0; i < items; ++i)
+    {
+        found += HashMapGet(&map, NextRandom(&state), &value);
+    }
+    u64 missState = 0xD1B54A32D192ED03ull;
+    for (u32 i = 0; i < items; ++i)
+    {
+        found += HashMapGet(&map, NextRandom(&missState), &value);
+    }
+
+    state = 0x9E3779B97F4A7C15ull;
+    for (u32 i = 0; i < items; i += 2)
+    {
+        found += HashMapRemove(&map, NextRandom(&state));
+        NextRandom(&state);
+    }
+
+    sink = found + map.count;
+    HashMapFree(&map);
+    return 3ull * items + items / 2;
+}
+
+// Separate chaining with a node allocation per item and a modulo per probe;
+// the bucket array is sized up front, which flatters it
+static u64 RunHashMapNaive(u32 items)
+{
+    struct ChainedMap map = {
+        .buckets = MemZeroAlloc(DefaultAllocator, items * sizeof(struct ChainNode *)),
+        .bucketCount = items,
+    };
+
+    u64 state = 0x9E3779B97F4A7C15ull;
+    for (u32 i = 0; i < items; ++i)
+    {
+        u64 key = NextRandom(&state);
+        struct ChainNode **link = ChainedFind(&map, key);
+        if (!*link)
+        {
+            *link = MemAlloc(DefaultAllocator, sizeof(struct ChainNode));
+            (*link)->key = key;
+            (*link)->next = NULL;
+        }
+        (*link)->value = i;
+    }
+
+    u64 found = 0;
+    state = 0x9E3779B97F4A7C15ull;
+    for (u32 i = 0; i < items; ++i)
+    {
+        found += *ChainedFind(&map, NextRandom(&state)) != NULL;
+    }
+    u64 missState = 0xD1B54A32D192ED03ull;
+    for (u32 i = 0; i < items; ++i)
+    {
+        found += *ChainedFind(&map, NextRandom(&missState)) != NULL;
+    }
+
+    state = 0x9E3779B97F4A7C15ull;
+    for (u32 i = 0; i < items; i += 2)
+    {
+        struct ChainNode **link = ChainedFind(&map, NextRandom(&state));
+        NextRandom(&state);
+        if (*link)
+        {
+            struct ChainNode *node = *link;
+            *link = node->next;
+            MemFree(DefaultAllocator, node);
+            found += 1;
+        }
+    }
+
+    for (u32 b = 0; b < map.bucketCount; ++b)
+    {
+        struct ChainNode *node = map.buckets[b];
+        while (node)
+        {
+            struct ChainNode *next = node->next;
+            MemFree(DefaultAllocator, node);
+            node = next;
+        }
+    }
+    MemFree(DefaultAllocator, map.buckets);
+
+    sink = found;
+    return 3ull * items + items / 2;
+}
+
+// Handle pools. Fill to the live share, then release a random live handle,
+// allocate a new one and validate another, `items` times over.
+
+static u64 RunHandlePool(u32 items)
+{
+    u32 capacity = items < HANDLE_MAX_CAPACITY ? items : HANDLE_MAX_CAPACITY;
+    u32 liveCount = (u32)(capacity * CONTAINER_BENCH_POOL_LIVE_SHARE);
+
+    struct HandlePool pool;
+    HandlePoolInit(&pool, capacity, DefaultAllocator, NULL);
+    Handle *live = MemAlloc(DefaultAllocator, liveCount * sizeof(Handle));
+    for (u32 i = 0; i < liveCount; ++i)
+    {
+        live[i] = HandlePoolAlloc(&pool);
+    }
+
+    u64 state = 0x9E3779B97F4A7C15ull;
+    u64 valid = 0;
+    for (u32 i = 0; i < items; ++i)
+    {
+        u32 victim = (u32)(NextRandom(&state) % liveCount);
+        HandlePoolRelease(&pool, live[victim]);
+        live[victim] = HandlePoolAlloc(&pool);
+        valid += HandlePoolIsValid(&pool, live[(u32)(NextRandom(&state) % liveCount)]);
+    }
+
+    sink = valid;
+    MemFree(DefaultAllocator, live);
+    HandlePoolFree(&pool, DefaultAllocator, NULL);
+    return 3ull * items;
+}
+
+// The same generation scheme without the free list: a slot is found by
+// scanning for an even generation. Next fit, the usual improvement over
+// always scanning from zero, keeps the scans short until the pool fills up.
+static u64 RunHandlePoolNaive(u32 items)
+{
+    u32 capacity = items < HANDLE_MAX_CAPACITY ? items : HANDLE_MAX_CAPACITY;
+    u32 liveCount = (u32)(capacity * CONTAINER_BENCH_POOL_LIVE_SHARE);
+
+    u32 *generations = MemZeroAlloc(DefaultAllocator, capacity * sizeof(u32));
+    Handle *live = MemAlloc(DefaultAllocator, liveCount * sizeof(Handle));
+    u32 searchFrom = 0;
+    for (u32 i = 0; i < liveCount; ++i)
+    {
+        generations[i] = 1;
+        live[i] = (1u << HANDLE_INDEX_BITS) | i;
+    }
+
+    u64 state = 0x9E3779B97F4A7C15ull;
+    u64 valid = 0;
+    for (u32 i = 0; i < items; ++i)
+    {
+        u32 victim = (u32)(NextRandom(&state) % liveCount);
+        generations[HandleIndex(live[victim])] += 1;
+
+        u32 slot = searchFrom;
+        while (generations[slot] & 1)
+        {
+            slot = slot + 1 < capacity ? slot + 1 : 0;
+        }
+        u32 generation = ++generations[slot];
+        live[victim] = (generation << HANDLE_INDEX_BITS) | slot;
+        searchFrom = slot;
+
+        Handle check = live[(u32)(NextRandom(&state) % liveCount)];
+        valid += generations[HandleIndex(check)] == HandleGeneration(check);
+    }
+
+    sink = valid;
+    MemFree(DefaultAllocator, live);
+    MemFree(DefaultAllocator, generations);
+    return 3ull * items;
+}
+
+static const struct ContainerBenchCase cases[] = {
+    {"array_push", "realloc_per_push", RunArrayPush, RunArrayPushNaive},
+    {"hash_map", "chained_nodes", RunHashMap, RunHashMapNaive},
+    {"handle_pool", "next_fit_scan", RunHandlePool, RunHandlePoolNaive},
+};
+
+// Cheap checks of the behavior the timings take for granted, run before
+// anything is timed. Returns false and says which one failed.
+static bool CheckContainers(void)
+{
+    struct HandlePool pool;
+    HandlePoolInit(&pool, 4, DefaultAllocator, NULL);
+
+    // A fresh pool: every slot free, so nothing validates, HANDLE_INVALID
+    // least of all, and releasing it must not disturb the free list
+    bool ok = !HandlePoolIsValid(&pool, HANDLE_INVALID) && !HandlePoolRelease(&pool, HANDLE_INVALID) &&
+              pool.count == 0;
+    u32 allocated = 0;
+    while (HandlePoolAlloc(&pool) != HANDLE_INVALID)
+    {
+        allocated += 1;
+    }
+    ok = ok && allocated == 4;
+    HandlePoolFree(&pool, DefaultAllocator, NULL);
+
+    if (!ok)
+    {
+        fprintf(stderr, "Handle pool accepts HANDLE_INVALID or lost free slots.\n");
+    }
+    return ok;
+}
+
+// Best nanoseconds per operation over the repeats
+static f64 Measure(u64 (*Run)(u32 items), u32 items)
+{
+    f64 best = 0.0;
+    for (u32 r = 0; r < CONTAINER_BENCH_REPEATS; ++r)
+    {
+        f64 start = Now();
+        u64 operations = Run(items);
+        f64 perOperation = (Now() - start) * 1e9 / (f64)operations;
+        if (r == 0 || perOperation < best)
+        {
+            best = perOperation;
+        }
+    }
+    return best;
+}
+
+int main(int argc, char **argv)
+{
+    const char *outputPath = argc > 1 ? argv[1] : NULL;
+    u32 items = argc > 2 ? (u32)strtoul(argv[2], NULL, 10) : CONTAINER_BENCH_DEFAULT_ITEMS;
+    if (items < 2)
+    {
+        fprintf(stderr, "Usage: %s [output.json] [items]\n", argv[0]);
+        return 1;
+    }
+
+    if (!CheckContainers())
+    {
+        return 1;
+    }
+
+    FILE *out = outputPath ? fopen(outputPath, "w") : stdout;
+    if (!out)
+    {
+        fprintf(stderr, "Could not open %s.\n", outputPath);
+        return 1;
+    }
+
+    fprintf(out, "{\n  \"items\": %u,\n  \"cases\": [\n", items);
+    for (u32 i = 0; i < ARRAY_LEN(cases); ++i)
+    {
+        const struct ContainerBenchCase *benchCase = &cases[i];
+        f64 ns = Measure(benchCase->Run, items);
+        f64 baselineNs = Measure(benchCase->RunBaseline, items);
+
+        fprintf(out, "    {\"name\": \"%s\", \"ns_per_op\": %.2f, \"baseline\": \"%s\", \"baseline_ns_per_op\": %.2f, \"speedup\": %.2f}%s\n",
+                benchCase->name, ns, benchCase->baseline, baselineNs, baselineNs / ns,
+                i + 1 == ARRAY_LEN(cases) ? "" : ",");
+    }
+    fprintf(out, "  ]\n}\n");
+
+    if (out != stdout)
+    {
+        fclose(out);
+    }
+
+    return 0;
+}
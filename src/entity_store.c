@@ -0,0 +1,220 @@
+#include "entity_store.h"
+#include <string.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#endif
+
+#define ENTITY_STORE_FLOAT_ARRAYS 10
+
+static usize EntityStoreArraySize(u32 capacity)
+{
+    return capacity * sizeof(f32);
+}
+
+void EntityStoreInit(struct EntityStore *store, u32 capacity, Allocator *alloc, void *user)
+{
+    capacity = (capacity + ENTITY_STORE_LANES - 1) & ~(u32)(ENTITY_STORE_LANES - 1);
+
+    usize arraySize = EntityStoreArraySize(capacity);
+    usize totalSize = ENTITY_STORE_ALIGNMENT + (ENTITY_STORE_FLOAT_ARRAYS + 3) * arraySize;
+
+    memset(store, 0, sizeof(*store));
+    store->memory = MemZeroAllocUser(alloc, totalSize, user);
+    if (!store->memory)
+    {
+        return;
+    }
+
+    usize address = ((usize)store->memory + ENTITY_STORE_ALIGNMENT - 1) & ~(usize)(ENTITY_STORE_ALIGNMENT - 1);
+    u8 *at = (u8 *)address;
+
+    // arraySize is a multiple of ENTITY_STORE_ALIGNMENT, so every array stays aligned
+    f32 **floatArrays[ENTITY_STORE_FLOAT_ARRAYS] = {
+        &store->positionX, &store->positionY,
+        &store->velocityX, &store->velocityY,
+        &store->accelerationX, &store->accelerationY,
+        &store->dimensionX, &store->dimensionY,
+        &store->previousPositionX, &store->previousPositionY,
+    };
+    for (u32 i = 0; i < ENTITY_STORE_FLOAT_ARRAYS; ++i)
+    {
+        *floatArrays[i] = (f32 *)at;
+        at += arraySize;
+    }
+
+    store->ids = (u32 *)at;
+    at += arraySize;
+    store->indexOfId = (u32 *)at;
+    at += arraySize;
+    store->freeIds = (u32 *)at;
+
+    store->capacity = capacity;
+    store->count = 0;
+
+    // Hand out low ids first
+    for (u32 i = 0; i < capacity; ++i)
+    {
+        store->indexOfId[i] = ENTITY_INDEX_INVALID;
+        store->freeIds[i] = capacity - 1 - i;
+    }
+    store->freeIdCount = capacity;
+}
+
+void EntityStoreFree(struct EntityStore *store, Allocator *alloc, void *user)
+{
+    MemFreeUser(alloc, store->memory, user);
+    memset(store, 0, sizeof(*store));
+}
+
+u32 EntityStoreAdd(struct EntityStore *store, const struct Entity *entity)
+{
+    if (store->freeIdCount == 0)
+    {
+        return ENTITY_ID_INVALID;
+    }
+
+    u32 id = store->freeIds[--store->freeIdCount];
+    u32 index = store->count++;
+
+    store->indexOfId[id] = index;
+    store->ids[index] = id;
+    store->positionX[index] = entity->position[0];
+    store->positionY[index] = entity->position[1];
+    store->velocityX[index] = entity->velocity[0];
+    store->velocityY[index] = entity->velocity[1];
+    store->accelerationX[index] = entity->acceleration[0];
+    store->accelerationY[index] = entity->acceleration[1];
+    store->dimensionX[index] = entity->dimension[0];
+    store->dimensionY[index] = entity->dimension[1];
+    store->previousPositionX[index] = entity->position[0];
+    store->previousPositionY[index] = entity->position[1];
+
+    return id;
+}
+
+void EntityStoreRemove(struct EntityStore *store, u32 id)
+{
+    u32 index = EntityStoreIndexOf(store, id);
+    if (index == ENTITY_INDEX_INVALID)
+    {
+        return;
+    }
+
+    u32 last = --store->count;
+    u32 lastId = store->ids[last];
+
+    store->ids[index] = lastId;
+    store->positionX[index] = store->positionX[last];
+    store->positionY[index] = store->positionY[last];
+    store->velocityX[index] = store->velocityX[last];
+    store->velocityY[index] = store->velocityY[last];
+    store->accelerationX[index] = store->accelerationX[last];
+    store->accelerationY[index] = store->accelerationY[last];
+    store->dimensionX[index] = store->dimensionX[last];
+    store->dimensionY[index] = store->dimensionY[last];
+    store->previousPositionX[index] = store->previousPositionX[last];
+    store->previousPositionY[index] = store->previousPositionY[last];
+    store->indexOfId[lastId] = index;
+
+    // Keep the padding lanes past `count` inert for the vectorized passes
+    store->velocityX[last] = 0.0f;
+    store->velocityY[last] = 0.0f;
+    store->accelerationX[last] = 0.0f;
+    store->accelerationY[last] = 0.0f;
+
+    store->indexOfId[id] = ENTITY_INDEX_INVALID;
+    store->freeIds[store->freeIdCount++] = id;
+}
+
+u32 EntityStoreIndexOf(const struct EntityStore *store, u32 id)
+{
+    if (id >= store->capacity)
+    {
+        return ENTITY_INDEX_INVALID;
+    }
+    return store->indexOfId[id];
+}
+
+bool EntityStoreGet(const struct EntityStore *store, u32 id, struct Entity *entity)
+{
+    u32 index = EntityStoreIndexOf(store, id);
+    if (index == ENTITY_INDEX_INVALID)
+    {
+        return false;
+    }
+
+    entity->id = id;
+    entity->position[0] = store->positionX[index];
+    entity->position[1] = store->positionY[index];
+    entity->velocity[0] = store->velocityX[index];
+    entity->velocity[1] = store->velocityY[index];
+    entity->acceleration[0] = store->accelerationX[index];
+    entity->acceleration[1] = store->accelerationY[index];
+    entity->dimension[0] = store->dimensionX[index];
+    entity->dimension[1] = store->dimensionY[index];
+
+    return true;
+}
+
+void EntityStoreSavePrevious(struct EntityStore *store)
+{
+    EntityStoreSavePreviousRange(store, 0, store->count);
+}
+
+void EntityStoreSavePreviousRange(struct EntityStore *store, u32 start, u32 end)
+{
+    memcpy(store->previousPositionX + start, store->positionX + start, (end - start) * sizeof(f32));
+    memcpy(store->previousPositionY + start, store->positionY + start, (end - start) * sizeof(f32));
+}
+
+// Semi-implicit Euler on one axis. Loops run over whole lanes; the padding
+// past `count` is zeroed velocity/acceleration, so it never drifts.
+static void IntegrateAxis(f32 *position, f32 *velocity, const f32 *acceleration, u32 count, f32 dt)
+{
+#if defined(__AVX__)
+    __m256 dt8 = _mm256_set1_ps(dt);
+    for (u32 i = 0; i < count; i += 8)
+    {
+        __m256 v = _mm256_load_ps(velocity + i);
+        __m256 a = _mm256_load_ps(acceleration + i);
+        __m256 p = _mm256_load_ps(position + i);
+        v = _mm256_add_ps(v, _mm256_mul_ps(a, dt8));
+        p = _mm256_add_ps(p, _mm256_mul_ps(v, dt8));
+        _mm256_store_ps(velocity + i, v);
+        _mm256_store_ps(position + i, p);
+    }
+#elif defined(__SSE__) || defined(_M_X64)
+    __m128 dt4 = _mm_set1_ps(dt);
+    for (u32 i = 0; i < count; i += 4)
+    {
+        __m128 v = _mm_load_ps(velocity + i);
+        __m128 a = _mm_load_ps(acceleration + i);
+        __m128 p = _mm_load_ps(position + i);
+        v = _mm_add_ps(v, _mm_mul_ps(a, dt4));
+        p = _mm_add_ps(p, _mm_mul_ps(v, dt4));
+        _mm_store_ps(velocity + i, v);
+        _mm_store_ps(position + i, p);
+    }
+#else
+    for (u32 i = 0; i < count; ++i)
+    {
+        velocity[i] += acceleration[i] * dt;
+        position[i] += velocity[i] * dt;
+    }
+#endif
+}
+
+void EntityStoreIntegrate(struct EntityStore *store, f32 dt)
+{
+    EntityStoreIntegrateRange(store, 0, store->count, dt);
+}
+
+void EntityStoreIntegrateRange(struct EntityStore *store, u32 start, u32 end, f32 dt)
+{
+    u32 count = end - start;
+    IntegrateAxis(store->positionX + start, store->velocityX + start, store->accelerationX + start, count, dt);
+    IntegrateAxis(store->positionY + start, store->velocityY + start, store->accelerationY + start, count, dt);
+}
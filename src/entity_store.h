@@ -0,0 +1,79 @@
+#ifndef ENTITY_STORE_H
+#define ENTITY_STORE_H
+
+#include <cglm/cglm.h>
+
+#include "common.h"
+#include "allocator.h"
+
+#define ENTITY_ID_INVALID UINT32_MAX
+#define ENTITY_INDEX_INVALID UINT32_MAX
+
+// Component arrays are padded to a multiple of this many entities and aligned
+// so the integration pass can always work on whole AVX registers.
+#define ENTITY_STORE_LANES 8
+#define ENTITY_STORE_ALIGNMENT 32
+
+struct Entity
+{
+    u32 id;
+    vec2 position;
+    vec2 velocity;
+    vec2 acceleration;
+
+    vec2 dimension;
+};
+
+// Structure-of-arrays entity storage. Components live in separate tightly
+// packed arrays indexed by dense index [0, count). Ids stay stable for the
+// lifetime of an entity, while dense indices change on removal.
+struct EntityStore
+{
+    u32 count;
+    u32 capacity;
+
+    u32 *ids;
+    f32 *positionX;
+    f32 *positionY;
+    f32 *velocityX;
+    f32 *velocityY;
+    f32 *accelerationX;
+    f32 *accelerationY;
+    f32 *dimensionX;
+    f32 *dimensionY;
+
+    // Positions as of the start of the current tick, for render interpolation
+    f32 *previousPositionX;
+    f32 *previousPositionY;
+
+    // id -> dense index, ENTITY_INDEX_INVALID for ids not in use
+    u32 *indexOfId;
+    u32 *freeIds;
+    u32 freeIdCount;
+
+    void *memory;
+};
+
+void EntityStoreInit(struct EntityStore *store, u32 capacity, Allocator *alloc, void *user);
+void EntityStoreFree(struct EntityStore *store, Allocator *alloc, void *user);
+
+// Returns the new entity's id, or ENTITY_ID_INVALID when the store is full.
+u32 EntityStoreAdd(struct EntityStore *store, const struct Entity *entity);
+// Moves the last entity into the removed slot.
+void EntityStoreRemove(struct EntityStore *store, u32 id);
+
+u32 EntityStoreIndexOf(const struct EntityStore *store, u32 id);
+bool EntityStoreGet(const struct EntityStore *store, u32 id, struct Entity *entity);
+
+// Copies the current positions into previousPosition. Call before each tick.
+void EntityStoreSavePrevious(struct EntityStore *store);
+
+// velocity += acceleration * dt; position += velocity * dt
+void EntityStoreIntegrate(struct EntityStore *store, f32 dt);
+
+// Both of the above for the dense range [start, end), so a tick can be split
+// across threads. `start` must be a multiple of ENTITY_STORE_LANES.
+void EntityStoreSavePreviousRange(struct EntityStore *store, u32 start, u32 end);
+void EntityStoreIntegrateRange(struct EntityStore *store, u32 start, u32 end, f32 dt);
+
+#endif // ENTITY_STORE_H
@@ -0,0 +1,158 @@
+#include "frame_pacer.h"
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <glad/gl.h>
+
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#include <immintrin.h>
+#define CPU_PAUSE() _mm_pause()
+#else
+#define CPU_PAUSE() ((void)0)
+#endif
+
+// Sleep until this long before the deadline, then spin. Covers the usual
+// 50us timer slack plus scheduler wakeup with room to spare.
+#define FRAME_PACER_SPIN_NS 1000000ull
+
+// How long to wait on a fence per try; we keep trying until it signals
+#define FRAME_PACER_FENCE_TIMEOUT_NS 1000000ull
+
+static u64 Now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (u64)now.tv_sec * 1000000000ull + (u64)now.tv_nsec;
+}
+
+static void SleepUntil(u64 deadline)
+{
+    struct timespec wake = {
+        .tv_sec = (time_t)(deadline / 1000000000ull),
+        .tv_nsec = (long)(deadline % 1000000000ull),
+    };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL) == EINTR)
+    {
+    }
+}
+
+void FramePacerInit(struct FramePacer *pacer, u32 mode, f64 targetFps, u32 maxFramesInFlight)
+{
+    memset(pacer, 0, sizeof(*pacer));
+    pacer->tearControlSupported = glfwExtensionSupported("GLX_EXT_swap_control_tear") ||
+                                  glfwExtensionSupported("WGL_EXT_swap_control_tear");
+    pacer->period = (u64)(1e9 / targetFps);
+    pacer->maxFramesInFlight = maxFramesInFlight < FRAME_PACER_MAX_FRAMES_IN_FLIGHT ? maxFramesInFlight : FRAME_PACER_MAX_FRAMES_IN_FLIGHT;
+    FramePacerSetMode(pacer, mode);
+}
+
+void FramePacerFree(struct FramePacer *pacer)
+{
+    for (u32 i = 0; i < FRAME_PACER_MAX_FRAMES_IN_FLIGHT; ++i)
+    {
+        if (pacer->fences[i])
+        {
+            glDeleteSync(pacer->fences[i]);
+        }
+    }
+    memset(pacer, 0, sizeof(*pacer));
+}
+
+void FramePacerSetMode(struct FramePacer *pacer, u32 mode)
+{
+    if (mode == FramePace_Adaptive && !pacer->tearControlSupported)
+    {
+        mode = FramePace_Vsync;
+    }
+    pacer->mode = mode;
+
+    switch (mode)
+    {
+    case FramePace_Vsync:
+        glfwSwapInterval(1);
+        break;
+    case FramePace_Adaptive:
+        glfwSwapInterval(-1);
+        break;
+    case FramePace_TargetFps:
+    case FramePace_Unthrottled:
+        glfwSwapInterval(0);
+        break;
+    }
+
+    pacer->nextDeadline = Now() + pacer->period;
+}
+
+const char *FramePaceModeName(u32 mode)
+{
+    switch (mode)
+    {
+    case FramePace_Vsync:
+        return "vsync";
+    case FramePace_Adaptive:
+        return "adaptive vsync";
+    case FramePace_TargetFps:
+        return "target fps";
+    case FramePace_Unthrottled:
+        return "unthrottled";
+    }
+    return "unknown";
+}
+
+void FramePacerWait(struct FramePacer *pacer)
+{
+    if (pacer->mode != FramePace_TargetFps)
+    {
+        return;
+    }
+
+    u64 now = Now();
+    if (now > pacer->nextDeadline)
+    {
+        // Late; start a new schedule from here rather than rushing the
+        // following frames to catch up
+        pacer->missedDeadlines += 1;
+        pacer->nextDeadline = now + pacer->period;
+        return;
+    }
+
+    if (pacer->nextDeadline - now > FRAME_PACER_SPIN_NS)
+    {
+        SleepUntil(pacer->nextDeadline - FRAME_PACER_SPIN_NS);
+    }
+    while (Now() < pacer->nextDeadline)
+    {
+        CPU_PAUSE();
+    }
+
+    pacer->nextDeadline += pacer->period;
+}
+
+void FramePacerEndFrame(struct FramePacer *pacer)
+{
+    if (pacer->maxFramesInFlight == 0)
+    {
+        return;
+    }
+
+    u32 slot = pacer->frameIndex % pacer->maxFramesInFlight;
+    pacer->frameIndex += 1;
+
+    // The fence already in this slot is the one from maxFramesInFlight frames ago
+    GLsync fence = pacer->fences[slot];
+    if (fence)
+    {
+        GLenum result;
+        do
+        {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FRAME_PACER_FENCE_TIMEOUT_NS);
+        } while (result == GL_TIMEOUT_EXPIRED);
+
+        glDeleteSync(fence);
+    }
+
+    pacer->fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
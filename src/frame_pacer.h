@@ -0,0 +1,62 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+// Decides when the render thread starts its next frame.
+//
+//   Vsync:       swap interval 1; the swap blocks until the next vblank.
+//   Adaptive:    swap interval -1 (EXT_swap_control_tear), so a frame that
+//                misses vblank is shown right away with a tear instead of
+//                waiting a whole refresh. Falls back to Vsync without it.
+//   TargetFps:   swap interval 0, and the pacer sleeps until a fixed deadline
+//                with clock_nanosleep, then spins the last stretch, since the
+//                scheduler can wake us late by about a timer slack.
+//   Unthrottled: swap interval 0 and no waiting, for benchmarks and replays.
+//
+// Independently, `maxFramesInFlight` bounds how far the CPU may run ahead of
+// the GPU: a fence goes in after every swap, and the frame waits on the one
+// from that many frames ago. Drivers otherwise queue several frames, and
+// every queued frame is input latency. 0 leaves it to the driver.
+//
+// Needs the window's context current on the calling thread.
+
+#include "common.h"
+
+#define FRAME_PACER_MAX_FRAMES_IN_FLIGHT 4
+
+enum FramePaceMode
+{
+    FramePace_Vsync,
+    FramePace_Adaptive,
+    FramePace_TargetFps,
+    FramePace_Unthrottled,
+    FramePace_Count,
+};
+
+struct FramePacer
+{
+    u32 mode;
+    bool tearControlSupported;
+
+    u64 period;       // ns between frames in TargetFps mode
+    u64 nextDeadline; // CLOCK_MONOTONIC ns
+    u32 missedDeadlines;
+
+    u32 maxFramesInFlight;
+    void *fences[FRAME_PACER_MAX_FRAMES_IN_FLIGHT]; // GLsync
+    u32 frameIndex;
+};
+
+void FramePacerInit(struct FramePacer *pacer, u32 mode, f64 targetFps, u32 maxFramesInFlight);
+void FramePacerFree(struct FramePacer *pacer);
+
+// Sets the swap interval for `mode` and restarts the deadline schedule
+void FramePacerSetMode(struct FramePacer *pacer, u32 mode);
+const char *FramePaceModeName(u32 mode);
+
+// Call at the top of the frame, before sampling input, so the time spent
+// waiting doesn't count against the input
+void FramePacerWait(struct FramePacer *pacer);
+// Call right after swapping buffers
+void FramePacerEndFrame(struct FramePacer *pacer);
+
+#endif // FRAME_PACER_H
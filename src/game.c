@@ -1,4 +1,335 @@
-void test(void)
+#include "game.h"
+#include <math.h>
+
+#include "allocator.h"
+#include "atlas_sprites.h"
+#include "entity_store.h"
+#include "particles.h"
+#include "spatial_hash.h"
+
+#define MAX_ENTITIES (1u << 17)
+#define PLAYER_ACCELERATION 4.0f
+
+// Entities per job; a multiple of ENTITY_STORE_LANES
+#define ENTITY_JOB_BATCH 4096
+
+// Broadphase cells, in 1/LENGTH_UNIT_SCALE world units; twice a vehicle's size
+#define BROADPHASE_CELL_UNITS 32
+#define BROADPHASE_MAX_CONTACTS (4u * MAX_ENTITIES)
+
+// Sized for about 100k live particles between them at the rates below
+#define EXHAUST_PARTICLES (1u << 16)
+#define DUST_PARTICLES (1u << 15)
+#define SPARK_PARTICLES (1u << 14)
+
+// Particles sit just under or over the vehicles they belong to
+#define EXHAUST_Z -0.1f
+#define DUST_Z -0.2f
+#define SPARK_Z 0.1f
+
+// Vehicles get one of the sheet's 64 cells by id
+#define VEHICLE_SPRITE_COUNT 64
+
+struct GameState
+{
+    struct Arena arena;
+
+    struct EntityStore entities;
+    u32 playerId;
+
+    struct SpatialHash broadphase;
+    struct SpatialPair *contacts;
+    u32 contactCount;
+
+    struct ParticleEmitter exhaust;
+    struct ParticleEmitter dust;
+    struct ParticleEmitter sparks;
+};
+
+static void InitEmitters(struct GameState *state)
+{
+    struct ParticleEmitter *exhaust = &state->exhaust;
+    ParticleEmitterInit(exhaust, EXHAUST_PARTICLES, 0x9e3779b9u, ArenaAllocator, &state->arena);
+    *exhaust = (struct ParticleEmitter){
+        .pool = exhaust->pool,
+        .seed = exhaust->seed,
+        .positionJitter = 0.05f,
+        .rate = 36000.0f,
+        .spread = 0.35f,
+        .speedMin = 0.5f,
+        .speedMax = 1.5f,
+        .lifetimeMin = 1.0f,
+        .lifetimeMax = 2.5f,
+        .sizeMin = 0.02f,
+        .sizeMax = 0.06f,
+        .color = {0.6f, 0.6f, 0.65f, 0.5f},
+        .colorJitter = 0.1f,
+        .sprite = Sprite_vehicles_56,
+        .spriteVariants = 2,
+        .acceleration = {0.0f, 0.3f},
+        .drag = 1.5f,
+    };
+
+    struct ParticleEmitter *dust = &state->dust;
+    ParticleEmitterInit(dust, DUST_PARTICLES, 0x85ebca6bu, ArenaAllocator, &state->arena);
+    *dust = (struct ParticleEmitter){
+        .pool = dust->pool,
+        .seed = dust->seed,
+        .positionJitter = 0.3f,
+        .rate = 14000.0f,
+        .spread = 3.14159265f,
+        .speedMin = 0.05f,
+        .speedMax = 0.4f,
+        .lifetimeMin = 1.0f,
+        .lifetimeMax = 3.0f,
+        .sizeMin = 0.03f,
+        .sizeMax = 0.08f,
+        .color = {0.65f, 0.5f, 0.35f, 0.35f},
+        .colorJitter = 0.08f,
+        .sprite = Sprite_vehicles_58,
+        .spriteVariants = 2,
+        .drag = 0.8f,
+    };
+
+    struct ParticleEmitter *sparks = &state->sparks;
+    ParticleEmitterInit(sparks, SPARK_PARTICLES, 0xc2b2ae35u, ArenaAllocator, &state->arena);
+    *sparks = (struct ParticleEmitter){
+        .pool = sparks->pool,
+        .seed = sparks->seed,
+        .position = {1.0f, 1.0f},
+        .positionJitter = 0.02f,
+        .rate = 20000.0f,
+        .direction = 1.5707963f,
+        .spread = 0.6f,
+        .speedMin = 1.5f,
+        .speedMax = 3.5f,
+        .lifetimeMin = 0.2f,
+        .lifetimeMax = 0.7f,
+        .sizeMin = 0.01f,
+        .sizeMax = 0.025f,
+        .color = {1.0f, 0.75f, 0.3f, 1.0f},
+        .colorJitter = 0.1f,
+        .sprite = Sprite_vehicles_60,
+        .spriteVariants = 1,
+        .acceleration = {0.0f, -6.0f},
+        .drag = 0.2f,
+    };
+}
+
+static struct GameState *GetGameState(struct GameMemory *memory)
+{
+    struct GameState *state = memory->base;
+
+    if (!memory->isInitialized)
+    {
+        ArenaInit(&state->arena, (u8 *)memory->base + sizeof(*state), memory->size - sizeof(*state));
+
+        EntityStoreInit(&state->entities, MAX_ENTITIES, ArenaAllocator, &state->arena);
+
+        struct Entity player = {
+            .position = {4.0f, 3.0f},
+            .dimension = {0.5f, 0.5f},
+        };
+        state->playerId = EntityStoreAdd(&state->entities, &player);
+
+        SpatialHashInit(&state->broadphase, MAX_ENTITIES, (f32)BROADPHASE_CELL_UNITS / LENGTH_UNIT_SCALE,
+                        ArenaAllocator, &state->arena);
+        state->contacts = ArenaPushArray(&state->arena, struct SpatialPair, BROADPHASE_MAX_CONTACTS);
+
+        InitEmitters(state);
+
+        memory->isInitialized = true;
+    }
+
+    return state;
+}
+
+struct IntegrateJob
+{
+    struct EntityStore *entities;
+    f32 dt;
+};
+
+static void IntegrateEntities(void *data, u32 start, u32 end)
+{
+    struct IntegrateJob *job = data;
+    EntityStoreSavePreviousRange(job->entities, start, end);
+    EntityStoreIntegrateRange(job->entities, start, end, job->dt);
+}
+
+struct BuildSpritesJob
+{
+    const struct EntityStore *entities;
+    struct SpriteInstance *sprites;
+    f32 alpha;
+};
+
+static void BuildEntitySprites(void *data, u32 start, u32 end)
 {
+    struct BuildSpritesJob *job = data;
+    const struct EntityStore *entities = job->entities;
+
+    for (u32 i = start; i < end; ++i)
+    {
+        u32 id = entities->ids[i];
+        f32 x = glm_lerp(entities->previousPositionX[i], entities->positionX[i], job->alpha);
+        f32 y = glm_lerp(entities->previousPositionY[i], entities->positionY[i], job->alpha);
+        const f32 *uv = spriteRects[Sprite_vehicles_0 + id % VEHICLE_SPRITE_COUNT].uv;
+        job->sprites[i] = (struct SpriteInstance){
+            .position = {x, y, 0.0f},
+            .scale = 0.5f*(entities->dimensionX[i] + entities->dimensionY[i]),
+            .uv = {uv[0], uv[1], uv[2], uv[3]},
+            .tint = {1.0f, 1.0f, 1.0f, 1.0f},
+        };
+    }
+}
+
+static void PushSprite(struct RenderList *renderList, const struct SpriteInstance *sprite)
+{
+    if (renderList->count < renderList->capacity)
+    {
+        renderList->sprites[renderList->count++] = *sprite;
+    }
+}
+
+// Each emitter's particles go out as one run, so they cost one draw call
+static void PushParticles(struct RenderList *renderList, const struct ParticlePool *pool, f32 z)
+{
+    if (renderList->runCount == RENDER_LIST_MAX_RUNS)
+    {
+        return;
+    }
+
+    struct SpriteRun *run = &renderList->runs[renderList->runCount++];
+    run->first = renderList->runSpriteCount;
+    run->count = ParticleBuildSprites(pool, spriteRects, renderList->runSprites + run->first,
+                                      renderList->runSpriteCapacity - run->first, z);
+    run->z = z;
+    renderList->runSpriteCount += run->count;
+}
+
+// Pushes each overlapping pair apart along the axis they overlap least on,
+// half each, and stops them closing on that axis
+static void ResolveContacts(struct GameState *state)
+{
+    struct EntityStore *entities = &state->entities;
+    SpatialHashBuild(&state->broadphase, entities->count, entities->positionX, entities->positionY,
+                     entities->dimensionX, entities->dimensionY);
+
+    u32 found = SpatialHashOverlapPairs(&state->broadphase, state->contacts, BROADPHASE_MAX_CONTACTS);
+    state->contactCount = found < BROADPHASE_MAX_CONTACTS ? found : BROADPHASE_MAX_CONTACTS;
+
+    for (u32 i = 0; i < state->contactCount; ++i)
+    {
+        u32 a = state->contacts[i].a;
+        u32 b = state->contacts[i].b;
+        f32 dx = entities->positionX[b] - entities->positionX[a];
+        f32 dy = entities->positionY[b] - entities->positionY[a];
+        f32 overlapX = 0.5f*(entities->dimensionX[a] + entities->dimensionX[b]) - fabsf(dx);
+        f32 overlapY = 0.5f*(entities->dimensionY[a] + entities->dimensionY[b]) - fabsf(dy);
+        if (overlapX <= 0.0f || overlapY <= 0.0f)
+        {
+            continue; // already pushed apart by an earlier contact
+        }
+
+        f32 *position = overlapX < overlapY ? entities->positionX : entities->positionY;
+        f32 *velocity = overlapX < overlapY ? entities->velocityX : entities->velocityY;
+        f32 push = 0.5f*(overlapX < overlapY ? overlapX : overlapY);
+        f32 sign = (overlapX < overlapY ? dx : dy) < 0.0f ? -1.0f : 1.0f;
+
+        position[a] -= sign*push;
+        position[b] += sign*push;
+
+        f32 closing = sign*(velocity[a] - velocity[b]);
+        if (closing > 0.0f)
+        {
+            f32 average = 0.5f*(velocity[a] + velocity[b]);
+            velocity[a] = average;
+            velocity[b] = average;
+        }
+    }
+}
+
+// Exhaust trails out behind the player, dust kicks up around it
+static void UpdateParticles(struct GameState *state, f32 dt)
+{
+    u32 playerIndex = EntityStoreIndexOf(&state->entities, state->playerId);
+    if (playerIndex != ENTITY_INDEX_INVALID)
+    {
+        struct EntityStore *entities = &state->entities;
+        f32 x = entities->positionX[playerIndex];
+        f32 y = entities->positionY[playerIndex];
+        f32 vx = entities->velocityX[playerIndex];
+        f32 vy = entities->velocityY[playerIndex];
+
+        state->exhaust.position[0] = x;
+        state->exhaust.position[1] = y;
+        if (vx*vx + vy*vy > 1e-4f)
+        {
+            state->exhaust.direction = atan2f(-vy, -vx);
+        }
+
+        state->dust.position[0] = x;
+        state->dust.position[1] = y;
+    }
+
+    ParticleEmitterUpdate(&state->exhaust, dt);
+    ParticleEmitterUpdate(&state->dust, dt);
+    ParticleEmitterUpdate(&state->sparks, dt);
+}
+
+// Advances the simulation by one fixed tick
+GAME_UPDATE(GameUpdate)
+{
+    struct GameState *state = GetGameState(memory);
+    struct EntityStore *entities = &state->entities;
+
+    u32 playerIndex = EntityStoreIndexOf(entities, state->playerId);
+    if (playerIndex != ENTITY_INDEX_INVALID)
+    {
+        entities->accelerationX[playerIndex] = PLAYER_ACCELERATION*((input->keyLeft ? -1.0f : 0.0f) + (input->keyRight ? 1.0f : 0.0f));
+        entities->accelerationY[playerIndex] = PLAYER_ACCELERATION*((input->keyUp ? -1.0f : 0.0f) + (input->keyDown ? 1.0f : 0.0f));
+    }
+
+    struct PlatformApi *platform = memory->platform;
+    struct IntegrateJob job = {entities, dt};
+    platform->ParallelFor(platform->jobs, entities->count, ENTITY_JOB_BATCH, IntegrateEntities, &job);
+
+    ResolveContacts(state);
+    UpdateParticles(state, dt);
+}
+
+// Emits the world `alpha` of the way from the previous tick's state to the current one
+GAME_RENDER(GameRender)
+{
+    struct GameState *state = GetGameState(memory);
+    struct EntityStore *entities = &state->entities;
+
+    const f32 *small = spriteRects[Sprite_vehicles_0].uv;
+    const f32 *big = spriteRects[Sprite_vehicles_36].uv;
+    struct SpriteInstance cubes[] = {
+        {.position = { 1.0f,  1.0f, 0.0f}, .scale = 1.0f, .uv = {small[0], small[1], small[2], small[3]}, .tint = {1.0f, 1.0f, 1.0f, 1.0f}},
+        {.position = {-1.5f, -1.0f, 0.0f}, .scale = 3.0f, .uv = {big[0], big[1], big[2], big[3]}, .tint = {1.0f, 1.0f, 1.0f, 1.0f}},
+    };
+
+    for (u32 i = 0; i < ARRAY_LEN(cubes); ++i)
+    {
+        PushSprite(renderList, &cubes[i]);
+    }
+
+    u32 spriteCount = entities->count;
+    if (spriteCount > renderList->capacity - renderList->count)
+    {
+        spriteCount = renderList->capacity - renderList->count;
+    }
+
+    struct PlatformApi *platform = memory->platform;
+    struct BuildSpritesJob job = {entities, renderList->sprites + renderList->count, alpha};
+    platform->ParallelFor(platform->jobs, spriteCount, ENTITY_JOB_BATCH, BuildEntitySprites, &job);
+    renderList->count += spriteCount;
 
+    // Particles aren't interpolated; at a 60 Hz tick that's not visible
+    PushParticles(renderList, &state->dust.pool, DUST_Z);
+    PushParticles(renderList, &state->exhaust.pool, EXHAUST_Z);
+    PushParticles(renderList, &state->sparks.pool, SPARK_Z);
 }
@@ -0,0 +1,75 @@
+#ifndef GAME_H
+#define GAME_H
+
+// Interface between the platform layer (main_glfw.c) and the hot-reloadable
+// game library (game.c). Everything the game keeps between calls lives in
+// GameMemory, which the platform owns, so it survives a library swap.
+// Don't store pointers to code or static data of the library in there.
+
+#include "common.h"
+#include "sprite_batch.h"
+#include "jobs.h"
+
+#define LENGTH_UNIT_SCALE 32
+
+struct GameInput
+{
+    bool keyLeft;
+    bool keyRight;
+    bool keyUp;
+    bool keyDown;
+};
+
+// Services the platform provides to the game. Refreshed by the platform
+// before every call, so it's safe to keep in GameMemory.
+struct PlatformApi
+{
+    struct JobSystem *jobs;
+    JobParallelForFn *ParallelFor;
+};
+
+struct GameMemory
+{
+    void *base;
+    usize size;
+    bool isInitialized;
+
+    struct PlatformApi *platform;
+};
+
+#define RENDER_LIST_MAX_RUNS 16
+
+// Prebuilt sprites drawn with one instanced call, e.g. a particle emitter.
+// Unlike loose sprites they aren't depth sorted one by one; the whole run
+// sorts as a unit at height `z`.
+struct SpriteRun
+{
+    u32 first; // index into RenderList.runSprites
+    u32 count;
+    f32 z;
+};
+
+// Sprites to draw this frame, filled in by GameRender and drawn by the platform
+struct RenderList
+{
+    struct SpriteInstance *sprites;
+    u32 count;
+    u32 capacity;
+
+    struct SpriteInstance *runSprites;
+    u32 runSpriteCount;
+    u32 runSpriteCapacity;
+    struct SpriteRun runs[RENDER_LIST_MAX_RUNS];
+    u32 runCount;
+};
+
+#define GAME_UPDATE(name) void name(struct GameMemory *memory, const struct GameInput *input, f32 dt)
+typedef GAME_UPDATE(GameUpdateFn);
+
+#define GAME_RENDER(name) void name(struct GameMemory *memory, struct RenderList *renderList, f32 alpha)
+typedef GAME_RENDER(GameRenderFn);
+
+#define GAME_UPDATE_SYMBOL "GameUpdate"
+#define GAME_RENDER_SYMBOL "GameRender"
+
+#endif // GAME_H
@@ -0,0 +1,164 @@
+#include "gl_state.h"
+#include <string.h>
+#include <glad/gl.h>
+
+#define GL_STATE_UNKNOWN UINT32_MAX
+
+struct UniformSlot
+{
+    u32 program;
+    s32 location;
+    u32 size; // floats
+    f32 value[4];
+};
+
+struct GLState
+{
+    u32 program;
+    u32 vao;
+    u32 texture;
+    u32 blend;      // GL_STATE_UNKNOWN, 0 or 1
+    u32 depthWrite; // GL_STATE_UNKNOWN, 0 or 1
+
+    struct UniformSlot uniforms[GL_STATE_UNIFORM_SLOTS];
+    u32 uniformCount;
+    u32 uniformNext; // round-robin eviction once full
+
+    struct GLStateStats stats;
+};
+
+// GL state belongs to the context, and we only have the one
+static struct GLState state = {
+    .program = GL_STATE_UNKNOWN,
+    .vao = GL_STATE_UNKNOWN,
+    .texture = GL_STATE_UNKNOWN,
+    .blend = GL_STATE_UNKNOWN,
+    .depthWrite = GL_STATE_UNKNOWN,
+};
+
+void GLStateInvalidate(void)
+{
+    state.program = GL_STATE_UNKNOWN;
+    state.vao = GL_STATE_UNKNOWN;
+    state.texture = GL_STATE_UNKNOWN;
+    state.blend = GL_STATE_UNKNOWN;
+    state.depthWrite = GL_STATE_UNKNOWN;
+    state.uniformCount = 0;
+    state.uniformNext = 0;
+}
+
+// Returns true if `*current` had to change
+static bool Update(u32 *current, u32 value)
+{
+    if (*current == value)
+    {
+        state.stats.skipped += 1;
+        return false;
+    }
+
+    *current = value;
+    state.stats.calls += 1;
+    return true;
+}
+
+void GLStateUseProgram(u32 program)
+{
+    if (Update(&state.program, program))
+    {
+        glUseProgram(program);
+    }
+}
+
+void GLStateBindVertexArray(u32 vao)
+{
+    if (Update(&state.vao, vao))
+    {
+        glBindVertexArray(vao);
+    }
+}
+
+void GLStateBindTexture(u32 texture)
+{
+    if (Update(&state.texture, texture))
+    {
+        glBindTexture(GL_TEXTURE_2D, texture);
+    }
+}
+
+void GLStateSetBlend(bool enabled)
+{
+    if (Update(&state.blend, enabled))
+    {
+        if (enabled)
+        {
+            glEnable(GL_BLEND);
+        }
+        else
+        {
+            glDisable(GL_BLEND);
+        }
+    }
+}
+
+void GLStateSetDepthWrite(bool enabled)
+{
+    if (Update(&state.depthWrite, enabled))
+    {
+        glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+    }
+}
+
+// Returns true if the uniform already holds `value`; otherwise records it
+static bool UniformIsCurrent(s32 location, const f32 *value, u32 size)
+{
+    for (u32 i = 0; i < state.uniformCount; ++i)
+    {
+        struct UniformSlot *slot = &state.uniforms[i];
+        if (slot->program == state.program && slot->location == location)
+        {
+            if (slot->size == size && memcmp(slot->value, value, size * sizeof(f32)) == 0)
+            {
+                state.stats.skipped += 1;
+                return true;
+            }
+
+            slot->size = size;
+            memcpy(slot->value, value, size * sizeof(f32));
+            state.stats.calls += 1;
+            return false;
+        }
+    }
+
+    u32 index = state.uniformCount < GL_STATE_UNIFORM_SLOTS ? state.uniformCount++ : state.uniformNext++ % GL_STATE_UNIFORM_SLOTS;
+    struct UniformSlot *slot = &state.uniforms[index];
+    slot->program = state.program;
+    slot->location = location;
+    slot->size = size;
+    memcpy(slot->value, value, size * sizeof(f32));
+    state.stats.calls += 1;
+    return false;
+}
+
+void GLStateUniform4f(s32 location, f32 x, f32 y, f32 z, f32 w)
+{
+    f32 value[4] = {x, y, z, w};
+    if (location >= 0 && !UniformIsCurrent(location, value, 4))
+    {
+        glUniform4f(location, x, y, z, w);
+    }
+}
+
+void GLStateCountDraw(void)
+{
+    state.stats.calls += 1;
+}
+
+struct GLStateStats GLStateGetStats(void)
+{
+    return state.stats;
+}
+
+void GLStateResetStats(void)
+{
+    state.stats = (struct GLStateStats){0};
+}
@@ -0,0 +1,39 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+// Shadow copy of the GL state we change per draw. Each setter skips the
+// driver call when the value is already current. Anything that changes this
+// state behind the cache's back must call GLStateInvalidate; the platform
+// does so at the start of every frame.
+//
+// Uniform values are remembered per (program, location) until invalidated,
+// since a rebuilt program can come back under the same name.
+
+#include "common.h"
+
+#define GL_STATE_UNIFORM_SLOTS 32
+
+struct GLStateStats
+{
+    u32 calls;   // made it to the driver
+    u32 skipped; // redundant, filtered out
+};
+
+void GLStateInvalidate(void);
+
+void GLStateUseProgram(u32 program);
+void GLStateBindVertexArray(u32 vao);
+// Texture unit 0, GL_TEXTURE_2D
+void GLStateBindTexture(u32 texture);
+void GLStateSetBlend(bool enabled);
+void GLStateSetDepthWrite(bool enabled);
+
+// For the currently used program
+void GLStateUniform4f(s32 location, f32 x, f32 y, f32 z, f32 w);
+
+// Counts calls made through the cache, draws included
+void GLStateCountDraw(void);
+struct GLStateStats GLStateGetStats(void);
+void GLStateResetStats(void);
+
+#endif // GL_STATE_H
@@ -0,0 +1,173 @@
+#include "gpu_stream.h"
+#include <string.h>
+#include <glad/gl.h>
+
+// GL_ARB_buffer_storage. The bundled glad only covers 3.3 core, so the entry
+// point is loaded by hand.
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+
+typedef void (GLAD_API_PTR *BufferStorageFn)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+
+static BufferStorageFn BufferStorage;
+
+// How long to wait on a fence per try; we keep trying until it signals
+#define GPU_STREAM_FENCE_TIMEOUT_NS 1000000ull
+
+static bool HasBufferStorage(void)
+{
+    GLint major = 0;
+    GLint minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    if (major > 4 || (major == 4 && minor >= 4))
+    {
+        return BufferStorage != NULL;
+    }
+
+    GLint extensionCount = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+    for (GLint i = 0; i < extensionCount; ++i)
+    {
+        const char *extension = (const char *)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+        if (extension && strcmp(extension, "GL_ARB_buffer_storage") == 0)
+        {
+            return BufferStorage != NULL;
+        }
+    }
+
+    return false;
+}
+
+bool GpuStreamInit(struct GpuStreamBuffer *stream, usize regionSize, GpuStreamGetProcAddressFn getProcAddress)
+{
+    memset(stream, 0, sizeof(*stream));
+    stream->regionSize = regionSize;
+
+    *(GpuStreamLoadFn *)&BufferStorage = getProcAddress("glBufferStorage");
+    stream->persistent = HasBufferStorage();
+
+    glGenBuffers(1, &stream->buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, stream->buffer);
+
+    usize totalSize = regionSize * GPU_STREAM_FRAMES;
+    if (stream->persistent)
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        BufferStorage(GL_ARRAY_BUFFER, (GLsizeiptr)totalSize, NULL, flags);
+        stream->mapping = glMapBufferRange(GL_ARRAY_BUFFER, 0, (GLsizeiptr)totalSize, flags);
+        if (!stream->mapping)
+        {
+            // Storage is immutable now, so start over with a plain buffer
+            glDeleteBuffers(1, &stream->buffer);
+            glGenBuffers(1, &stream->buffer);
+            glBindBuffer(GL_ARRAY_BUFFER, stream->buffer);
+            stream->persistent = false;
+        }
+    }
+
+    if (!stream->persistent)
+    {
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)totalSize, NULL, GL_STREAM_DRAW);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return stream->buffer != 0;
+}
+
+void GpuStreamFree(struct GpuStreamBuffer *stream)
+{
+    for (u32 i = 0; i < GPU_STREAM_FRAMES; ++i)
+    {
+        if (stream->fences[i])
+        {
+            glDeleteSync(stream->fences[i]);
+        }
+    }
+
+    if (stream->persistent)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, stream->buffer);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    glDeleteBuffers(1, &stream->buffer);
+    memset(stream, 0, sizeof(*stream));
+}
+
+void GpuStreamBeginFrame(struct GpuStreamBuffer *stream)
+{
+    stream->region = (stream->region + 1) % GPU_STREAM_FRAMES;
+    stream->offset = 0;
+
+    GLsync fence = stream->fences[stream->region];
+    if (fence)
+    {
+        // Normally signaled long ago; only blocks if the GPU is frames behind
+        GLenum result;
+        do
+        {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GPU_STREAM_FENCE_TIMEOUT_NS);
+        } while (result == GL_TIMEOUT_EXPIRED);
+
+        glDeleteSync(fence);
+        stream->fences[stream->region] = NULL;
+    }
+}
+
+void GpuStreamEndFrame(struct GpuStreamBuffer *stream)
+{
+    stream->fences[stream->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void *GpuStreamMap(struct GpuStreamBuffer *stream, usize size, usize alignment, usize *offset)
+{
+    usize start = (stream->offset + alignment - 1) & ~(alignment - 1);
+    if (start + size > stream->regionSize)
+    {
+        stream->overflows += 1;
+        return NULL;
+    }
+
+    stream->offset = start + size;
+    stream->mappedOffset = stream->region * stream->regionSize + start;
+    stream->mappedSize = size;
+    *offset = stream->mappedOffset;
+
+    if (stream->persistent)
+    {
+        return stream->mapping + stream->mappedOffset;
+    }
+
+    // Unsynchronized is safe since the fence guarantees the GPU is done with this region
+    glBindBuffer(GL_ARRAY_BUFFER, stream->buffer);
+    stream->mapping = glMapBufferRange(GL_ARRAY_BUFFER, (GLintptr)stream->mappedOffset, (GLsizeiptr)size,
+                                       GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT |
+                                       GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT);
+    if (!stream->mapping)
+    {
+        stream->offset = start;
+        stream->mappedSize = 0;
+    }
+    return stream->mapping;
+}
+
+void GpuStreamUnmap(struct GpuStreamBuffer *stream, usize usedSize)
+{
+    // Hand the unused tail of the reservation back
+    stream->offset -= stream->mappedSize - usedSize;
+
+    if (!stream->persistent)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, stream->buffer);
+        if (usedSize > 0)
+        {
+            glFlushMappedBufferRange(GL_ARRAY_BUFFER, 0, (GLsizeiptr)usedSize);
+        }
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        stream->mapping = NULL;
+    }
+
+    stream->mappedSize = 0;
+}
@@ -0,0 +1,53 @@
+#ifndef GPU_STREAM_H
+#define GPU_STREAM_H
+
+// Ring buffer for data that changes every frame. The buffer is split into
+// one region per frame in flight; a frame only writes into its own region,
+// and a fence per region keeps the CPU from overwriting data the GPU still
+// reads, so writes never trigger an implicit sync.
+//
+// With GL_ARB_buffer_storage (core in 4.4) the whole buffer stays mapped
+// persistent and coherent. On plain 3.3 each write maps its range with
+// GL_MAP_UNSYNCHRONIZED_BIT instead and is unmapped before drawing.
+
+#include "common.h"
+
+#define GPU_STREAM_FRAMES 3
+
+struct GpuStreamBuffer
+{
+    u32 buffer;
+    usize regionSize;
+    u32 region; // region the current frame writes into
+    usize offset; // next free byte within the region
+
+    bool persistent;
+    u8 *mapping; // whole buffer when persistent, else the range being written
+    usize mappedOffset;
+    usize mappedSize;
+
+    void *fences[GPU_STREAM_FRAMES]; // GLsync
+
+    u32 overflows; // allocations that didn't fit; bump regionSize if nonzero
+};
+
+typedef void (*GpuStreamLoadFn)(void);
+typedef GpuStreamLoadFn (*GpuStreamGetProcAddressFn)(const char *name);
+
+// `regionSize` is the most that can be written in one frame
+bool GpuStreamInit(struct GpuStreamBuffer *stream, usize regionSize, GpuStreamGetProcAddressFn getProcAddress);
+void GpuStreamFree(struct GpuStreamBuffer *stream);
+
+// Moves on to the next region, waiting if the GPU is still reading it
+void GpuStreamBeginFrame(struct GpuStreamBuffer *stream);
+// Fences everything drawn from this frame's region
+void GpuStreamEndFrame(struct GpuStreamBuffer *stream);
+
+// Reserves up to `size` bytes to write into. `*offset` receives their offset
+// in `stream->buffer`. Returns NULL if the frame's region is full.
+void *GpuStreamMap(struct GpuStreamBuffer *stream, usize size, usize alignment, usize *offset);
+// Ends the write started by GpuStreamMap, keeping only the first `usedSize`
+// bytes of the reservation. Must be called before drawing from them.
+void GpuStreamUnmap(struct GpuStreamBuffer *stream, usize usedSize);
+
+#endif // GPU_STREAM_H
@@ -0,0 +1,98 @@
+#include "handle_pool.h"
+#include <assert.h>
+#include <string.h>
+
+#define SLOT_NONE UINT32_MAX
+
+// No handle's generation field can hold this, so nothing validates against
+// a retired slot
+#define GENERATION_RETIRED (HANDLE_GENERATION_MAX + 1)
+
+void HandlePoolInit(struct HandlePool *pool, u32 capacity, Allocator *alloc, void *user)
+{
+    assert(capacity <= HANDLE_MAX_CAPACITY);
+
+    memset(pool, 0, sizeof(*pool));
+    pool->freeHead = SLOT_NONE;
+    pool->freeTail = SLOT_NONE;
+
+    pool->memory = MemZeroAllocUser(alloc, 2 * capacity * sizeof(u32), user);
+    if (!pool->memory)
+    {
+        return;
+    }
+
+    pool->capacity = capacity;
+    pool->generations = pool->memory;
+    pool->next = pool->generations + capacity;
+
+    for (u32 i = 0; i < capacity; ++i)
+    {
+        pool->next[i] = i + 1 < capacity ? i + 1 : SLOT_NONE;
+    }
+    if (capacity)
+    {
+        pool->freeHead = 0;
+        pool->freeTail = capacity - 1;
+    }
+}
+
+void HandlePoolFree(struct HandlePool *pool, Allocator *alloc, void *user)
+{
+    MemFreeUser(alloc, pool->memory, user);
+    memset(pool, 0, sizeof(*pool));
+}
+
+Handle HandlePoolAlloc(struct HandlePool *pool)
+{
+    u32 index = pool->freeHead;
+    if (index == SLOT_NONE)
+    {
+        return HANDLE_INVALID;
+    }
+
+    pool->freeHead = pool->next[index];
+    if (pool->freeHead == SLOT_NONE)
+    {
+        pool->freeTail = SLOT_NONE;
+    }
+
+    // Even to odd: in use
+    u32 generation = ++pool->generations[index];
+    pool->count += 1;
+
+    return (generation << HANDLE_INDEX_BITS) | index;
+}
+
+bool HandlePoolRelease(struct HandlePool *pool, Handle handle)
+{
+    if (!HandlePoolIsValid(pool, handle))
+    {
+        return false;
+    }
+
+    u32 index = HandleIndex(handle);
+    pool->count -= 1;
+
+    if (pool->generations[index] == HANDLE_GENERATION_MAX)
+    {
+        pool->generations[index] = GENERATION_RETIRED;
+        return true;
+    }
+
+    // Odd to even: free, and no outstanding handle matches any more
+    pool->generations[index] += 1;
+
+    pool->next[index] = SLOT_NONE;
+    if (pool->freeTail == SLOT_NONE)
+    {
+        pool->freeHead = index;
+    }
+    else
+    {
+        pool->next[pool->freeTail] = index;
+    }
+    pool->freeTail = index;
+
+    return true;
+}
@@ -0,0 +1,67 @@
+#ifndef HANDLE_POOL_H
+#define HANDLE_POOL_H
+
+// Generational handles: stable references to slots in the caller's own
+// arrays that can tell when the slot they point at has been freed and
+// reused. A handle packs the slot index in its low HANDLE_INDEX_BITS and
+// the slot's generation in the rest. Freeing a slot bumps its generation,
+// so every handle to the old occupant stops validating.
+//
+// The pool only does the bookkeeping; the data lives in arrays the caller
+// sizes to the pool's capacity and indexes with HandleIndex. Freed slots
+// are reused oldest first, which spreads generation bumps over all of them
+// instead of wearing out one. A slot whose generation would wrap is retired
+// instead, so a stale handle can never validate again.
+
+#include "common.h"
+#include "allocator.h"
+
+typedef u32 Handle;
+
+#define HANDLE_INDEX_BITS 20
+#define HANDLE_INDEX_MASK ((1u << HANDLE_INDEX_BITS) - 1)
+#define HANDLE_GENERATION_MAX (UINT32_MAX >> HANDLE_INDEX_BITS)
+#define HANDLE_MAX_CAPACITY (1u << HANDLE_INDEX_BITS)
+
+// Handles only ever carry odd, in-use generations, so this one (generation
+// 0) never matches a slot, free or not
+#define HANDLE_INVALID 0u
+
+#define HandleIndex(handle) ((handle) & HANDLE_INDEX_MASK)
+#define HandleGeneration(handle) ((handle) >> HANDLE_INDEX_BITS)
+
+struct HandlePool
+{
+    u32 capacity;
+    u32 count;
+
+    // Per slot; the low bit of a generation is set while the slot is in use
+    u32 *generations;
+
+    // Free slots queued through `next`, taken at the head, returned at the tail
+    u32 *next;
+    u32 freeHead;
+    u32 freeTail;
+
+    void *memory;
+};
+
+// `capacity` is at most HANDLE_MAX_CAPACITY
+void HandlePoolInit(struct HandlePool *pool, u32 capacity, Allocator *alloc, void *user);
+void HandlePoolFree(struct HandlePool *pool, Allocator *alloc, void *user);
+
+// Returns HANDLE_INVALID when every slot is in use or retired
+Handle HandlePoolAlloc(struct HandlePool *pool);
+// Returns false for handles that are already stale
+bool HandlePoolRelease(struct HandlePool *pool, Handle handle);
+
+static inline bool HandlePoolIsValid(const struct HandlePool *pool, Handle handle)
+{
+    u32 index = HandleIndex(handle);
+    // Free slots have even generations; without the odd check a handle
+    // with an even generation, HANDLE_INVALID included, would match one
+    return (HandleGeneration(handle) & 1) != 0 && index < pool->capacity &&
+           pool->generations[index] == HandleGeneration(handle);
+}
+
+#endif // HANDLE_POOL_H
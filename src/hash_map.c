@@ -0,0 +1,320 @@
+#include "hash_map.h"
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ull
+#define FNV_PRIME 0x100000001b3ull
+
+// Control bytes. Full slots hold 7 hash bits with the top bit clear, so the
+// top bit alone tells free from full.
+#define CONTROL_EMPTY 0x80
+#define CONTROL_DELETED 0xFE
+
+#define SLOT_INVALID UINT32_MAX
+
+static u32 LowestBit(u32 mask)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (u32)index;
+#else
+    return (u32)__builtin_ctz(mask);
+#endif
+}
+
+// One bit per slot of the group whose control byte equals `value`
+static u32 GroupMatch(const u8 *group, u8 value)
+{
+#if defined(__SSE2__) || defined(_M_X64)
+    __m128i control = _mm_load_si128((const __m128i *)group);
+    return (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(control, _mm_set1_epi8((char)value)));
+#else
+    u32 mask = 0;
+    for (u32 i = 0; i < HASH_MAP_GROUP_SIZE; ++i)
+    {
+        mask |= (u32)(group[i] == value) << i;
+    }
+    return mask;
+#endif
+}
+
+// Empty or deleted slots of the group
+static u32 GroupMatchFree(const u8 *group)
+{
+#if defined(__SSE2__) || defined(_M_X64)
+    return (u32)_mm_movemask_epi8(_mm_load_si128((const __m128i *)group));
+#else
+    u32 mask = 0;
+    for (u32 i = 0; i < HASH_MAP_GROUP_SIZE; ++i)
+    {
+        mask |= (u32)(group[i] >> 7) << i;
+    }
+    return mask;
+#endif
+}
+
+// Ids and hashes are often sequential or share low bits, and both the group
+// index and the control bits come from the hash, so mix everything in
+static u64 HashKey(u64 key)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdull;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ull;
+    key ^= key >> 33;
+    return key;
+}
+
+static u8 ControlBits(u64 hash)
+{
+    return (u8)(hash & 0x7F);
+}
+
+static u32 MaxLoad(u32 capacity)
+{
+    return capacity - capacity / 8;
+}
+
+// Groups are probed at triangular offsets 1, 3, 6, ..., which visits every
+// group once when there is a power of two of them
+static u32 FindSlot(const struct HashMap *map, u64 key, u64 hash)
+{
+    if (!map->capacity)
+    {
+        return SLOT_INVALID;
+    }
+
+    u32 groupMask = map->capacity / HASH_MAP_GROUP_SIZE - 1;
+    u32 group = (u32)(hash >> 7) & groupMask;
+    u8 bits = ControlBits(hash);
+
+    for (u32 step = 1;; ++step)
+    {
+        const u8 *control = map->control + group * HASH_MAP_GROUP_SIZE;
+        u32 matches = GroupMatch(control, bits);
+        while (matches)
+        {
+            u32 slot = group * HASH_MAP_GROUP_SIZE + LowestBit(matches);
+            if (map->keys[slot] == key)
+            {
+                return slot;
+            }
+            matches &= matches - 1;
+        }
+
+        // An insert would have stopped here, so the key is nowhere further
+        if (GroupMatch(control, CONTROL_EMPTY))
+        {
+            return SLOT_INVALID;
+        }
+
+        group = (group + step) & groupMask;
+    }
+}
+
+// First empty or deleted slot along the key's probe sequence. The load
+// limit guarantees there is one.
+static u32 FindFreeSlot(const struct HashMap *map, u64 hash)
+{
+    u32 groupMask = map->capacity / HASH_MAP_GROUP_SIZE - 1;
+    u32 group = (u32)(hash >> 7) & groupMask;
+
+    for (u32 step = 1;; ++step)
+    {
+        u32 free = GroupMatchFree(map->control + group * HASH_MAP_GROUP_SIZE);
+        if (free)
+        {
+            return group * HASH_MAP_GROUP_SIZE + LowestBit(free);
+        }
+        group = (group + step) & groupMask;
+    }
+}
+
+static bool Resize(struct HashMap *map, u32 capacity)
+{
+    usize totalSize = capacity * (sizeof(u8) + sizeof(u64) + sizeof(u32));
+    u8 *memory = MemAllocUser(map->alloc, totalSize, map->user);
+    if (!memory)
+    {
+        return false;
+    }
+
+    struct HashMap old = *map;
+
+    // Controls first, where the allocation's alignment is; a group count
+    // of them keeps the keys 8 byte aligned
+    map->memory = memory;
+    map->control = memory;
+    map->keys = (u64 *)(memory + capacity);
+    map->values = (u32 *)(memory + capacity * (sizeof(u8) + sizeof(u64)));
+    map->capacity = capacity;
+    map->growthLeft = MaxLoad(capacity) - old.count;
+    memset(map->control, CONTROL_EMPTY, capacity);
+
+    for (u32 slot = 0; slot < old.capacity; ++slot)
+    {
+        if (old.control[slot] & 0x80)
+        {
+            continue;
+        }
+
+        u64 key = old.keys[slot];
+        u32 newSlot = FindFreeSlot(map, HashKey(key));
+        map->control[newSlot] = old.control[slot];
+        map->keys[newSlot] = key;
+        map->values[newSlot] = old.values[slot];
+    }
+
+    MemFreeUser(map->alloc, old.memory, map->user);
+    return true;
+}
+
+void HashMapInit(struct HashMap *map, u32 capacity, Allocator *alloc, void *user)
+{
+    memset(map, 0, sizeof(*map));
+    map->alloc = alloc;
+    map->user = user;
+
+    if (capacity)
+    {
+        u32 slots = HASH_MAP_GROUP_SIZE;
+        while (MaxLoad(slots) < capacity)
+        {
+            slots *= 2;
+        }
+        Resize(map, slots);
+    }
+}
+
+void HashMapFree(struct HashMap *map)
+{
+    MemFreeUser(map->alloc, map->memory, map->user);
+
+    Allocator *alloc = map->alloc;
+    void *user = map->user;
+    memset(map, 0, sizeof(*map));
+    map->alloc = alloc;
+    map->user = user;
+}
+
+void HashMapClear(struct HashMap *map)
+{
+    if (map->capacity)
+    {
+        memset(map->control, CONTROL_EMPTY, map->capacity);
+    }
+    map->count = 0;
+    map->growthLeft = MaxLoad(map->capacity);
+}
+
+bool HashMapGet(const struct HashMap *map, u64 key, u32 *value)
+{
+    u32 slot = FindSlot(map, key, HashKey(key));
+    if (slot == SLOT_INVALID)
+    {
+        return false;
+    }
+
+    *value = map->values[slot];
+    return true;
+}
+
+bool HashMapPut(struct HashMap *map, u64 key, u32 value)
+{
+    u64 hash = HashKey(key);
+    u32 slot = FindSlot(map, key, hash);
+    if (slot != SLOT_INVALID)
+    {
+        map->values[slot] = value;
+        return true;
+    }
+
+    // Reusing a tombstone costs nothing; taking an empty slot needs growth
+    // room, and without it the table is rehashed first. Mostly tombstones
+    // only need clearing out at the same size.
+    slot = map->capacity ? FindFreeSlot(map, hash) : SLOT_INVALID;
+    if (slot == SLOT_INVALID || (map->growthLeft == 0 && map->control[slot] == CONTROL_EMPTY))
+    {
+        u32 capacity = map->capacity ? map->capacity : HASH_MAP_GROUP_SIZE;
+        if ((map->count + 1) * 2 > MaxLoad(capacity))
+        {
+            capacity *= 2;
+        }
+        if (!Resize(map, capacity))
+        {
+            return false;
+        }
+        slot = FindFreeSlot(map, hash);
+    }
+
+    if (map->control[slot] == CONTROL_EMPTY)
+    {
+        map->growthLeft -= 1;
+    }
+    map->control[slot] = ControlBits(hash);
+    map->keys[slot] = key;
+    map->values[slot] = value;
+    map->count += 1;
+    return true;
+}
+
+bool HashMapRemove(struct HashMap *map, u64 key)
+{
+    u32 slot = FindSlot(map, key, HashKey(key));
+    if (slot == SLOT_INVALID)
+    {
+        return false;
+    }
+
+    // A group that still has an empty slot was never full, so no probe
+    // ever went past it and the slot can go straight back to empty
+    const u8 *group = map->control + (slot & ~(u32)(HASH_MAP_GROUP_SIZE - 1));
+    if (GroupMatch(group, CONTROL_EMPTY))
+    {
+        map->control[slot] = CONTROL_EMPTY;
+        map->growthLeft += 1;
+    }
+    else
+    {
+        map->control[slot] = CONTROL_DELETED;
+    }
+
+    map->count -= 1;
+    return true;
+}
+
+bool HashMapNext(const struct HashMap *map, u32 *cursor, u64 *key, u32 *value)
+{
+    for (u32 slot = *cursor; slot < map->capacity; ++slot)
+    {
+        if (!(map->control[slot] & 0x80))
+        {
+            *key = map->keys[slot];
+            *value = map->values[slot];
+            *cursor = slot + 1;
+            return true;
+        }
+    }
+
+    *cursor = map->capacity;
+    return false;
+}
+
+u64 HashMapHashString(const char *string)
+{
+    u64 hash = FNV_OFFSET_BASIS;
+    for (; *string; ++string)
+    {
+        hash ^= (u8)*string;
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
@@ -0,0 +1,65 @@
+#ifndef HASH_MAP_H
+#define HASH_MAP_H
+
+// Open addressing hash map from u64 keys to u32 values, laid out the way
+// SwissTable does it. Every slot has a control byte: empty, deleted, or the
+// low 7 bits of the key's hash. Slots come in groups of 16, and a probe
+// loads a group's control bytes into one SSE2 register, compares all 16
+// against the hash bits at once and only touches the keys of the matches.
+// Almost every lookup is one group, one key compare.
+//
+// Keys are usually ids or string hashes (HashMapHashString); values are
+// usually indices into the caller's own arrays, which keeps the table small.
+// Controls, keys and values are separate arrays in one allocation, so
+// probing stays within the control bytes until there is a likely match.
+//
+// The table grows by doubling at 7/8 full. Removal leaves a tombstone only
+// when the group was ever full, and a rehash clears them out.
+
+#include "common.h"
+#include "allocator.h"
+
+#define HASH_MAP_GROUP_SIZE 16
+
+struct HashMap
+{
+    u8 *control; // capacity control bytes, 16 byte aligned
+    u64 *keys;
+    u32 *values;
+
+    u32 capacity;    // slots, a power of two and at least a group
+    u32 count;
+    u32 growthLeft;  // inserts into empty slots before a rehash
+
+    Allocator *alloc;
+    void *user;
+    void *memory;
+};
+
+// Room for `capacity` items without growing; 0 allocates on first insert
+void HashMapInit(struct HashMap *map, u32 capacity, Allocator *alloc, void *user);
+void HashMapFree(struct HashMap *map);
+void HashMapClear(struct HashMap *map);
+
+// Returns false if the key is not in the map
+bool HashMapGet(const struct HashMap *map, u64 key, u32 *value);
+// Inserts or overwrites. Returns false if the table had to grow and the
+// allocation failed.
+bool HashMapPut(struct HashMap *map, u64 key, u32 value);
+// Returns false if the key was not in the map
+bool HashMapRemove(struct HashMap *map, u64 key);
+
+// Walks every item in slot order, which is not insertion order:
+//
+//   u32 cursor = 0;
+//   u64 key;
+//   u32 value;
+//   while (HashMapNext(map, &cursor, &key, &value)) ...
+//
+// The map must not change during the walk.
+bool HashMapNext(const struct HashMap *map, u32 *cursor, u64 *key, u32 *value);
+
+// FNV-1a, for keying the map by name
+u64 HashMapHashString(const char *string);
+
+#endif // HASH_MAP_H
@@ -0,0 +1,39 @@
+#include "input_queue.h"
+#include <string.h>
+
+void InputQueueInit(struct InputQueue *queue)
+{
+    memset(queue->events, 0, sizeof(queue->events));
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+    atomic_init(&queue->dropped, 0);
+}
+
+bool InputQueuePush(struct InputQueue *queue, const struct InputEvent *event)
+{
+    u32 head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    u32 tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    if (head - tail >= INPUT_QUEUE_CAPACITY)
+    {
+        atomic_fetch_add_explicit(&queue->dropped, 1, memory_order_relaxed);
+        return false;
+    }
+
+    queue->events[head & (INPUT_QUEUE_CAPACITY - 1)] = *event;
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return true;
+}
+
+bool InputQueuePop(struct InputQueue *queue, struct InputEvent *event)
+{
+    u32 tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    u32 head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    if (tail == head)
+    {
+        return false;
+    }
+
+    *event = queue->events[tail & (INPUT_QUEUE_CAPACITY - 1)];
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return true;
+}
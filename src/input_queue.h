@@ -0,0 +1,58 @@
+#ifndef INPUT_QUEUE_H
+#define INPUT_QUEUE_H
+
+// Single producer, single consumer ring of timestamped input events. The
+// window thread pushes from the GLFW callbacks and the render thread pops
+// them right before simulating, so neither ever waits for the other.
+//
+// The ring is lock-free: the producer only writes `head`, the consumer only
+// writes `tail`, and each reads the other's index with acquire ordering.
+
+#include <stdatomic.h>
+
+#include "common.h"
+
+#define INPUT_QUEUE_CAPACITY 256 // power of two
+
+enum InputEventKind
+{
+    InputEvent_Key,
+    InputEvent_FramebufferSize,
+};
+
+struct InputEvent
+{
+    u32 kind;
+    f64 time; // glfwGetTime() when the event reached the window thread
+    union
+    {
+        struct
+        {
+            s32 key;
+            bool pressed;
+        } key;
+        struct
+        {
+            s32 width;
+            s32 height;
+        } framebufferSize;
+    };
+};
+
+struct InputQueue
+{
+    struct InputEvent events[INPUT_QUEUE_CAPACITY];
+    _Alignas(64) _Atomic u32 head; // next slot the producer writes
+    _Alignas(64) _Atomic u32 tail; // next slot the consumer reads
+
+    _Atomic u32 dropped; // events pushed while full
+};
+
+void InputQueueInit(struct InputQueue *queue);
+
+// Producer side. Returns false and drops the event when the queue is full.
+bool InputQueuePush(struct InputQueue *queue, const struct InputEvent *event);
+// Consumer side. Returns false when the queue is empty.
+bool InputQueuePop(struct InputQueue *queue, struct InputEvent *event);
+
+#endif // INPUT_QUEUE_H
@@ -0,0 +1,323 @@
+#include "jobs.h"
+#include <assert.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "allocator.h"
+#include "profiler.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#include <immintrin.h>
+#define CPU_PAUSE() _mm_pause()
+#else
+#define CPU_PAUSE() ((void)0)
+#endif
+
+// Spins before an idle worker goes to sleep
+#define JOB_IDLE_SPINS 256
+
+#define JOB_THREAD_UNREGISTERED UINT32_MAX
+
+static _Thread_local u32 jobThreadIndex = JOB_THREAD_UNREGISTERED;
+
+struct WorkerStart
+{
+    struct JobSystem *system;
+    u32 threadIndex;
+};
+
+// Deque operations after Lê et al., "Correct and Efficient Work-Stealing
+// for Weak Memory Models" (2013)
+static bool DequePush(struct JobDeque *deque, struct Job *job)
+{
+    s64 bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    s64 top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    if (bottom - top >= JOB_DEQUE_CAPACITY)
+    {
+        return false;
+    }
+
+    atomic_store_explicit(&deque->jobs[bottom & (JOB_DEQUE_CAPACITY - 1)], job, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    return true;
+}
+
+static struct Job *DequePop(struct JobDeque *deque)
+{
+    s64 bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    s64 top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    struct Job *job = NULL;
+    if (top <= bottom)
+    {
+        job = atomic_load_explicit(&deque->jobs[bottom & (JOB_DEQUE_CAPACITY - 1)], memory_order_relaxed);
+        if (top == bottom)
+        {
+            // Last job; race thieves for it
+            if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed))
+            {
+                job = NULL;
+            }
+            atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        }
+    }
+    else
+    {
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    }
+
+    return job;
+}
+
+static struct Job *DequeSteal(struct JobDeque *deque)
+{
+    s64 top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    s64 bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+
+    if (top < bottom)
+    {
+        struct Job *job = atomic_load_explicit(&deque->jobs[top & (JOB_DEQUE_CAPACITY - 1)], memory_order_relaxed);
+        if (atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed))
+        {
+            return job;
+        }
+    }
+
+    return NULL;
+}
+
+static struct Job *GetJob(struct JobSystem *system)
+{
+    assert(jobThreadIndex < system->threadCount);
+    struct JobThread *self = &system->threads[jobThreadIndex];
+
+    struct Job *job = DequePop(&self->deque);
+    if (job)
+    {
+        return job;
+    }
+
+    // Pick a random victim to start from so thieves spread out
+    self->stealSeed = self->stealSeed * 1664525u + 1013904223u;
+    u32 start = self->stealSeed % system->threadCount;
+    for (u32 i = 0; i < system->threadCount; ++i)
+    {
+        u32 victim = (start + i) % system->threadCount;
+        if (victim == jobThreadIndex)
+        {
+            continue;
+        }
+        job = DequeSteal(&system->threads[victim].deque);
+        if (job)
+        {
+            return job;
+        }
+    }
+
+    return NULL;
+}
+
+static void Execute(struct JobSystem *system, struct Job *job)
+{
+    atomic_fetch_sub_explicit(&system->queuedJobs, 1, memory_order_relaxed);
+
+    // The slot may be reused as soon as busy drops, so read the counter first
+    struct JobCounter *counter = job->counter;
+    PROFILE_BEGIN("Job");
+    job->function(job->data, job->start, job->end);
+    PROFILE_END();
+    atomic_store_explicit(&job->busy, false, memory_order_release);
+    atomic_fetch_sub_explicit(&counter->value, 1, memory_order_release);
+}
+
+static void *WorkerMain(void *user)
+{
+    struct WorkerStart start = *(struct WorkerStart *)user;
+    MemFree(DefaultAllocator, user);
+
+    struct JobSystem *system = start.system;
+    jobThreadIndex = start.threadIndex;
+    PROFILE_THREAD_NAME("Job worker");
+
+    u32 idleSpins = 0;
+    while (!atomic_load_explicit(&system->quit, memory_order_acquire))
+    {
+        struct Job *job = GetJob(system);
+        if (job)
+        {
+            Execute(system, job);
+            idleSpins = 0;
+            continue;
+        }
+
+        if (++idleSpins < JOB_IDLE_SPINS)
+        {
+            CPU_PAUSE();
+            continue;
+        }
+
+        pthread_mutex_lock(&system->sleepMutex);
+        atomic_fetch_add(&system->sleepingWorkers, 1);
+        while (atomic_load(&system->queuedJobs) == 0 && !atomic_load(&system->quit))
+        {
+            pthread_cond_wait(&system->wake, &system->sleepMutex);
+        }
+        atomic_fetch_sub(&system->sleepingWorkers, 1);
+        pthread_mutex_unlock(&system->sleepMutex);
+        idleSpins = 0;
+    }
+
+    return NULL;
+}
+
+bool JobSystemInit(struct JobSystem *system, u32 threadCount)
+{
+    memset(system, 0, sizeof(*system));
+
+    if (threadCount == 0)
+    {
+        long cpuCount = sysconf(_SC_NPROCESSORS_ONLN);
+        threadCount = cpuCount > 0 ? (u32)cpuCount : 1;
+    }
+    if (threadCount > JOB_MAX_THREADS)
+    {
+        threadCount = JOB_MAX_THREADS;
+    }
+
+    system->threads = MemZeroAlloc(DefaultAllocator, threadCount * sizeof(*system->threads));
+    if (!system->threads)
+    {
+        return false;
+    }
+
+    system->threadCount = threadCount;
+    for (u32 i = 0; i < threadCount; ++i)
+    {
+        system->threads[i].stealSeed = i * 2654435761u + 1;
+    }
+
+    pthread_mutex_init(&system->sleepMutex, NULL);
+    pthread_cond_init(&system->wake, NULL);
+
+    // Thread 0 is whichever thread registers to submit; it runs jobs while
+    // it waits
+    for (u32 i = 1; i < threadCount; ++i)
+    {
+        struct WorkerStart *start = MemAlloc(DefaultAllocator, sizeof(*start));
+        start->system = system;
+        start->threadIndex = i;
+        if (pthread_create(&system->workers[i], NULL, WorkerMain, start) != 0)
+        {
+            MemFree(DefaultAllocator, start);
+            system->threadCount = i;
+            break;
+        }
+    }
+
+    return true;
+}
+
+void JobRegisterSubmitThread(void)
+{
+    jobThreadIndex = 0;
+}
+
+void JobSystemShutdown(struct JobSystem *system)
+{
+    pthread_mutex_lock(&system->sleepMutex);
+    atomic_store(&system->quit, true);
+    pthread_cond_broadcast(&system->wake);
+    pthread_mutex_unlock(&system->sleepMutex);
+
+    for (u32 i = 1; i < system->threadCount; ++i)
+    {
+        pthread_join(system->workers[i], NULL);
+    }
+
+    pthread_mutex_destroy(&system->sleepMutex);
+    pthread_cond_destroy(&system->wake);
+    MemFree(DefaultAllocator, system->threads);
+    system->threads = NULL;
+    system->threadCount = 0;
+}
+
+void JobSubmitRange(struct JobSystem *system, u32 count, u32 batchSize, JobFn *function, void *data, struct JobCounter *counter)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    if (batchSize == 0)
+    {
+        batchSize = 1;
+    }
+
+    assert(jobThreadIndex < system->threadCount);
+    struct JobThread *self = &system->threads[jobThreadIndex];
+    u32 jobCount = (count + batchSize - 1) / batchSize;
+
+    atomic_fetch_add_explicit(&counter->value, jobCount, memory_order_relaxed);
+
+    for (u32 start = 0; start < count; start += batchSize)
+    {
+        u32 end = start + batchSize < count ? start + batchSize : count;
+        atomic_fetch_add(&system->queuedJobs, 1);
+
+        // With deeply nested waits every pool slot can still be in flight;
+        // then, or if the deque is full, just do the work here
+        struct Job *job = &self->pool[self->poolNext & (JOB_DEQUE_CAPACITY - 1)];
+        if (atomic_load_explicit(&job->busy, memory_order_acquire))
+        {
+            struct Job inlineJob = {function, data, start, end, counter, false};
+            Execute(system, &inlineJob);
+            continue;
+        }
+
+        ++self->poolNext;
+        job->function = function;
+        job->data = data;
+        job->start = start;
+        job->end = end;
+        job->counter = counter;
+        atomic_store_explicit(&job->busy, true, memory_order_relaxed);
+
+        if (!DequePush(&self->deque, job))
+        {
+            Execute(system, job);
+        }
+    }
+
+    if (atomic_load(&system->sleepingWorkers) > 0)
+    {
+        pthread_mutex_lock(&system->sleepMutex);
+        pthread_cond_broadcast(&system->wake);
+        pthread_mutex_unlock(&system->sleepMutex);
+    }
+}
+
+void JobWait(struct JobSystem *system, struct JobCounter *counter)
+{
+    while (atomic_load_explicit(&counter->value, memory_order_acquire) != 0)
+    {
+        struct Job *job = GetJob(system);
+        if (job)
+        {
+            Execute(system, job);
+        }
+        else
+        {
+            CPU_PAUSE();
+        }
+    }
+}
+
+void JobParallelFor(struct JobSystem *system, u32 count, u32 batchSize, JobFn *function, void *data)
+{
+    struct JobCounter counter = {0};
+    JobSubmitRange(system, count, batchSize, function, data, &counter);
+    JobWait(system, &counter);
+}
@@ -0,0 +1,86 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+// Work-stealing job system. Every thread, the submitting thread included,
+// owns a Chase-Lev deque: it pushes and pops its own jobs at the bottom
+// while idle threads steal from the top of the others. Completion is
+// tracked through counters; waiting on one runs other jobs instead of
+// blocking.
+//
+// Jobs may be submitted from inside jobs and from the one thread that
+// called JobRegisterSubmitThread, which owns deque 0. No other thread may
+// submit or wait: a second owner of deque 0 would break the deque.
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "common.h"
+
+#define JOB_MAX_THREADS 32
+#define JOB_DEQUE_CAPACITY 4096 // power of two; also the per-thread job pool size
+
+typedef void JobFn(void *data, u32 start, u32 end);
+
+struct JobCounter
+{
+    _Atomic u32 value;
+};
+
+struct Job
+{
+    JobFn *function;
+    void *data;
+    u32 start;
+    u32 end;
+    struct JobCounter *counter;
+    _Atomic bool busy; // set while queued or running, so the pool slot isn't reused
+};
+
+struct JobDeque
+{
+    _Atomic s64 top;
+    _Atomic s64 bottom;
+    _Atomic(struct Job *) jobs[JOB_DEQUE_CAPACITY];
+};
+
+struct JobThread
+{
+    struct JobDeque deque;
+    struct Job pool[JOB_DEQUE_CAPACITY];
+    u32 poolNext;
+    u32 stealSeed;
+};
+
+struct JobSystem
+{
+    struct JobThread *threads;
+    u32 threadCount; // including the main thread
+    pthread_t workers[JOB_MAX_THREADS];
+
+    _Atomic u32 queuedJobs;
+    _Atomic u32 sleepingWorkers;
+    _Atomic bool quit;
+    pthread_mutex_t sleepMutex;
+    pthread_cond_t wake;
+};
+
+typedef void JobParallelForFn(struct JobSystem *system, u32 count, u32 batchSize, JobFn *function, void *data);
+
+// threadCount of 0 uses one thread per online CPU, the submitting thread
+// included. Doesn't register the calling thread.
+bool JobSystemInit(struct JobSystem *system, u32 threadCount);
+void JobSystemShutdown(struct JobSystem *system);
+
+// Makes the calling thread the submitting thread, thread 0. Call it once,
+// from that thread, before it submits anything.
+void JobRegisterSubmitThread(void);
+
+// Queues `function(data, start, end)` over [0, count) in chunks of batchSize.
+// The counter is incremented by the number of jobs and drops back as they finish.
+void JobSubmitRange(struct JobSystem *system, u32 count, u32 batchSize, JobFn *function, void *data, struct JobCounter *counter);
+void JobWait(struct JobSystem *system, struct JobCounter *counter);
+
+// JobSubmitRange followed by JobWait
+void JobParallelFor(struct JobSystem *system, u32 count, u32 batchSize, JobFn *function, void *data);
+
+#endif // JOBS_H
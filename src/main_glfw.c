@@ -1,6 +1,15 @@
 #include <assert.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <dlfcn.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <glad/gl.h>
 
 #define GLFW_INCLUDE_NONE
@@ -8,54 +17,156 @@
 
 #include <cglm/cglm.h>
 
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
-
 #include "common.h"
 #include "allocator.h"
+#include "atlas_sprites.h"
 #include "shaders.h"
+#include "sprite_batch.h"
+#include "game.h"
+#include "asset_pack.h"
+#include "asset_stream.h"
+#include "jobs.h"
+#include "profiler.h"
+#include "tilemap.h"
+#include "gpu_stream.h"
+#include "gl_state.h"
+#include "render_queue.h"
+#include "camera.h"
+#include "input_queue.h"
+#include "frame_pacer.h"
+#include "replay.h"
+#include "memory_tracker.h"
+
+#define FRAME_SCRATCH_SIZE (64u << 20)
+#define GAME_MEMORY_SIZE (64u << 20)
+// Game memory is mapped here, so replay snapshots, which hold pointers into
+// it, can be restored by later runs
+#define GAME_MEMORY_BASE_ADDRESS 0x200000000000ull
+#define RENDER_LIST_CAPACITY (1u << 18)
+// Sprites in runs, e.g. particles
+#define RENDER_LIST_RUN_CAPACITY (1u << 17)
+// Room for every sprite plus the visible tilemap chunks
+#define RENDER_QUEUE_CAPACITY (RENDER_LIST_CAPACITY + 4096)
+
+#define RENDER_LAYER_WORLD 0
+#define SPRITE_PROGRAM_SLOT 0
+
+// World units visible vertically; the width follows the window's aspect
+#define CAMERA_VIEW_HEIGHT 6.0f
+#define CAMERA_START_X 4.0f
+#define CAMERA_START_Y 3.0f
+
+#define ASSET_PACK_PATH "./resources.pack"
+#define ASSET_STREAM_WORKERS 2
+#define ASSET_STREAM_USE_PIXEL_BUFFERS true
+// Texture bytes uploaded per frame, so streaming never hitches a frame
+#define ASSET_UPLOAD_BUDGET_PER_FRAME (1u << 20)
+
+#define GAME_LIBRARY_PATH "./libgamelib.so"
+#define GAME_LIBRARY_LOADED_PATH_FORMAT "./libgamelib_loaded_%u.so"
+// Wait until the library hasn't been written to for this long before loading it,
+// so we don't pick up a half-linked file
+#define GAME_LIBRARY_SETTLE_SECONDS 0.25
+
+#define SHADER_CACHE_DIRECTORY "./shader_cache"
+// Shader sources are watched here and recompiled when saved
+#ifndef FEJNANDO_RESOURCE_DIR
+#define FEJNANDO_RESOURCE_DIR "../resources"
+#endif
+
+// Most dynamic vertex data one frame can stream; three of these are allocated
+#define GPU_STREAM_REGION_SIZE (16u << 20)
+
+#define LEVEL_WIDTH 1024
+#define LEVEL_HEIGHT 1024
+#define LEVEL_TILE_SIZE 0.25f
+
+#define PROFILER_TRACE_PATH "./frame_trace.json"
+#define PROFILER_TRACE_FRAMES 60u
 
-#define LENGTH_UNIT_SCALE 32
+// F5 cycles through the pacing modes at runtime
+#define FRAME_PACE_MODE FramePace_Vsync
+#define FRAME_PACE_TARGET_FPS 60.0
+// Frames the CPU may queue ahead of the GPU; each one is a frame of latency
+#define FRAME_PACE_MAX_FRAMES_IN_FLIGHT 2
 
-struct Entity
+// F6 starts and stops recording; play back with --replay <path>
+#define REPLAY_RECORD_PATH "./session.replay"
+
+// Per subsystem memory budgets; the report at exit flags any tag whose
+// peak went over
+#define MEMORY_BUDGET_APP (FRAME_SCRATCH_SIZE + (1u << 20))
+#define MEMORY_BUDGET_RENDER (32u << 20)
+#define MEMORY_BUDGET_TILEMAP (16u << 20)
+
+#define SIM_TICK_RATE 60.0
+#define SIM_MAX_CATCH_UP_STEPS 5
+
+struct GameLibrary
 {
-    u32 id;
-    vec2 position;
-    vec2 velocity;
-    vec2 acceleration;
+    void *handle;
+    GameUpdateFn *update;
+    GameRenderFn *render;
 
-    vec2 dimension;
+    struct timespec lastWriteTime;
+    u32 generation;
+    char loadedPath[64];
 };
 
+// The app state itself is allocated from appTag, so the tags live outside it
+static struct MemoryTag appTag;
+static struct MemoryTag renderTag;
+static struct MemoryTag tilemapTag;
+
 struct AppState
 {
     Allocator *alloc;
 
-    struct Entity player;
-
-    bool keyLeft;
-    bool keyRight;
-    bool keyUp;
-    bool keyDown;
-
+    // The main thread only pumps window events; the render thread owns the
+    // GL context and runs the simulation
+    GLFWwindow *window;
+    pthread_t renderThread;
+    _Atomic bool quit;
+    struct InputQueue inputQueue;
+    struct FramePacer pacer; // render thread only
+
+    // Time from a key event reaching the window thread to the buffer swap
+    // that first showed its effect, over frames that consumed key events
+    f64 inputLatencySum;
+    f64 inputLatencyMax;
+    u32 inputLatencyFrames;
+
+    void *frameScratchMemory;
+    struct FrameArena frameArena;
+
+    struct JobSystem jobs;
+    struct PlatformApi platform;
+    struct GameMemory gameMemory;
+    struct GameLibrary gameLibrary;
+    struct GameInput input;
+    struct Replay replay;
+    f64 replayStartTime;
+    bool replayMatched;
+
+    f64 tickRate;
+    u32 maxCatchUpSteps;
+
+    struct ShaderManager shaders;
+    u32 spriteShader;           // shader manager handle
+    u32 spriteShaderGeneration; // generation the uniform locations below belong to
     GLuint shaderProgram;
-    GLuint spriteVao;
     GLuint multiplyColorLocation;
-    GLuint matModelLocation;
-    GLuint matViewLocation;
-    GLuint matProjectionLocation;
-    GLuint tileCoordLocation;
 
-    u32 viewMode;
-};
+    struct AssetPack assets;
+    struct AssetStream assetStream;
+    struct GpuStreamBuffer gpuStream;
+    struct SpriteBatch spriteBatch;
+    struct RenderQueue renderQueue;
+    struct Camera camera;
+    struct Tilemap tilemap;
+    u32 atlasTextures[SPRITE_ATLAS_PAGE_COUNT]; // asset stream handles
 
-static vec3 quadVertices[] = {
-    { -1.0f, -1.0f,  0.0f },
-    {  1.0f, -1.0f,  0.0f },
-    {  1.0f,  1.0f,  0.0f },
-    {  1.0f,  1.0f,  0.0f },
-    { -1.0f,  1.0f,  0.0f },
-    { -1.0f, -1.0f,  0.0f },
+    u32 viewMode;
 };
 
 #if 0
@@ -90,128 +201,343 @@ static const char *fragmentShaderSource =
 
 #endif
 
-static s32 GetFileSize(const char *path)
+// Checkered ground with scattered props, big enough that culling matters
+static void GenerateLevel(struct Tilemap *map)
 {
-    FILE *file = fopen(path, "rb");
-    if (!file)
+    for (u32 y = 0; y < map->height; ++y)
     {
-        return -1;
+        for (u32 x = 0; x < map->width; ++x)
+        {
+            Tile tile = (Tile)(1 + ((x / 4 + y / 4) % 2) * 8);
+
+            u32 hash = (x * 73856093u) ^ (y * 19349663u);
+            if (hash % 61 == 0)
+            {
+                tile = (Tile)(17 + (hash / 61) % 8);
+            }
+
+            TilemapSet(map, x, y, tile);
+        }
+    }
+}
+
+static bool GetLastWriteTime(const char *path, struct timespec *writeTime)
+{
+    struct stat fileStat;
+    if (stat(path, &fileStat) != 0)
+    {
+        return false;
+    }
+
+    *writeTime = fileStat.st_mtim;
+    return true;
+}
+
+static bool CopyFile(const char *sourcePath, const char *destPath)
+{
+    FILE *source = fopen(sourcePath, "rb");
+    if (!source)
+    {
+        return false;
+    }
+
+    FILE *dest = fopen(destPath, "wb");
+    if (!dest)
+    {
+        fclose(source);
+        return false;
     }
 
-    fseek(file, 0, SEEK_END);
-    long length = ftell(file);
-    fclose(file);
+    u8 buffer[1 << 14];
+    usize numRead;
+    bool ok = true;
+    while ((numRead = fread(buffer, 1, sizeof(buffer), source)) > 0)
+    {
+        if (fwrite(buffer, 1, numRead, dest) != numRead)
+        {
+            ok = false;
+            break;
+        }
+    }
 
-    return (s32)length;
+    fclose(source);
+    ok = (fclose(dest) == 0) && ok;
+    return ok;
 }
 
-static u32 ReadBytesFromFile(const char *filePath, usize numBytes, u8 *buffer)
+static void UnloadGameLibrary(struct GameLibrary *library)
 {
-    FILE *file = fopen(filePath, "rb");
+    if (library->handle)
+    {
+        dlclose(library->handle);
+        unlink(library->loadedPath);
+    }
+
+    library->handle = NULL;
+    library->update = NULL;
+    library->render = NULL;
+}
+
+// Loads a private copy of the game library, so the original can be rebuilt
+// while we run and dlopen never hands back the cached old image. The old
+// library stays loaded if the new one fails to load.
+static bool LoadGameLibrary(struct GameLibrary *library)
+{
+    struct timespec writeTime;
+    if (!GetLastWriteTime(GAME_LIBRARY_PATH, &writeTime))
+    {
+        return false;
+    }
+
+    char loadedPath[sizeof(library->loadedPath)];
+    snprintf(loadedPath, sizeof(loadedPath), GAME_LIBRARY_LOADED_PATH_FORMAT, library->generation + 1);
+
+    if (!CopyFile(GAME_LIBRARY_PATH, loadedPath))
+    {
+        fprintf(stderr, "Could not copy %s to %s.\n", GAME_LIBRARY_PATH, loadedPath);
+        return false;
+    }
+
+    void *handle = dlopen(loadedPath, RTLD_NOW | RTLD_LOCAL);
+    if (!handle)
+    {
+        fprintf(stderr, "Could not load game library: %s\n", dlerror());
+        unlink(loadedPath);
+        return false;
+    }
+
+    // Assign through void ** since ISO C has no object -> function pointer conversion
+    GameUpdateFn *update;
+    GameRenderFn *render;
+    *(void **)&update = dlsym(handle, GAME_UPDATE_SYMBOL);
+    *(void **)&render = dlsym(handle, GAME_RENDER_SYMBOL);
+    if (!update || !render)
+    {
+        fprintf(stderr, "Game library is missing its entry points.\n");
+        dlclose(handle);
+        unlink(loadedPath);
+        return false;
+    }
+
+    UnloadGameLibrary(library);
+
+    library->handle = handle;
+    library->update = update;
+    library->render = render;
+    library->lastWriteTime = writeTime;
+    library->generation += 1;
+    memcpy(library->loadedPath, loadedPath, sizeof(loadedPath));
+
+    return true;
+}
+
+static void ReloadGameLibraryIfChanged(struct GameLibrary *library)
+{
+    struct timespec writeTime;
+    if (!GetLastWriteTime(GAME_LIBRARY_PATH, &writeTime))
+    {
+        return;
+    }
 
-    u32 numRead = fread(buffer, numBytes, 1, file);
-    fclose(file);
-    return numRead;
+    if (writeTime.tv_sec == library->lastWriteTime.tv_sec && writeTime.tv_nsec == library->lastWriteTime.tv_nsec)
+    {
+        return;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    f64 age = (f64)(now.tv_sec - writeTime.tv_sec) + (f64)(now.tv_nsec - writeTime.tv_nsec)*1e-9;
+    if (age < GAME_LIBRARY_SETTLE_SECONDS)
+    {
+        return;
+    }
+
+    if (LoadGameLibrary(library))
+    {
+        printf("Reloaded game library (generation %u).\n", library->generation);
+    }
+    else
+    {
+        // Don't retry, and log, every frame; wait for the next rebuild
+        library->lastWriteTime = writeTime;
+    }
 }
 
-// Function to set up OpenGL state and render the triangle
-void Render(struct AppState *appState)
+// Uniform locations can change whenever the program is rebuilt
+void RefreshShaderProgram(struct AppState *appState)
 {
-    const float dt = 0.1f;
+    u32 generation = ShaderManagerGeneration(&appState->shaders, appState->spriteShader);
+    if (generation == appState->spriteShaderGeneration)
+    {
+        return;
+    }
 
-    struct Entity *player = &appState->player;
+    appState->spriteShaderGeneration = generation;
+    appState->shaderProgram = ShaderManagerProgram(&appState->shaders, appState->spriteShader);
+    appState->multiplyColorLocation = glGetUniformLocation(appState->shaderProgram, "multiplyColor");
+    CameraBindProgram(appState->shaderProgram);
 
-    player->acceleration[0] = dt*((appState->keyLeft ? -1.0f : 0.0f) + (appState->keyRight ? 1.0f : 0.0f));
-    player->acceleration[1] = dt*((appState->keyUp ? -1.0f : 0.0f) + (appState->keyDown ? 1.0f : 0.0f));
+    struct RenderProgram program = {
+        .program = appState->shaderProgram,
+        .multiplyColorLocation = appState->multiplyColorLocation,
+    };
+    RenderQueueSetProgram(&appState->renderQueue, SPRITE_PROGRAM_SLOT, &program);
+}
 
-    glm_vec2_add(player->acceleration, player->velocity, player->velocity);
-    glm_vec2_add(player->velocity, player->position, player->position);
+// Draws the sprites the game emitted for this frame
+void Render(struct AppState *appState, const struct RenderList *renderList)
+{
+    // Uploads and reloads may have changed GL state behind the cache's back
+    GLStateInvalidate();
+    GpuStreamBeginFrame(&appState->gpuStream);
 
+    GLStateSetDepthWrite(true);
     glClearColor(0.3f, 0.3f, 0.3f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 
     // Render
     //
-    glUseProgram(appState->shaderProgram);
-
-    // float t = sinf(glfwGetTime()*1)*0.5f + 0.5f;
-    // float y = sinf(glfwGetTime()*0.7853981633974483)*0.5f + 0.5f;
-    // glUniform4f(appState->multiplyColorLocation, t, y, t*y, 1.0);
-    glUniform4f(appState->multiplyColorLocation, 1.0f, 1.0f, 1.0f, 1.0f);
-
-    struct {
-        vec3 pos;
-        float scale;
-        vec2 tile;
-    } cubes[] = {
-        {{ 1.0f,  1.0, 0.0}, 1.0f, {0.0f, 0.0f}},
-        {{-1.5f, -1.0, 0.0}, 3.0f, {4.0f, 4.0f}},
-    };
+    PROFILE_GPU_BEGIN("Render");
 
-    for (u32 i = 0; i < ARRAY_LEN(cubes); ++i)
+    // The only matrix work of the frame; sprites are expanded on the GPU
+    // from their position and scale
+    const struct Camera *camera = &appState->camera;
+    CameraUpdate(&appState->camera);
+
+    f32 minX, minY, maxX, maxY;
+    CameraVisibleRect(camera, &minX, &minY, &maxX, &maxY);
+
+    // Everything is packed onto the first atlas page, so one texture draws
+    // the whole scene; see ATLAS_PAGE_COUNT in CMakeLists.txt
+    u32 texture = AssetStreamGetTexture(&appState->assetStream, appState->atlasTextures[0]);
+
+    struct RenderQueue *queue = &appState->renderQueue;
+    RenderQueueReset(queue);
+
+    u64 tilemapKey = RenderKeyOpaque(RENDER_LAYER_WORLD, SPRITE_PROGRAM_SLOT, texture, CameraDepthOf(camera, appState->tilemap.depth));
+    TilemapSubmit(&appState->tilemap, queue, tilemapKey, SPRITE_PROGRAM_SLOT, texture, minX, minY, maxX, maxY);
+
+    // Sprite sheet cells have soft alpha edges, so sprites blend back to front
+    for (u32 i = 0; i < renderList->count; ++i)
+    {
+        const struct SpriteInstance *sprite = &renderList->sprites[i];
+        struct RenderCommand command = {
+            .kind = RenderCommand_Sprite,
+            .program = SPRITE_PROGRAM_SLOT,
+            .texture = texture,
+            .sprite = *sprite,
+        };
+        u64 key = RenderKeyTranslucent(RENDER_LAYER_WORLD, SPRITE_PROGRAM_SLOT, texture, CameraDepthOf(camera, sprite->position[2]));
+        RenderQueuePush(queue, key, &command);
+    }
+
+    for (u32 i = 0; i < renderList->runCount; ++i)
     {
-        mat4 model;
-        glm_mat4_identity(model);
-        glm_translated(model, cubes[i].pos);
-        glm_mat4_scale(model, cubes[i].scale);
-        // glm_rotate(model, glm_rad(-55.0f), (vec3){1.0f, 0.0f, 0.0f});
-        // glm_rotate(model, cubes[i].rotateFactor * glfwGetTime(), (vec3){0.0f, 0.0f, 1.0f});
+        const struct SpriteRun *run = &renderList->runs[i];
+        struct RenderCommand command = {
+            .kind = RenderCommand_SpriteRun,
+            .program = SPRITE_PROGRAM_SLOT,
+            .texture = texture,
+            .run = {renderList->runSprites + run->first, run->count},
+        };
+        u64 key = RenderKeyTranslucent(RENDER_LAYER_WORLD, SPRITE_PROGRAM_SLOT, texture, CameraDepthOf(camera, run->z));
+        RenderQueuePush(queue, key, &command);
+    }
 
-        mat4 view;
-        glm_mat4_identity(view);
-        glm_translate(view, (vec3){0.0f, 0.0f, -10.0f});
+    PROFILE_BEGIN("RenderQueueSort");
+    RenderQueueSort(queue);
+    PROFILE_END();
 
-        mat4 projection;
-        {
-            float left = 0.0f;
-            float right = 8.0f;
-            float bottom = 0.0f;
-            float top = 6.0f;
-            float nearZ = 0.1f;
-            float farZ = 100.0f;
-            glm_ortho(left, right, bottom, top, nearZ, farZ, projection);
-        }
-        // glm_perspective(glm_rad(55), 16.0f/9.0f, 0.1f, 100.0f, projection);
+    RenderQueueExecute(queue, &appState->spriteBatch);
+    PROFILE_GPU_END();
 
-        // mat4s transform;
-        // glm_mat4_identity(transform.raw);
-        // transform = glms_translate(transform, (vec3s){.raw = {0.5f, player->position.y, 1.0f}});
-        // glm_rotate_z(transform.raw, glfwGetTime(), transform.raw);
+    GpuStreamEndFrame(&appState->gpuStream);
+}
 
-        glUniformMatrix4fv(appState->matModelLocation, 1, false, model[0]);
-        glUniformMatrix4fv(appState->matViewLocation, 1, false, view[0]);
-        glUniformMatrix4fv(appState->matProjectionLocation, 1, false, projection[0]);
-        glUniform2f(appState->tileCoordLocation, cubes[i].tile[0], cubes[i].tile[1]);
+// Reserves the game memory block at its fixed address if that range is free,
+// and anywhere otherwise, in which case older recordings won't play back
+static void *AllocateGameMemory(usize size)
+{
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_FIXED_NOREPLACE
+    int fixedFlags = flags | MAP_FIXED_NOREPLACE;
+#else
+    int fixedFlags = flags;
+#endif
 
-        glBindVertexArray(appState->spriteVao);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+    void *memory = mmap((void *)(uintptr_t)GAME_MEMORY_BASE_ADDRESS, size, PROT_READ | PROT_WRITE, fixedFlags, -1, 0);
+    if (memory == MAP_FAILED)
+    {
+        memory = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, -1, 0);
     }
+    return memory == MAP_FAILED ? NULL : memory;
 }
 
-void KeyCallback(GLFWwindow *window, int key, int scancode, int action, int mods)
+// Called between ticks, so the snapshot and the recorded inputs line up
+static void ToggleRecording(struct AppState *state)
 {
-    UNUSED(mods);
-    UNUSED(scancode);
+    if (state->replay.recording)
+    {
+        u32 tickCount = state->replay.tickCount;
+        if (ReplayEndRecording(&state->replay, &state->gameMemory))
+        {
+            printf("Recorded %u ticks to %s.\n", tickCount, REPLAY_RECORD_PATH);
+        }
+        else
+        {
+            fprintf(stderr, "Could not finish writing %s.\n", REPLAY_RECORD_PATH);
+        }
+    }
+    else if (ReplayBeginRecording(&state->replay, REPLAY_RECORD_PATH, &state->gameMemory, state->tickRate))
+    {
+        printf("Recording input to %s, F6 to stop.\n", REPLAY_RECORD_PATH);
+    }
+    else
+    {
+        fprintf(stderr, "Could not write %s.\n", REPLAY_RECORD_PATH);
+    }
+}
 
-    struct AppState *state = glfwGetWindowUserPointer(window);
+static void FinishPlayback(struct AppState *state)
+{
+    f64 elapsed = glfwGetTime() - state->replayStartTime;
+    u32 tickCount = state->replay.tickCount;
+    state->replayMatched = ReplayEndPlayback(&state->replay, &state->gameMemory);
 
-    if (action == GLFW_PRESS || action == GLFW_RELEASE)
+    printf("Replayed %u ticks in %.3f s, %.3f ms per frame. Final state %s the recording.\n",
+           tickCount, elapsed, tickCount ? elapsed / tickCount * 1e3 : 0.0,
+           state->replayMatched ? "matches" : "DIVERGED from");
+
+    glfwSetWindowShouldClose(state->window, true);
+    glfwPostEmptyEvent();
+}
+
+// Runs on the render thread, which owns the GL context and the game input
+static void ApplyInputEvent(struct AppState *state, const struct InputEvent *event)
+{
+    switch (event->kind)
     {
-        bool newKeyState = action == GLFW_PRESS;
-        switch (key)
+    case InputEvent_FramebufferSize:
+        glViewport(0, 0, event->framebufferSize.width, event->framebufferSize.height);
+        CameraSetViewport(&state->camera, event->framebufferSize.width, event->framebufferSize.height);
+        break;
+    case InputEvent_Key:
+    {
+        bool newKeyState = event->key.pressed;
+        switch (event->key.key)
         {
         case GLFW_KEY_LEFT:
-            state->keyLeft = newKeyState;
+            state->input.keyLeft = newKeyState;
             break;
         case GLFW_KEY_RIGHT:
-            state->keyRight = newKeyState;
+            state->input.keyRight = newKeyState;
             break;
         case GLFW_KEY_UP:
-            state->keyUp = newKeyState;
+            state->input.keyUp = newKeyState;
             break;
         case GLFW_KEY_DOWN:
-            state->keyDown = newKeyState;
+            state->input.keyDown = newKeyState;
             break;
         case GLFW_KEY_F3:
             if (newKeyState)
@@ -219,28 +545,254 @@ void KeyCallback(GLFWwindow *window, int key, int scancode, int action, int mods
                 ++state->viewMode;
                 glPolygonMode(GL_FRONT_AND_BACK, (state->viewMode & 1) ? GL_FILL : GL_LINE);
             }
+            break;
+        case GLFW_KEY_F4:
+            if (newKeyState && PROFILE_WRITE_TRACE(PROFILER_TRACE_PATH, PROFILER_TRACE_FRAMES))
+            {
+                printf("Wrote the last %u frames to %s.\n", PROFILER_TRACE_FRAMES, PROFILER_TRACE_PATH);
+            }
+            break;
+        case GLFW_KEY_F5:
+            if (newKeyState)
+            {
+                FramePacerSetMode(&state->pacer, (state->pacer.mode + 1) % FramePace_Count);
+                printf("Frame pacing: %s.\n", FramePaceModeName(state->pacer.mode));
+            }
+            break;
+        case GLFW_KEY_F6:
+            if (newKeyState && !state->replay.playing)
+            {
+                ToggleRecording(state);
+            }
+            break;
         }
+        break;
+    }
+    }
+}
+
+// Applies everything the window thread queued since the last call. Returns
+// the time of the oldest key event among them, or a negative value if none.
+static f64 DrainInput(struct AppState *state)
+{
+    f64 oldestKeyTime = -1.0;
+
+    struct InputEvent event;
+    while (InputQueuePop(&state->inputQueue, &event))
+    {
+        if (event.kind == InputEvent_Key && oldestKeyTime < 0.0)
+        {
+            oldestKeyTime = event.time;
+        }
+        ApplyInputEvent(state, &event);
+    }
+
+    return oldestKeyTime;
+}
+
+// The GLFW callbacks run on the main thread and only queue events
+void KeyCallback(GLFWwindow *window, int key, int scancode, int action, int mods)
+{
+    UNUSED(mods);
+    UNUSED(scancode);
+
+    struct AppState *state = glfwGetWindowUserPointer(window);
+
+    if (action == GLFW_PRESS || action == GLFW_RELEASE)
+    {
+        if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
+        {
+            glfwSetWindowShouldClose(window, true);
+            return;
+        }
+
+        struct InputEvent event = {
+            .kind = InputEvent_Key,
+            .time = glfwGetTime(),
+            .key = {key, action == GLFW_PRESS},
+        };
+        InputQueuePush(&state->inputQueue, &event);
     }
 }
 
 static void OnFramebufferSizeChange(GLFWwindow* window, int width, int height)
 {
-    UNUSED(window);
-    glViewport(0, 0, width, height);
+    struct AppState *state = glfwGetWindowUserPointer(window);
+
+    struct InputEvent event = {
+        .kind = InputEvent_FramebufferSize,
+        .time = glfwGetTime(),
+        .framebufferSize = {width, height},
+    };
+    InputQueuePush(&state->inputQueue, &event);
 }
 
-static void HandleInput(GLFWwindow *window)
+static void *RenderThreadMain(void *data)
 {
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+    struct AppState *state = data;
+    PROFILE_THREAD_NAME("Render");
+
+    // The simulation runs here, so this is the thread that submits jobs
+    JobRegisterSubmitThread();
+
+    glfwMakeContextCurrent(state->window);
+    // Replays run as fast as frames can be drawn
+    u32 paceMode = state->replay.playing ? FramePace_Unthrottled : FRAME_PACE_MODE;
+    FramePacerInit(&state->pacer, paceMode, FRAME_PACE_TARGET_FPS, FRAME_PACE_MAX_FRAMES_IN_FLIGHT);
+
+    const f64 tickDuration = 1.0 / state->tickRate;
+    f64 accumulator = 0.0;
+    f64 previousTime = glfwGetTime();
+    state->replayStartTime = previousTime;
+
+    while (!atomic_load_explicit(&state->quit, memory_order_acquire))
     {
-        glfwSetWindowShouldClose(window, true);
+        PROFILE_BEGIN("FramePacerWait");
+        FramePacerWait(&state->pacer);
+        PROFILE_END();
+
+        PROFILE_FRAME();
+        PROFILE_BEGIN("Frame");
+
+        FrameArenaBegin(&state->frameArena);
+
+        PROFILE_BEGIN("ReloadGameLibrary");
+        ReloadGameLibraryIfChanged(&state->gameLibrary);
+        PROFILE_END();
+        struct GameLibrary *game = &state->gameLibrary;
+
+        f64 now = glfwGetTime();
+        accumulator += now - previousTime;
+        previousTime = now;
+
+        // As late as possible, so the simulation sees the freshest input
+        PROFILE_BEGIN("DrainInput");
+        f64 oldestKeyTime = DrainInput(state);
+        PROFILE_END();
+
+        f32 alpha;
+        if (state->replay.playing)
+        {
+            // Exactly one recorded tick per frame, independent of wall time,
+            // replacing whatever live input arrived
+            if (ReplayNextTick(&state->replay, &state->input))
+            {
+                PROFILE_BEGIN("GameUpdate");
+                game->update(&state->gameMemory, &state->input, (f32)tickDuration);
+                PROFILE_END();
+            }
+            else
+            {
+                FinishPlayback(state);
+            }
+            alpha = 1.0f;
+        }
+        else
+        {
+            u32 steps = 0;
+            while (accumulator >= tickDuration && steps < state->maxCatchUpSteps)
+            {
+                if (state->replay.recording)
+                {
+                    ReplayRecordTick(&state->replay, &state->input);
+                }
+
+                PROFILE_BEGIN("GameUpdate");
+                game->update(&state->gameMemory, &state->input, (f32)tickDuration);
+                PROFILE_END();
+                accumulator -= tickDuration;
+                ++steps;
+            }
+
+            // Too far behind to catch up; drop the backlog instead of spiraling
+            if (accumulator >= tickDuration)
+            {
+                accumulator = fmod(accumulator, tickDuration);
+            }
+            alpha = (f32)(accumulator / tickDuration);
+        }
+
+        struct RenderList renderList = {0};
+        renderList.capacity = RENDER_LIST_CAPACITY;
+        renderList.sprites = ArenaPushArray(FrameArenaCurrent(&state->frameArena), struct SpriteInstance, renderList.capacity);
+        renderList.runSpriteCapacity = RENDER_LIST_RUN_CAPACITY;
+        renderList.runSprites = ArenaPushArray(FrameArenaCurrent(&state->frameArena), struct SpriteInstance, renderList.runSpriteCapacity);
+
+        PROFILE_BEGIN("GameRender");
+        game->render(&state->gameMemory, &renderList, alpha);
+        PROFILE_END();
+
+        PROFILE_BEGIN("AssetStreamUpdate");
+        AssetStreamUpdate(&state->assetStream, ASSET_UPLOAD_BUDGET_PER_FRAME);
+        PROFILE_END();
+
+        PROFILE_BEGIN("ShaderManagerUpdate");
+        if (ShaderManagerUpdate(&state->shaders))
+        {
+            RefreshShaderProgram(state);
+        }
+        PROFILE_END();
+
+        PROFILE_BEGIN("Render");
+        Render(state, &renderList);
+        PROFILE_END();
+
+        PROFILE_BEGIN("SwapBuffers");
+        glfwSwapBuffers(state->window);
+        PROFILE_END();
+
+        PROFILE_BEGIN("FramePacerEndFrame");
+        FramePacerEndFrame(&state->pacer);
+        PROFILE_END();
+
+        // The swap returning is the closest we get to the frame being shown
+        if (oldestKeyTime >= 0.0)
+        {
+            f64 latency = glfwGetTime() - oldestKeyTime;
+            state->inputLatencySum += latency;
+            state->inputLatencyMax = latency > state->inputLatencyMax ? latency : state->inputLatencyMax;
+            state->inputLatencyFrames += 1;
+        }
+
+        PROFILE_END();
     }
+
+    if (state->replay.recording)
+    {
+        ToggleRecording(state);
+    }
+
+    FramePacerFree(&state->pacer);
+
+    // Hand the context back for cleanup
+    glfwMakeContextCurrent(NULL);
+    return NULL;
 }
 
-int main(void)
+int main(int argc, char **argv)
 {
-    struct AppState *state = MemZeroAlloc(DefaultAllocator, sizeof(*state));
-    state->alloc = DefaultAllocator;
+    const char *replayPath = NULL;
+    if (argc == 3 && strcmp(argv[1], "--replay") == 0)
+    {
+        replayPath = argv[2];
+    }
+    else if (argc != 1)
+    {
+        fprintf(stderr, "Usage: %s [--replay <path>]\n", argv[0]);
+        return -1;
+    }
+
+    MemoryTagInit(&appTag, "App", DefaultAllocator, NULL, MEMORY_BUDGET_APP);
+    MemoryTagInit(&renderTag, "Render", DefaultAllocator, NULL, MEMORY_BUDGET_RENDER);
+    MemoryTagInit(&tilemapTag, "Tilemap", DefaultAllocator, NULL, MEMORY_BUDGET_TILEMAP);
+
+    struct AppState *state = MemZeroAllocUser(TrackingAllocator, sizeof(*state), &appTag);
+    state->alloc = TrackingAllocator;
+    state->tickRate = SIM_TICK_RATE;
+    state->maxCatchUpSteps = SIM_MAX_CATCH_UP_STEPS;
+
+    state->frameScratchMemory = MemAllocUser(state->alloc, FRAME_SCRATCH_SIZE, &appTag);
+    FrameArenaInit(&state->frameArena, state->frameScratchMemory, FRAME_SCRATCH_SIZE);
 
     if (!glfwInit())
     {
@@ -282,7 +834,9 @@ int main(void)
     }
     glfwMakeContextCurrent(window);
 
-    glfwSetWindowUserPointer(window, &state);
+    state->window = window;
+    InputQueueInit(&state->inputQueue);
+    glfwSetWindowUserPointer(window, state);
     glfwSetKeyCallback(window, KeyCallback);
     glfwSetFramebufferSizeCallback(window, OnFramebufferSizeChange);
 
@@ -294,174 +848,171 @@ int main(void)
         return -1;
     }
 
+    PROFILE_INIT();
+
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    //
-    // Load shaders
-    //
+    if (!AssetPackOpen(&state->assets, ASSET_PACK_PATH))
     {
-        const char *vertexShaderSourcePath = "../resources/sprite_sheet.shader.vert";
-        const char *fragmentShaderSourcePath = "../resources/sprite_sheet.shader.frag";
-
-        s32 vertexShaderSourceSize = GetFileSize(vertexShaderSourcePath);
-        if (vertexShaderSourceSize < 0) return 1;
-
-        s32 fragmentShaderSourceSize = GetFileSize(fragmentShaderSourcePath);
-        if (fragmentShaderSourceSize < 0) return 1;
-
-        u8 vertexShaderSource[vertexShaderSourceSize + 1];
-        u8 fragmentShaderSource[vertexShaderSourceSize + 1];
+        glfwTerminate();
+        return -1;
+    }
 
-        s32 numRead = ReadBytesFromFile(vertexShaderSourcePath, vertexShaderSourceSize, vertexShaderSource);
-        if (numRead < 0) return 1;
+    RenderQueueInit(&state->renderQueue, RENDER_QUEUE_CAPACITY, state->alloc, &renderTag);
 
-        numRead = ReadBytesFromFile(fragmentShaderSourcePath, fragmentShaderSourceSize, fragmentShaderSource);
-        if (numRead < 0) return 1;
+    CameraInit(&state->camera, CAMERA_VIEW_HEIGHT);
+    state->camera.position[0] = CAMERA_START_X;
+    state->camera.position[1] = CAMERA_START_Y;
+    {
+        s32 framebufferWidth, framebufferHeight;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        CameraSetViewport(&state->camera, framebufferWidth, framebufferHeight);
+    }
 
-        vertexShaderSource[vertexShaderSourceSize] = 0;
-        fragmentShaderSource[fragmentShaderSourceSize] = 0;
+    //
+    // Load shaders
+    //
+    ShaderManagerInit(&state->shaders, glfwGetProcAddress, SHADER_CACHE_DIRECTORY, FEJNANDO_RESOURCE_DIR);
+    {
+        const struct AssetPackEntry *vertexShader = AssetPackFind(&state->assets, "sprite_sheet.shader.vert");
+        const struct AssetPackEntry *fragmentShader = AssetPackFind(&state->assets, "sprite_sheet.shader.frag");
+        if (!vertexShader || !fragmentShader)
+        {
+            fprintf(stderr, "Sprite sheet shaders are missing from %s.\n", ASSET_PACK_PATH);
+            glfwTerminate();
+            return -1;
+        }
 
-        state->shaderProgram = CompileShaders(vertexShaderSource, fragmentShaderSource);
+        state->spriteShader = ShaderManagerLoad(&state->shaders,
+                                                AssetPackData(&state->assets, vertexShader),
+                                                AssetPackData(&state->assets, fragmentShader),
+                                                "sprite_sheet.shader.vert", "sprite_sheet.shader.frag");
+        if (state->spriteShader == SHADER_INVALID_HANDLE)
+        {
+            glfwTerminate();
+            return -1;
+        }
     }
 
-    state->multiplyColorLocation = glGetUniformLocation(state->shaderProgram, "multiplyColor");
-    state->matModelLocation = glGetUniformLocation(state->shaderProgram, "model");
-    state->matViewLocation = glGetUniformLocation(state->shaderProgram, "view");
-    state->matProjectionLocation = glGetUniformLocation(state->shaderProgram, "projection");
-    state->tileCoordLocation = glGetUniformLocation(state->shaderProgram, "tile");
+    RefreshShaderProgram(state);
 
-    const char *crabFilePath = "../resources/vehicles.png";
-    FILE *imageFile = fopen(crabFilePath, "rb");
-    if (!imageFile)
+    if (!AssetStreamInit(&state->assetStream, &state->assets, ASSET_STREAM_WORKERS, ASSET_STREAM_USE_PIXEL_BUFFERS))
     {
-        fprintf(stderr, "Could not open file %s.\n", crabFilePath);
+        fprintf(stderr, "Could not start asset streaming threads.\n");
         glfwTerminate();
         return -1;
     }
 
-    // load crab texture
-    u32 crabTexture;
-    glGenTextures(1, &crabTexture);
-    glBindTexture(GL_TEXTURE_2D, crabTexture);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    s32 crabWidth;
-    s32 crabHeight;
-    s32 channels;
-    s32 desiredChannels = 4;
-    stbi_set_flip_vertically_on_load(true);
-    u8* crabData = stbi_load_from_file(imageFile, &crabWidth, &crabHeight, &channels, desiredChannels);
-    if (crabData)
-    {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, crabWidth, crabHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, crabData);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        stbi_image_free(crabData);
+    // Streams in the background; sprites use a placeholder until it's uploaded
+    for (u32 page = 0; page < SPRITE_ATLAS_PAGE_COUNT; ++page)
+    {
+        state->atlasTextures[page] = AssetStreamRequestTexture(&state->assetStream, spriteAtlasPages[page]);
     }
-    else
+
+    if (!GpuStreamInit(&state->gpuStream, GPU_STREAM_REGION_SIZE, glfwGetProcAddress))
     {
-        fprintf(stderr, "Could not load image %s.\n", crabFilePath);
+        fprintf(stderr, "Could not create the GPU stream buffer.\n");
         glfwTerminate();
         return -1;
     }
-    fclose(imageFile);
-
-    struct SpriteVertex
-    {
-        vec3 pos;
-        // vec3 color;
-        vec2 uv;
-    };
 
-    struct SpriteVertex vertices[] = {
-        {.pos = {-1.0f,-1.0f,-1.0f}, .uv = {0.0f, 0.0f}},
-        {.pos = { 1.0f,-1.0f,-1.0f}, .uv = {1.0f, 0.0f}},
-        {.pos = { 1.0f, 1.0f,-1.0f}, .uv = {1.0f, 1.0f}},
-        {.pos = { 1.0f, 1.0f,-1.0f}, .uv = {1.0f, 1.0f}},
-        {.pos = {-1.0f, 1.0f,-1.0f}, .uv = {0.0f, 1.0f}},
-        {.pos = {-1.0f,-1.0f,-1.0f}, .uv = {0.0f, 0.0f}},
-
-        // {.pos = {-1.0f,-1.0f, 1.0f}, .uv = {0.0f,0.0f}},
-        // {.pos = { 1.0f,-1.0f, 1.0f}, .uv = {1.0f,0.0f}},
-        // {.pos = { 1.0f, 1.0f, 1.0f}, .uv = {1.0f,1.0f}},
-        // {.pos = { 1.0f, 1.0f, 1.0f}, .uv = {1.0f,1.0f}},
-        // {.pos = {-1.0f, 1.0f, 1.0f}, .uv = {0.0f,1.0f}},
-        // {.pos = {-1.0f,-1.0f, 1.0f}, .uv = {0.0f,0.0f}},
-
-        // {.pos = {-1.0f, 1.0f, 1.0f}, .uv = {0.0f,0.0f}},
-        // {.pos = {-1.0f, 1.0f,-1.0f}, .uv = {1.0f,0.0f}},
-        // {.pos = {-1.0f,-1.0f,-1.0f}, .uv = {1.0f,1.0f}},
-        // {.pos = {-1.0f,-1.0f,-1.0f}, .uv = {1.0f,1.0f}},
-        // {.pos = {-1.0f,-1.0f, 1.0f}, .uv = {0.0f,1.0f}},
-        // {.pos = {-1.0f, 1.0f, 1.0f}, .uv = {0.0f,0.0f}},
-
-        // {.pos = { 1.0f, 1.0f, 1.0f}, .uv = {0.0f,0.0f}},
-        // {.pos = { 1.0f, 1.0f,-1.0f}, .uv = {1.0f,0.0f}},
-        // {.pos = { 1.0f,-1.0f,-1.0f}, .uv = {1.0f,1.0f}},
-        // {.pos = { 1.0f,-1.0f,-1.0f}, .uv = {1.0f,1.0f}},
-        // {.pos = { 1.0f,-1.0f, 1.0f}, .uv = {0.0f,1.0f}},
-        // {.pos = { 1.0f, 1.0f, 1.0f}, .uv = {0.0f,0.0f}},
-
-        // {.pos = {-1.0f,-1.0f,-1.0f}, .uv = {0.0f,0.0f}},
-        // {.pos = { 1.0f,-1.0f,-1.0f}, .uv = {1.0f,0.0f}},
-        // {.pos = { 1.0f,-1.0f, 1.0f}, .uv = {1.0f,1.0f}},
-        // {.pos = { 1.0f,-1.0f, 1.0f}, .uv = {1.0f,1.0f}},
-        // {.pos = {-1.0f,-1.0f, 1.0f}, .uv = {0.0f,1.0f}},
-        // {.pos = {-1.0f,-1.0f,-1.0f}, .uv = {0.0f,0.0f}},
-
-        // {.pos = {-1.0f, 1.0f,-1.0f}, .uv = {0.0f,0.0f}},
-        // {.pos = { 1.0f, 1.0f,-1.0f}, .uv = {1.0f,0.0f}},
-        // {.pos = { 1.0f, 1.0f, 1.0f}, .uv = {1.0f,1.0f}},
-        // {.pos = { 1.0f, 1.0f, 1.0f}, .uv = {1.0f,1.0f}},
-        // {.pos = {-1.0f, 1.0f, 1.0f}, .uv = {0.0f,1.0f}},
-        // {.pos = {-1.0f, 1.0f,-1.0f}, .uv = {0.0f,0.0f}},
-    };
+    SpriteBatchInit(&state->spriteBatch, 1 << 16, state->alloc, &renderTag);
+    state->spriteBatch.stream = &state->gpuStream;
 
-    glGenVertexArrays(1, &state->spriteVao);
+    TilemapInit(&state->tilemap, LEVEL_WIDTH, LEVEL_HEIGHT, LEVEL_TILE_SIZE, state->alloc, &tilemapTag);
+    state->tilemap.palette = &spriteRects[Sprite_vehicles_0];
+    GenerateLevel(&state->tilemap);
 
-    // Vertex Buffer Object (VBO)
-    GLuint spriteVbo;
-    glGenBuffers(1, &spriteVbo);
+    if (!JobSystemInit(&state->jobs, 0))
+    {
+        fprintf(stderr, "Could not start job system.\n");
+        glfwTerminate();
+        return -1;
+    }
 
-    // Bind the VAO
-    glBindVertexArray(state->spriteVao);
+    state->platform.jobs = &state->jobs;
+    state->platform.ParallelFor = JobParallelFor;
 
-    // Bind the VBO and copy the vertex data to it
-    glBindBuffer(GL_ARRAY_BUFFER, spriteVbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_DYNAMIC_DRAW);
+    state->gameMemory.platform = &state->platform;
+    state->gameMemory.size = GAME_MEMORY_SIZE;
+    state->gameMemory.base = AllocateGameMemory(state->gameMemory.size);
+    if (!state->gameMemory.base)
+    {
+        fprintf(stderr, "Could not allocate game memory.\n");
+        glfwTerminate();
+        return -1;
+    }
 
-    GLint positionAttribLocation = glGetAttribLocation(state->shaderProgram, "aPos");
-    glVertexAttribPointer(positionAttribLocation, 3, GL_FLOAT, GL_FALSE, sizeof(*vertices), (void *)OFFSET_OF(struct SpriteVertex, pos));
-    glEnableVertexAttribArray(positionAttribLocation);
+    if (!LoadGameLibrary(&state->gameLibrary))
+    {
+        fprintf(stderr, "Could not load %s.\n", GAME_LIBRARY_PATH);
+        glfwTerminate();
+        return -1;
+    }
 
-    // GLint colorAttribLocation = glGetAttribLocation(state->shaderProgram, "aColor");
-    // glVertexAttribPointer(colorAttribLocation, 3, GL_FLOAT, GL_FALSE, sizeof(*vertices), (void *)OFFSET_OF(struct SpriteVertex, color));
-    // glEnableVertexAttribArray(colorAttribLocation);
+    if (replayPath)
+    {
+        if (!ReplayBeginPlayback(&state->replay, replayPath, &state->gameMemory))
+        {
+            fprintf(stderr, "Could not replay %s. Recordings only play back with game memory at the address they were made at.\n", replayPath);
+            glfwTerminate();
+            return -1;
+        }
+        state->tickRate = state->replay.header.tickRate;
+    }
 
-    GLint uvAttribLocation = glGetAttribLocation(state->shaderProgram, "aUV");
-    glVertexAttribPointer(uvAttribLocation, 2, GL_FLOAT, GL_FALSE, sizeof(*vertices), (void *)OFFSET_OF(struct SpriteVertex, uv));
-    glEnableVertexAttribArray(uvAttribLocation);
+    // A context can only be current on one thread at a time
+    glfwMakeContextCurrent(NULL);
+    if (pthread_create(&state->renderThread, NULL, RenderThreadMain, state) != 0)
+    {
+        fprintf(stderr, "Could not start the render thread.\n");
+        glfwTerminate();
+        return -1;
+    }
 
+    // Event handling never waits on rendering or a blocking swap
     while (!glfwWindowShouldClose(window))
     {
-        glfwPollEvents();
-
-        HandleInput(window);
+        glfwWaitEvents();
+    }
 
-        Render(state);
+    atomic_store_explicit(&state->quit, true, memory_order_release);
+    pthread_join(state->renderThread, NULL);
+    glfwMakeContextCurrent(window);
 
-        glfwSwapBuffers(window);
+    if (state->inputLatencyFrames > 0)
+    {
+        printf("Input latency: %.2f ms average, %.2f ms worst over %u frames.\n",
+               state->inputLatencySum / state->inputLatencyFrames * 1e3, state->inputLatencyMax * 1e3,
+               state->inputLatencyFrames);
     }
 
-    glDeleteVertexArrays(1, &state->spriteVao);
-    glDeleteBuffers(1, &spriteVbo);
-    glDeleteProgram(state->shaderProgram);
+    SpriteBatchFree(&state->spriteBatch, state->alloc, &renderTag);
+    RenderQueueFree(&state->renderQueue, state->alloc, &renderTag);
+    CameraFree(&state->camera);
+    TilemapFree(&state->tilemap, state->alloc, &tilemapTag);
+    GpuStreamFree(&state->gpuStream);
+    UnloadGameLibrary(&state->gameLibrary);
+    JobSystemShutdown(&state->jobs);
+    AssetStreamShutdown(&state->assetStream);
+    ShaderManagerShutdown(&state->shaders);
+    AssetPackClose(&state->assets);
+    PROFILE_SHUTDOWN();
 
     glfwTerminate();
 
-    return 0;
+    // Replays double as determinism checks, so report divergence in the exit code
+    int exitCode = (replayPath && !state->replayMatched) ? 1 : 0;
+
+    munmap(state->gameMemory.base, state->gameMemory.size);
+    MemFreeUser(state->alloc, state->frameScratchMemory, &appTag);
+    MemFreeUser(TrackingAllocator, state, &appTag);
+
+    MemoryReport(stdout);
+    MemoryReportLeaks(stderr);
+
+    return exitCode;
 }
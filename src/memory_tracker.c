@@ -0,0 +1,303 @@
+#include "memory_tracker.h"
+#include <assert.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#include <immintrin.h>
+#define CPU_PAUSE() _mm_pause()
+#else
+#define CPU_PAUSE() ((void)0)
+#endif
+
+// Sits in front of every tracked block
+struct MemoryBlockHeader
+{
+    usize size; // as requested, without the header
+    struct MemoryTag *tag;
+#ifdef FEJNANDO_MEMORY_CALL_SITES
+    const char *file;
+    u32 line;
+    struct MemoryBlockHeader *prev;
+    struct MemoryBlockHeader *next;
+#endif
+};
+
+// Rounded up so the block keeps the backing allocator's 16 byte alignment
+#define MEMORY_HEADER_SIZE ((sizeof(struct MemoryBlockHeader) + 15) & ~(usize)15)
+
+static struct MemoryTag *registeredTags[MEMORY_MAX_TAGS];
+static _Atomic u32 registeredTagCount;
+
+#ifdef FEJNANDO_MEMORY_CALL_SITES
+
+static _Thread_local const char *callSiteFile;
+static _Thread_local u32 callSiteLine;
+
+void MemorySetCallSite(const char *file, u32 line)
+{
+    callSiteFile = file;
+    callSiteLine = line;
+}
+
+static void LockTag(struct MemoryTag *tag)
+{
+    while (atomic_flag_test_and_set_explicit(&tag->lock, memory_order_acquire))
+    {
+        CPU_PAUSE();
+    }
+}
+
+static void UnlockTag(struct MemoryTag *tag)
+{
+    atomic_flag_clear_explicit(&tag->lock, memory_order_release);
+}
+
+static void LinkBlock(struct MemoryTag *tag, struct MemoryBlockHeader *header)
+{
+    header->file = callSiteFile;
+    header->line = callSiteLine;
+    callSiteFile = NULL;
+    callSiteLine = 0;
+
+    LockTag(tag);
+    header->prev = NULL;
+    header->next = tag->blocks;
+    if (tag->blocks)
+    {
+        tag->blocks->prev = header;
+    }
+    tag->blocks = header;
+    UnlockTag(tag);
+}
+
+static void UnlinkBlock(struct MemoryTag *tag, struct MemoryBlockHeader *header)
+{
+    LockTag(tag);
+    if (header->prev)
+    {
+        header->prev->next = header->next;
+    }
+    else
+    {
+        tag->blocks = header->next;
+    }
+    if (header->next)
+    {
+        header->next->prev = header->prev;
+    }
+    UnlockTag(tag);
+}
+
+#else
+
+#define LinkBlock(tag, header) ((void)0)
+#define UnlinkBlock(tag, header) ((void)0)
+
+#endif // FEJNANDO_MEMORY_CALL_SITES
+
+void MemoryTagInit(struct MemoryTag *tag, const char *name, Allocator *backing, void *backingUser, usize budget)
+{
+    memset(tag, 0, sizeof(*tag));
+    tag->name = name;
+    tag->backing = backing;
+    tag->backingUser = backingUser;
+    tag->budget = budget;
+#ifdef FEJNANDO_MEMORY_CALL_SITES
+    atomic_flag_clear(&tag->lock);
+#endif
+
+    u32 index = atomic_fetch_add_explicit(&registeredTagCount, 1, memory_order_relaxed);
+    if (index < MEMORY_MAX_TAGS)
+    {
+        registeredTags[index] = tag;
+    }
+}
+
+static u32 SizeClassOf(usize size)
+{
+    u32 sizeClass = 0;
+    while (sizeClass < MEMORY_SIZE_CLASSES - 1 && size > ((usize)16 << sizeClass))
+    {
+        ++sizeClass;
+    }
+    return sizeClass;
+}
+
+static void AddLiveBytes(struct MemoryTag *tag, usize size)
+{
+    usize live = atomic_fetch_add_explicit(&tag->bytesLive, size, memory_order_relaxed) + size;
+    usize peak = atomic_load_explicit(&tag->bytesPeak, memory_order_relaxed);
+    while (live > peak &&
+           !atomic_compare_exchange_weak_explicit(&tag->bytesPeak, &peak, live, memory_order_relaxed, memory_order_relaxed))
+    {
+    }
+}
+
+static void CountAllocation(struct MemoryTag *tag, usize size)
+{
+    atomic_fetch_add_explicit(&tag->sizeClasses[SizeClassOf(size)], 1, memory_order_relaxed);
+}
+
+static void *TrackedAlloc(struct MemoryTag *tag, enum AllocOp op, usize size)
+{
+    struct MemoryBlockHeader *header = tag->backing(op, MEMORY_HEADER_SIZE + size, 0, NULL, tag->backingUser);
+    if (!header)
+    {
+        return NULL;
+    }
+
+    header->size = size;
+    header->tag = tag;
+    LinkBlock(tag, header);
+
+    atomic_fetch_add_explicit(&tag->allocCount, 1, memory_order_relaxed);
+    CountAllocation(tag, size);
+    AddLiveBytes(tag, size);
+
+    return (u8 *)header + MEMORY_HEADER_SIZE;
+}
+
+void *TrackingAllocator(enum AllocOp op, usize newSize, usize oldSize, void *oldPtr, void *user)
+{
+    UNUSED(oldSize);
+
+    struct MemoryTag *tag = user;
+    assert(tag && tag->backing);
+
+    switch (op)
+    {
+    case AllocOp_Alloc:
+    case AllocOp_ZeroAlloc:
+        return TrackedAlloc(tag, op, newSize);
+    case AllocOp_Free:
+    {
+        if (!oldPtr)
+        {
+            return NULL;
+        }
+
+        struct MemoryBlockHeader *header = (struct MemoryBlockHeader *)((u8 *)oldPtr - MEMORY_HEADER_SIZE);
+        assert(header->tag == tag);
+        usize size = header->size;
+        UnlinkBlock(tag, header);
+
+        atomic_fetch_add_explicit(&tag->freeCount, 1, memory_order_relaxed);
+        atomic_fetch_sub_explicit(&tag->bytesLive, size, memory_order_relaxed);
+
+        tag->backing(AllocOp_Free, 0, MEMORY_HEADER_SIZE + size, header, tag->backingUser);
+        return NULL;
+    }
+    case AllocOp_Realloc:
+    {
+        if (!oldPtr)
+        {
+            return TrackedAlloc(tag, AllocOp_Alloc, newSize);
+        }
+
+        struct MemoryBlockHeader *header = (struct MemoryBlockHeader *)((u8 *)oldPtr - MEMORY_HEADER_SIZE);
+        assert(header->tag == tag);
+        usize size = header->size;
+
+        // The block may move, so it can't stay on the list meanwhile
+        UnlinkBlock(tag, header);
+        struct MemoryBlockHeader *newHeader = tag->backing(AllocOp_Realloc, MEMORY_HEADER_SIZE + newSize,
+                                                           MEMORY_HEADER_SIZE + size, header, tag->backingUser);
+        if (!newHeader)
+        {
+            LinkBlock(tag, header);
+            return NULL;
+        }
+
+        newHeader->size = newSize;
+        LinkBlock(tag, newHeader);
+
+        atomic_fetch_add_explicit(&tag->reallocCount, 1, memory_order_relaxed);
+        CountAllocation(tag, newSize);
+        if (newSize > size)
+        {
+            AddLiveBytes(tag, newSize - size);
+        }
+        else
+        {
+            atomic_fetch_sub_explicit(&tag->bytesLive, size - newSize, memory_order_relaxed);
+        }
+
+        return (u8 *)newHeader + MEMORY_HEADER_SIZE;
+    }
+    }
+
+    return NULL;
+}
+
+static u32 TagCount(void)
+{
+    u32 count = atomic_load_explicit(&registeredTagCount, memory_order_relaxed);
+    return count < MEMORY_MAX_TAGS ? count : MEMORY_MAX_TAGS;
+}
+
+void MemoryReport(FILE *file)
+{
+    fprintf(file, "%-12s %12s %12s %12s %10s %10s %10s\n",
+            "Tag", "Live KB", "Peak KB", "Budget KB", "Allocs", "Frees", "Reallocs");
+
+    for (u32 i = 0; i < TagCount(); ++i)
+    {
+        struct MemoryTag *tag = registeredTags[i];
+        usize live = atomic_load_explicit(&tag->bytesLive, memory_order_relaxed);
+        usize peak = atomic_load_explicit(&tag->bytesPeak, memory_order_relaxed);
+        bool overBudget = tag->budget && peak > tag->budget;
+
+        fprintf(file, "%-12s %12.1f %12.1f %12.1f %10llu %10llu %10llu%s\n",
+                tag->name, live / 1024.0, peak / 1024.0, tag->budget / 1024.0,
+                (unsigned long long)atomic_load_explicit(&tag->allocCount, memory_order_relaxed),
+                (unsigned long long)atomic_load_explicit(&tag->freeCount, memory_order_relaxed),
+                (unsigned long long)atomic_load_explicit(&tag->reallocCount, memory_order_relaxed),
+                overBudget ? "  OVER BUDGET" : "");
+
+        // Only the classes that were hit, as "<=size:count"
+        fprintf(file, "%-12s", "");
+        for (u32 c = 0; c < MEMORY_SIZE_CLASSES; ++c)
+        {
+            u64 count = atomic_load_explicit(&tag->sizeClasses[c], memory_order_relaxed);
+            if (count)
+            {
+                const char *bound = c == MEMORY_SIZE_CLASSES - 1 ? ">" : "<=";
+                usize size = c == MEMORY_SIZE_CLASSES - 1 ? ((usize)16 << (c - 1)) : ((usize)16 << c);
+                fprintf(file, " %s%zu:%llu", bound, size, (unsigned long long)count);
+            }
+        }
+        fprintf(file, "\n");
+    }
+}
+
+u64 MemoryReportLeaks(FILE *file)
+{
+    u64 leaked = 0;
+
+    for (u32 i = 0; i < TagCount(); ++i)
+    {
+        struct MemoryTag *tag = registeredTags[i];
+        u64 allocs = atomic_load_explicit(&tag->allocCount, memory_order_relaxed);
+        u64 frees = atomic_load_explicit(&tag->freeCount, memory_order_relaxed);
+        if (allocs == frees)
+        {
+            continue;
+        }
+
+        fprintf(file, "%s leaked %llu blocks, %zu bytes.\n", tag->name, (unsigned long long)(allocs - frees),
+                (usize)atomic_load_explicit(&tag->bytesLive, memory_order_relaxed));
+        leaked += allocs - frees;
+
+#ifdef FEJNANDO_MEMORY_CALL_SITES
+        LockTag(tag);
+        for (struct MemoryBlockHeader *header = tag->blocks; header; header = header->next)
+        {
+            fprintf(file, "    %zu bytes from %s:%u\n", header->size,
+                    header->file ? header->file : "unknown", header->line);
+        }
+        UnlockTag(tag);
+#endif
+    }
+
+    return leaked;
+}
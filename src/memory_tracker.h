@@ -0,0 +1,62 @@
+#ifndef MEMORY_TRACKER_H
+#define MEMORY_TRACKER_H
+
+// Tracking allocator. Wraps another Allocator and attributes every block to
+// the MemoryTag passed as `user`, so each subsystem's live bytes, peak,
+// allocation counts and size mix can be checked against a budget:
+//
+//   static struct MemoryTag renderTag;
+//   MemoryTagInit(&renderTag, "Render", DefaultAllocator, NULL, 32u << 20);
+//   void *p = MemAllocUser(TrackingAllocator, size, &renderTag);
+//
+// Blocks get a small header holding their size and tag, so frees don't rely
+// on the caller's oldSize. Counters are atomics and need no lock, so tags
+// can be shared between threads.
+//
+// With FEJNANDO_MEMORY_CALL_SITES the Mem* macros also record __FILE__ and
+// __LINE__, and each tag keeps a list of its live blocks so the leak report
+// can say where they came from. The list is behind a spinlock per tag.
+
+#include <stdatomic.h>
+
+#include "common.h"
+#include "allocator.h"
+
+#define MEMORY_MAX_TAGS 64
+// Power of two size classes from 16 B; the last one takes everything bigger
+#define MEMORY_SIZE_CLASSES 16
+
+struct MemoryBlockHeader;
+
+struct MemoryTag
+{
+    const char *name;
+    Allocator *backing;
+    void *backingUser;
+    usize budget; // bytes, 0 for none
+
+    _Atomic usize bytesLive;
+    _Atomic usize bytesPeak;
+    _Atomic u64 allocCount;
+    _Atomic u64 freeCount;
+    _Atomic u64 reallocCount;
+    _Atomic u64 sizeClasses[MEMORY_SIZE_CLASSES];
+
+#ifdef FEJNANDO_MEMORY_CALL_SITES
+    atomic_flag lock;
+    struct MemoryBlockHeader *blocks;
+#endif
+};
+
+// Registers `tag` for the reports; it must outlive them. `backing` gets
+// `backingUser`, e.g. an Arena for ArenaAllocator.
+void MemoryTagInit(struct MemoryTag *tag, const char *name, Allocator *backing, void *backingUser, usize budget);
+
+Allocator TrackingAllocator;
+
+// Per tag live and peak bytes against the budget, counts and size classes
+void MemoryReport(FILE *file);
+// Lists the tags that still have live blocks. Returns the leaked block count.
+u64 MemoryReportLeaks(FILE *file);
+
+#endif // MEMORY_TRACKER_H
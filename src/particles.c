@@ -0,0 +1,246 @@
+#include "particles.h"
+#include <math.h>
+#include <string.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#endif
+
+#define PARTICLE_FLOAT_ARRAYS 11
+
+void ParticlePoolInit(struct ParticlePool *pool, u32 capacity, Allocator *alloc, void *user)
+{
+    capacity = (capacity + PARTICLE_LANES - 1) & ~(u32)(PARTICLE_LANES - 1);
+
+    usize arraySize = capacity * sizeof(f32);
+    usize totalSize = PARTICLE_ALIGNMENT + (PARTICLE_FLOAT_ARRAYS + 1) * arraySize;
+
+    memset(pool, 0, sizeof(*pool));
+    pool->memory = MemZeroAllocUser(alloc, totalSize, user);
+    if (!pool->memory)
+    {
+        return;
+    }
+
+    usize address = ((usize)pool->memory + PARTICLE_ALIGNMENT - 1) & ~(usize)(PARTICLE_ALIGNMENT - 1);
+    u8 *at = (u8 *)address;
+
+    // arraySize is a multiple of PARTICLE_ALIGNMENT, so every array stays aligned
+    f32 **arrays[PARTICLE_FLOAT_ARRAYS] = {
+        &pool->positionX, &pool->positionY,
+        &pool->velocityX, &pool->velocityY,
+        &pool->life, &pool->invLifetime, &pool->size,
+        &pool->colorR, &pool->colorG, &pool->colorB, &pool->colorA,
+    };
+    for (u32 i = 0; i < PARTICLE_FLOAT_ARRAYS; ++i)
+    {
+        *arrays[i] = (f32 *)at;
+        at += arraySize;
+    }
+    pool->sprite = (u32 *)at;
+
+    pool->capacity = capacity;
+}
+
+void ParticlePoolFree(struct ParticlePool *pool, Allocator *alloc, void *user)
+{
+    MemFreeUser(alloc, pool->memory, user);
+    memset(pool, 0, sizeof(*pool));
+}
+
+void ParticleEmitterInit(struct ParticleEmitter *emitter, u32 capacity, u32 seed, Allocator *alloc, void *user)
+{
+    memset(emitter, 0, sizeof(*emitter));
+    ParticlePoolInit(&emitter->pool, capacity, alloc, user);
+    emitter->color[0] = 1.0f;
+    emitter->color[1] = 1.0f;
+    emitter->color[2] = 1.0f;
+    emitter->color[3] = 1.0f;
+    emitter->spriteVariants = 1;
+    emitter->seed = seed ? seed : 1; // xorshift sticks at zero
+}
+
+void ParticleEmitterFree(struct ParticleEmitter *emitter, Allocator *alloc, void *user)
+{
+    ParticlePoolFree(&emitter->pool, alloc, user);
+}
+
+// xorshift32, uniform in [min, max)
+static f32 RandomRange(u32 *seed, f32 min, f32 max)
+{
+    u32 x = *seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *seed = x;
+    return min + (max - min) * (f32)(x >> 8) * (1.0f / 16777216.0f);
+}
+
+static void Spawn(struct ParticleEmitter *emitter, u32 spawnCount)
+{
+    struct ParticlePool *pool = &emitter->pool;
+    u32 *seed = &emitter->seed;
+
+    for (u32 n = 0; n < spawnCount && pool->count < pool->capacity; ++n)
+    {
+        u32 i = pool->count++;
+
+        f32 angle = emitter->direction + RandomRange(seed, -emitter->spread, emitter->spread);
+        f32 speed = RandomRange(seed, emitter->speedMin, emitter->speedMax);
+        f32 lifetime = RandomRange(seed, emitter->lifetimeMin, emitter->lifetimeMax);
+        f32 jitter = emitter->colorJitter;
+        u32 variant = (u32)RandomRange(seed, 0.0f, (f32)emitter->spriteVariants);
+
+        pool->positionX[i] = emitter->position[0] + RandomRange(seed, -emitter->positionJitter, emitter->positionJitter);
+        pool->positionY[i] = emitter->position[1] + RandomRange(seed, -emitter->positionJitter, emitter->positionJitter);
+        pool->velocityX[i] = speed * cosf(angle);
+        pool->velocityY[i] = speed * sinf(angle);
+        pool->life[i] = lifetime;
+        pool->invLifetime[i] = lifetime > 0.0f ? 1.0f / lifetime : 0.0f;
+        pool->size[i] = RandomRange(seed, emitter->sizeMin, emitter->sizeMax);
+        pool->colorR[i] = emitter->color[0] + RandomRange(seed, -jitter, jitter);
+        pool->colorG[i] = emitter->color[1] + RandomRange(seed, -jitter, jitter);
+        pool->colorB[i] = emitter->color[2] + RandomRange(seed, -jitter, jitter);
+        pool->colorA[i] = emitter->color[3];
+        pool->sprite[i] = emitter->sprite + (variant < emitter->spriteVariants ? variant : 0);
+    }
+}
+
+// v = (v + a*dt) * damping; p += v*dt; life -= dt. Runs over whole lanes;
+// the padding past `count` holds stale particles, which is harmless.
+static void Integrate(struct ParticlePool *pool, f32 ax, f32 ay, f32 damping, f32 dt)
+{
+    u32 count = pool->count;
+    f32 *px = pool->positionX;
+    f32 *py = pool->positionY;
+    f32 *vx = pool->velocityX;
+    f32 *vy = pool->velocityY;
+    f32 *life = pool->life;
+
+#if defined(__AVX__)
+    __m256 dt8 = _mm256_set1_ps(dt);
+    __m256 damping8 = _mm256_set1_ps(damping);
+    __m256 ax8 = _mm256_set1_ps(ax*dt);
+    __m256 ay8 = _mm256_set1_ps(ay*dt);
+    for (u32 i = 0; i < count; i += 8)
+    {
+        __m256 x = _mm256_mul_ps(_mm256_add_ps(_mm256_load_ps(vx + i), ax8), damping8);
+        __m256 y = _mm256_mul_ps(_mm256_add_ps(_mm256_load_ps(vy + i), ay8), damping8);
+        _mm256_store_ps(vx + i, x);
+        _mm256_store_ps(vy + i, y);
+        _mm256_store_ps(px + i, _mm256_add_ps(_mm256_load_ps(px + i), _mm256_mul_ps(x, dt8)));
+        _mm256_store_ps(py + i, _mm256_add_ps(_mm256_load_ps(py + i), _mm256_mul_ps(y, dt8)));
+        _mm256_store_ps(life + i, _mm256_sub_ps(_mm256_load_ps(life + i), dt8));
+    }
+#elif defined(__SSE__) || defined(_M_X64)
+    __m128 dt4 = _mm_set1_ps(dt);
+    __m128 damping4 = _mm_set1_ps(damping);
+    __m128 ax4 = _mm_set1_ps(ax*dt);
+    __m128 ay4 = _mm_set1_ps(ay*dt);
+    for (u32 i = 0; i < count; i += 4)
+    {
+        __m128 x = _mm_mul_ps(_mm_add_ps(_mm_load_ps(vx + i), ax4), damping4);
+        __m128 y = _mm_mul_ps(_mm_add_ps(_mm_load_ps(vy + i), ay4), damping4);
+        _mm_store_ps(vx + i, x);
+        _mm_store_ps(vy + i, y);
+        _mm_store_ps(px + i, _mm_add_ps(_mm_load_ps(px + i), _mm_mul_ps(x, dt4)));
+        _mm_store_ps(py + i, _mm_add_ps(_mm_load_ps(py + i), _mm_mul_ps(y, dt4)));
+        _mm_store_ps(life + i, _mm_sub_ps(_mm_load_ps(life + i), dt4));
+    }
+#else
+    for (u32 i = 0; i < count; ++i)
+    {
+        vx[i] = (vx[i] + ax*dt) * damping;
+        vy[i] = (vy[i] + ay*dt) * damping;
+        px[i] += vx[i] * dt;
+        py[i] += vy[i] * dt;
+        life[i] -= dt;
+    }
+#endif
+}
+
+static void MoveParticle(struct ParticlePool *pool, u32 to, u32 from)
+{
+    pool->positionX[to] = pool->positionX[from];
+    pool->positionY[to] = pool->positionY[from];
+    pool->velocityX[to] = pool->velocityX[from];
+    pool->velocityY[to] = pool->velocityY[from];
+    pool->life[to] = pool->life[from];
+    pool->invLifetime[to] = pool->invLifetime[from];
+    pool->size[to] = pool->size[from];
+    pool->colorR[to] = pool->colorR[from];
+    pool->colorG[to] = pool->colorG[from];
+    pool->colorB[to] = pool->colorB[from];
+    pool->colorA[to] = pool->colorA[from];
+    pool->sprite[to] = pool->sprite[from];
+}
+
+// Swap-removes dead particles. Most of the pool is alive on any tick, so
+// whole groups of live lanes are skipped with one compare.
+static void RemoveDead(struct ParticlePool *pool)
+{
+    f32 *life = pool->life;
+    u32 i = 0;
+    while (i < pool->count)
+    {
+#if defined(__AVX__)
+        if (i + 8 <= pool->count &&
+            _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(life + i), _mm256_setzero_ps(), _CMP_LE_OQ)) == 0)
+        {
+            i += 8;
+            continue;
+        }
+#elif defined(__SSE__) || defined(_M_X64)
+        if (i + 4 <= pool->count &&
+            _mm_movemask_ps(_mm_cmple_ps(_mm_loadu_ps(life + i), _mm_setzero_ps())) == 0)
+        {
+            i += 4;
+            continue;
+        }
+#endif
+        if (life[i] <= 0.0f)
+        {
+            // The moved particle may be dead too, so look at slot i again
+            MoveParticle(pool, i, --pool->count);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+}
+
+void ParticleEmitterUpdate(struct ParticleEmitter *emitter, f32 dt)
+{
+    emitter->spawnAccumulator += emitter->rate * dt;
+    u32 spawnCount = (u32)emitter->spawnAccumulator;
+    emitter->spawnAccumulator -= (f32)spawnCount;
+
+    struct ParticlePool *pool = &emitter->pool;
+    f32 damping = 1.0f - emitter->drag * dt;
+    Integrate(pool, emitter->acceleration[0], emitter->acceleration[1], damping > 0.0f ? damping : 0.0f, dt);
+    RemoveDead(pool);
+
+    // New particles start where they spawn; they move from next tick on
+    Spawn(emitter, spawnCount);
+}
+
+u32 ParticleBuildSprites(const struct ParticlePool *pool, const struct AtlasRect *rects,
+                         struct SpriteInstance *sprites, u32 capacity, f32 z)
+{
+    u32 count = pool->count < capacity ? pool->count : capacity;
+    for (u32 i = 0; i < count; ++i)
+    {
+        f32 fade = pool->life[i] * pool->invLifetime[i];
+        const f32 *uv = rects[pool->sprite[i]].uv;
+        sprites[i] = (struct SpriteInstance){
+            .position = {pool->positionX[i], pool->positionY[i], z},
+            .scale = pool->size[i],
+            .uv = {uv[0], uv[1], uv[2], uv[3]},
+            .tint = {pool->colorR[i], pool->colorG[i], pool->colorB[i], pool->colorA[i] * fade},
+        };
+    }
+    return count;
+}
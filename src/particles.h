@@ -0,0 +1,90 @@
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+// Particle emitters for effects like exhaust, dust and sparks. Each emitter
+// owns a structure-of-arrays pool; the update kernel steps whole SIMD lanes
+// and dead particles are removed by moving the last live one into their
+// slot, so the pool stays dense and needs no free list.
+//
+// Everything, the random state included, lives in the pool and emitter, so
+// a simulation stored in game memory replays deterministically.
+
+#include "common.h"
+#include "allocator.h"
+#include "atlas.h"
+#include "sprite_batch.h"
+
+// Pool arrays are padded to a multiple of this many particles and aligned
+// so the update kernel can always work on whole AVX registers.
+#define PARTICLE_LANES 8
+#define PARTICLE_ALIGNMENT 32
+
+struct ParticlePool
+{
+    u32 count;
+    u32 capacity;
+
+    f32 *positionX;
+    f32 *positionY;
+    f32 *velocityX;
+    f32 *velocityY;
+    f32 *life;        // seconds left; dead at or below zero
+    f32 *invLifetime; // 1 / initial life, for fading out
+    f32 *size;
+    f32 *colorR;
+    f32 *colorG;
+    f32 *colorB;
+    f32 *colorA;
+    u32 *sprite;      // index into the atlas rects passed to ParticleBuildSprites
+
+    void *memory;
+};
+
+// Spawn parameters; ranges pick uniformly per particle
+struct ParticleEmitter
+{
+    struct ParticlePool pool;
+
+    f32 position[2];
+    f32 positionJitter;  // spawn up to this far from position on each axis
+    f32 rate;            // particles per second
+    f32 spawnAccumulator;
+
+    f32 direction;       // radians
+    f32 spread;          // radians either side of direction
+    f32 speedMin;
+    f32 speedMax;
+    f32 lifetimeMin;
+    f32 lifetimeMax;
+    f32 sizeMin;
+    f32 sizeMax;
+    f32 color[4];
+    f32 colorJitter;     // added to r, g and b in [-colorJitter, colorJitter]
+    u32 sprite;          // atlas sprite, e.g. a Sprite_ value
+    u32 spriteVariants;  // sprites to pick from, counting up from `sprite`
+
+    f32 acceleration[2]; // gravity, wind
+    f32 drag;            // fraction of velocity lost per second
+
+    u32 seed;
+};
+
+void ParticlePoolInit(struct ParticlePool *pool, u32 capacity, Allocator *alloc, void *user);
+void ParticlePoolFree(struct ParticlePool *pool, Allocator *alloc, void *user);
+
+// Clears the emitter to an inactive one (rate 0) with an empty pool
+void ParticleEmitterInit(struct ParticleEmitter *emitter, u32 capacity, u32 seed, Allocator *alloc, void *user);
+void ParticleEmitterFree(struct ParticleEmitter *emitter, Allocator *alloc, void *user);
+
+// Steps every live particle, removes the dead, then spawns this tick's new
+// ones, which aren't stepped until the next tick. Spawns are dropped while
+// the pool is full.
+void ParticleEmitterUpdate(struct ParticleEmitter *emitter, f32 dt);
+
+// Writes one sprite per live particle at height `z`, fading alpha with the
+// remaining life. `rects` is the atlas table the emitters' sprite indices
+// refer to. Returns the number written, at most `capacity`.
+u32 ParticleBuildSprites(const struct ParticlePool *pool, const struct AtlasRect *rects,
+                         struct SpriteInstance *sprites, u32 capacity, f32 z);
+
+#endif // PARTICLES_H
@@ -0,0 +1,302 @@
+#include "profiler.h"
+#include <stdatomic.h>
+#include <string.h>
+#include <time.h>
+#include <glad/gl.h>
+
+#include "allocator.h"
+
+// Thread id the GPU spans show up under in the trace
+#define PROFILER_GPU_TRACE_ID 1000
+#define PROFILER_GPU_EVENTS 4096 // power of two
+
+struct ProfileEvent
+{
+    const char *name; // NULL for the end of a scope
+    u64 time;         // ns
+};
+
+// Written only by its owning thread; the dump reads behind the write index
+struct ProfileThread
+{
+    struct ProfileEvent *events;
+    _Atomic u64 writeIndex;
+    const char *name;
+};
+
+struct GpuSpan
+{
+    const char *name;
+    u64 start; // CPU time the span was issued at
+    u64 duration;
+};
+
+struct GpuQuerySet
+{
+    GLuint queries[PROFILER_GPU_SPANS_PER_FRAME];
+    struct GpuSpan spans[PROFILER_GPU_SPANS_PER_FRAME];
+    u32 count;
+};
+
+struct Profiler
+{
+    struct ProfileThread threads[PROFILER_MAX_THREADS];
+    _Atomic u32 threadCount;
+
+    u64 frameStarts[PROFILER_MAX_FRAMES];
+    u64 frameIndex;
+
+    // Frame N issues into set N % 2 and reads back what frame N - 2 issued there
+    struct GpuQuerySet querySets[2];
+    bool gpuSpanOpen;
+    struct GpuSpan gpuSpans[PROFILER_GPU_EVENTS];
+    u64 gpuSpanCount;
+};
+
+static struct Profiler profiler;
+static _Thread_local struct ProfileThread *profileThread;
+
+static u64 ProfilerNow(void)
+{
+    // Goes through the vDSO, so about as cheap as rdtsc without the calibration
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (u64)now.tv_sec * 1000000000ull + (u64)now.tv_nsec;
+}
+
+static struct ProfileThread *GetProfileThread(void)
+{
+    if (!profileThread)
+    {
+        u32 index = atomic_fetch_add(&profiler.threadCount, 1);
+        if (index >= PROFILER_MAX_THREADS)
+        {
+            atomic_fetch_sub(&profiler.threadCount, 1);
+            return NULL;
+        }
+
+        struct ProfileThread *thread = &profiler.threads[index];
+        thread->events = MemAlloc(DefaultAllocator, PROFILER_EVENTS_PER_THREAD * sizeof(*thread->events));
+        profileThread = thread;
+    }
+
+    return profileThread->events ? profileThread : NULL;
+}
+
+static void Record(const char *name)
+{
+    struct ProfileThread *thread = GetProfileThread();
+    if (thread)
+    {
+        u64 index = atomic_load_explicit(&thread->writeIndex, memory_order_relaxed);
+        thread->events[index & (PROFILER_EVENTS_PER_THREAD - 1)] = (struct ProfileEvent){name, ProfilerNow()};
+        atomic_store_explicit(&thread->writeIndex, index + 1, memory_order_release);
+    }
+}
+
+void ProfilerInit(void)
+{
+    for (u32 i = 0; i < ARRAY_LEN(profiler.querySets); ++i)
+    {
+        glGenQueries(PROFILER_GPU_SPANS_PER_FRAME, profiler.querySets[i].queries);
+    }
+    ProfilerThreadName("Main");
+}
+
+void ProfilerShutdown(void)
+{
+    for (u32 i = 0; i < ARRAY_LEN(profiler.querySets); ++i)
+    {
+        glDeleteQueries(PROFILER_GPU_SPANS_PER_FRAME, profiler.querySets[i].queries);
+    }
+
+    // Only call once the other threads have stopped recording
+    u32 threadCount = atomic_load(&profiler.threadCount);
+    for (u32 i = 0; i < threadCount; ++i)
+    {
+        MemFree(DefaultAllocator, profiler.threads[i].events);
+    }
+    memset(&profiler, 0, sizeof(profiler));
+    profileThread = NULL;
+}
+
+void ProfilerFrame(void)
+{
+    profiler.frameIndex += 1;
+    profiler.frameStarts[profiler.frameIndex % PROFILER_MAX_FRAMES] = ProfilerNow();
+
+    struct GpuQuerySet *set = &profiler.querySets[profiler.frameIndex % 2];
+    for (u32 i = 0; i < set->count; ++i)
+    {
+        // Two frames is normally plenty; drop the span rather than stall if not
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(set->queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            continue;
+        }
+
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(set->queries[i], GL_QUERY_RESULT, &elapsed);
+        struct GpuSpan span = set->spans[i];
+        span.duration = elapsed;
+        profiler.gpuSpans[profiler.gpuSpanCount++ & (PROFILER_GPU_EVENTS - 1)] = span;
+    }
+    set->count = 0;
+}
+
+void ProfilerThreadName(const char *name)
+{
+    struct ProfileThread *thread = GetProfileThread();
+    if (thread)
+    {
+        thread->name = name;
+    }
+}
+
+void ProfilerBegin(const char *name)
+{
+    Record(name);
+}
+
+void ProfilerEnd(void)
+{
+    Record(NULL);
+}
+
+void ProfilerGpuBegin(const char *name)
+{
+    struct GpuQuerySet *set = &profiler.querySets[profiler.frameIndex % 2];
+    if (profiler.gpuSpanOpen || set->count >= PROFILER_GPU_SPANS_PER_FRAME)
+    {
+        return;
+    }
+
+    set->spans[set->count] = (struct GpuSpan){name, ProfilerNow(), 0};
+    glBeginQuery(GL_TIME_ELAPSED, set->queries[set->count]);
+    profiler.gpuSpanOpen = true;
+}
+
+void ProfilerGpuEnd(void)
+{
+    if (profiler.gpuSpanOpen)
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        profiler.querySets[profiler.frameIndex % 2].count += 1;
+        profiler.gpuSpanOpen = false;
+    }
+}
+
+static void WriteEvent(FILE *file, bool *first, const char *name, u32 threadId, u64 start, u64 duration, u64 origin)
+{
+    fprintf(file, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+            *first ? "" : ",", name, threadId, (f64)(start - origin) * 1e-3, (f64)duration * 1e-3);
+    *first = false;
+}
+
+// Turns one thread's begin/end pairs into complete events. Scopes that began
+// before `cutoff` or haven't ended yet are left out.
+static void WriteThread(FILE *file, bool *first, struct ProfileThread *thread, u32 threadId, u64 cutoff, u64 origin)
+{
+    u64 end = atomic_load_explicit(&thread->writeIndex, memory_order_acquire);
+    u64 start = end > PROFILER_EVENTS_PER_THREAD ? end - PROFILER_EVENTS_PER_THREAD : 0;
+    u64 count = end - start;
+
+    struct ProfileEvent *events = MemAlloc(DefaultAllocator, count * sizeof(*events));
+    if (!events)
+    {
+        return;
+    }
+    for (u64 i = 0; i < count; ++i)
+    {
+        events[i] = thread->events[(start + i) & (PROFILER_EVENTS_PER_THREAD - 1)];
+    }
+
+    // The owner kept writing while we copied; skip whatever it lapped
+    atomic_thread_fence(memory_order_acquire);
+    u64 newEnd = atomic_load_explicit(&thread->writeIndex, memory_order_relaxed);
+    u64 firstValid = newEnd > PROFILER_EVENTS_PER_THREAD ? newEnd - PROFILER_EVENTS_PER_THREAD : 0;
+    u64 skip = firstValid > start ? firstValid - start : 0;
+
+    struct ProfileEvent *stack[64];
+    u32 depth = 0;
+    for (u64 i = skip < count ? skip : count; i < count; ++i)
+    {
+        struct ProfileEvent *event = &events[i];
+        if (event->name)
+        {
+            if (depth < ARRAY_LEN(stack))
+            {
+                stack[depth] = event;
+            }
+            ++depth;
+        }
+        else if (depth > 0)
+        {
+            --depth;
+            if (depth < ARRAY_LEN(stack) && stack[depth]->time >= cutoff)
+            {
+                WriteEvent(file, first, stack[depth]->name, threadId, stack[depth]->time,
+                           event->time - stack[depth]->time, origin);
+            }
+        }
+    }
+
+    MemFree(DefaultAllocator, events);
+}
+
+bool ProfilerWriteTrace(const char *path, u32 frameCount)
+{
+    if (frameCount >= PROFILER_MAX_FRAMES)
+    {
+        frameCount = PROFILER_MAX_FRAMES - 1;
+    }
+    u64 cutoff = 0;
+    if (frameCount > 0 && profiler.frameIndex >= frameCount)
+    {
+        cutoff = profiler.frameStarts[(profiler.frameIndex - frameCount + 1) % PROFILER_MAX_FRAMES];
+    }
+
+    FILE *file = fopen(path, "w");
+    if (!file)
+    {
+        return false;
+    }
+
+    u64 origin = cutoff;
+    bool first = true;
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+    u32 threadCount = atomic_load(&profiler.threadCount);
+    for (u32 i = 0; i < threadCount; ++i)
+    {
+        struct ProfileThread *thread = &profiler.threads[i];
+        if (thread->name)
+        {
+            fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                    first ? "" : ",", i, thread->name);
+            first = false;
+        }
+        if (thread->events)
+        {
+            WriteThread(file, &first, thread, i, cutoff, origin);
+        }
+    }
+
+    fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"GPU\"}}",
+            first ? "" : ",", PROFILER_GPU_TRACE_ID);
+    first = false;
+
+    u64 gpuStart = profiler.gpuSpanCount > PROFILER_GPU_EVENTS ? profiler.gpuSpanCount - PROFILER_GPU_EVENTS : 0;
+    for (u64 i = gpuStart; i < profiler.gpuSpanCount; ++i)
+    {
+        struct GpuSpan *span = &profiler.gpuSpans[i & (PROFILER_GPU_EVENTS - 1)];
+        if (span->start >= cutoff)
+        {
+            WriteEvent(file, &first, span->name, PROFILER_GPU_TRACE_ID, span->start, span->duration, origin);
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+    return fclose(file) == 0;
+}
@@ -0,0 +1,64 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// Frame profiler. CPU scopes are recorded per thread into lock-free ring
+// buffers; GPU spans use GL_TIME_ELAPSED queries that are read back two
+// frames later so the CPU never waits on them. ProfilerWriteTrace dumps the
+// last frames as Chrome trace_event JSON (chrome://tracing, Perfetto).
+//
+// Use the PROFILE_* macros rather than the functions; with FEJNANDO_PROFILER
+// off they expand to nothing and profiler.c isn't built at all.
+//
+// Scope names must outlive the profiler, i.e. be string literals.
+
+#include "common.h"
+
+#define PROFILER_MAX_THREADS 64
+#define PROFILER_EVENTS_PER_THREAD (1u << 16) // power of two
+#define PROFILER_MAX_FRAMES 128               // frames a trace can reach back
+#define PROFILER_GPU_SPANS_PER_FRAME 32
+
+#ifdef FEJNANDO_PROFILER
+
+// Needs a current GL context for the GPU queries
+void ProfilerInit(void);
+void ProfilerShutdown(void);
+
+// Marks the start of a frame and collects the GPU spans that finished since
+void ProfilerFrame(void);
+
+void ProfilerThreadName(const char *name);
+void ProfilerBegin(const char *name);
+void ProfilerEnd(void);
+
+// GPU spans can't nest; GL allows one GL_TIME_ELAPSED query at a time
+void ProfilerGpuBegin(const char *name);
+void ProfilerGpuEnd(void);
+
+bool ProfilerWriteTrace(const char *path, u32 frameCount);
+
+#define PROFILE_INIT() ProfilerInit()
+#define PROFILE_SHUTDOWN() ProfilerShutdown()
+#define PROFILE_FRAME() ProfilerFrame()
+#define PROFILE_THREAD_NAME(name) ProfilerThreadName(name)
+#define PROFILE_BEGIN(name) ProfilerBegin(name)
+#define PROFILE_END() ProfilerEnd()
+#define PROFILE_GPU_BEGIN(name) ProfilerGpuBegin(name)
+#define PROFILE_GPU_END() ProfilerGpuEnd()
+#define PROFILE_WRITE_TRACE(path, frameCount) ProfilerWriteTrace(path, frameCount)
+
+#else
+
+#define PROFILE_INIT() ((void)0)
+#define PROFILE_SHUTDOWN() ((void)0)
+#define PROFILE_FRAME() ((void)0)
+#define PROFILE_THREAD_NAME(name) ((void)0)
+#define PROFILE_BEGIN(name) ((void)0)
+#define PROFILE_END() ((void)0)
+#define PROFILE_GPU_BEGIN(name) ((void)0)
+#define PROFILE_GPU_END() ((void)0)
+#define PROFILE_WRITE_TRACE(path, frameCount) (false)
+
+#endif // FEJNANDO_PROFILER
+
+#endif // PROFILER_H
@@ -0,0 +1,211 @@
+#include "render_queue.h"
+#include <string.h>
+#include <glad/gl.h>
+
+#include "gl_state.h"
+
+#define RENDER_KEY_LAYER_SHIFT 60
+#define RENDER_KEY_TRANSLUCENT_BIT (1ull << 59)
+#define RENDER_KEY_DEPTH_BITS 24
+#define RENDER_KEY_DEPTH_MAX ((1u << RENDER_KEY_DEPTH_BITS) - 1)
+
+void RenderQueueInit(struct RenderQueue *queue, u32 capacity, Allocator *alloc, void *user)
+{
+    memset(queue, 0, sizeof(*queue));
+    queue->commands = MemAllocUser(alloc, capacity * sizeof(*queue->commands), user);
+    queue->keys = MemAllocUser(alloc, capacity * sizeof(*queue->keys), user);
+    queue->order = MemAllocUser(alloc, capacity * sizeof(*queue->order), user);
+    queue->scratchKeys = MemAllocUser(alloc, capacity * sizeof(*queue->scratchKeys), user);
+    queue->scratchOrder = MemAllocUser(alloc, capacity * sizeof(*queue->scratchOrder), user);
+    queue->capacity = capacity;
+}
+
+void RenderQueueFree(struct RenderQueue *queue, Allocator *alloc, void *user)
+{
+    MemFreeUser(alloc, queue->commands, user);
+    MemFreeUser(alloc, queue->keys, user);
+    MemFreeUser(alloc, queue->order, user);
+    MemFreeUser(alloc, queue->scratchKeys, user);
+    MemFreeUser(alloc, queue->scratchOrder, user);
+    memset(queue, 0, sizeof(*queue));
+}
+
+void RenderQueueSetProgram(struct RenderQueue *queue, u32 index, const struct RenderProgram *program)
+{
+    if (index < RENDER_QUEUE_MAX_PROGRAMS)
+    {
+        queue->programs[index] = *program;
+    }
+}
+
+static u64 QuantizeDepth(f32 depth)
+{
+    if (!(depth > 0.0f))
+    {
+        return 0;
+    }
+    if (depth >= 1.0f)
+    {
+        return RENDER_KEY_DEPTH_MAX;
+    }
+    return (u64)(depth * (f32)RENDER_KEY_DEPTH_MAX);
+}
+
+u64 RenderKeyOpaque(u32 layer, u32 program, u32 texture, f32 depth)
+{
+    return ((u64)(layer & 0xF) << RENDER_KEY_LAYER_SHIFT) |
+           ((u64)(program & 0xFF) << 51) |
+           ((u64)(texture & 0xFFFF) << 35) |
+           (QuantizeDepth(depth) << 11);
+}
+
+u64 RenderKeyTranslucent(u32 layer, u32 program, u32 texture, f32 depth)
+{
+    return ((u64)(layer & 0xF) << RENDER_KEY_LAYER_SHIFT) |
+           RENDER_KEY_TRANSLUCENT_BIT |
+           ((RENDER_KEY_DEPTH_MAX - QuantizeDepth(depth)) << 35) |
+           ((u64)(program & 0xFF) << 27) |
+           ((u64)(texture & 0xFFFF) << 11);
+}
+
+bool RenderKeyIsTranslucent(u64 key)
+{
+    return (key & RENDER_KEY_TRANSLUCENT_BIT) != 0;
+}
+
+void RenderQueueReset(struct RenderQueue *queue)
+{
+    queue->count = 0;
+}
+
+bool RenderQueuePush(struct RenderQueue *queue, u64 key, const struct RenderCommand *command)
+{
+    if (queue->count == queue->capacity)
+    {
+        return false;
+    }
+
+    u32 index = queue->count++;
+    queue->commands[index] = *command;
+    queue->keys[index] = key;
+    queue->order[index] = index;
+    return true;
+}
+
+// LSD radix sort, a byte per pass. All histograms are built in one read of
+// the keys, and passes over a byte every key shares are skipped; most frames
+// only differ in a few bytes.
+void RenderQueueSort(struct RenderQueue *queue)
+{
+    u32 count = queue->count;
+    if (count < 2)
+    {
+        return;
+    }
+
+    u32 histograms[8][256] = {{0}};
+    for (u32 i = 0; i < count; ++i)
+    {
+        u64 key = queue->keys[i];
+        for (u32 pass = 0; pass < 8; ++pass)
+        {
+            histograms[pass][(key >> (pass * 8)) & 0xFF] += 1;
+        }
+    }
+
+    u64 *keys = queue->keys;
+    u32 *order = queue->order;
+    u64 *scratchKeys = queue->scratchKeys;
+    u32 *scratchOrder = queue->scratchOrder;
+
+    for (u32 pass = 0; pass < 8; ++pass)
+    {
+        u32 *histogram = histograms[pass];
+        u32 shift = pass * 8;
+        if (histogram[(keys[0] >> shift) & 0xFF] == count)
+        {
+            continue;
+        }
+
+        u32 offset = 0;
+        for (u32 bucket = 0; bucket < 256; ++bucket)
+        {
+            u32 bucketCount = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucketCount;
+        }
+
+        for (u32 i = 0; i < count; ++i)
+        {
+            u32 destination = histogram[(keys[i] >> shift) & 0xFF]++;
+            scratchKeys[destination] = keys[i];
+            scratchOrder[destination] = order[i];
+        }
+
+        u64 *swapKeys = keys;
+        keys = scratchKeys;
+        scratchKeys = swapKeys;
+        u32 *swapOrder = order;
+        order = scratchOrder;
+        scratchOrder = swapOrder;
+    }
+
+    // Keep the sorted arrays in their usual slots
+    queue->keys = keys;
+    queue->order = order;
+    queue->scratchKeys = scratchKeys;
+    queue->scratchOrder = scratchOrder;
+}
+
+void RenderQueueExecute(struct RenderQueue *queue, struct SpriteBatch *batch)
+{
+    u32 currentProgram = UINT32_MAX;
+    s32 currentTranslucent = -1;
+
+    for (u32 i = 0; i < queue->count; ++i)
+    {
+        const struct RenderCommand *command = &queue->commands[queue->order[i]];
+
+        s32 translucent = RenderKeyIsTranslucent(queue->keys[i]);
+        if (translucent != currentTranslucent)
+        {
+            SpriteBatchFlush(batch);
+            GLStateSetBlend(translucent);
+            GLStateSetDepthWrite(!translucent);
+            currentTranslucent = translucent;
+        }
+
+        if (command->program != currentProgram && command->program < RENDER_QUEUE_MAX_PROGRAMS)
+        {
+            SpriteBatchFlush(batch);
+
+            const struct RenderProgram *program = &queue->programs[command->program];
+            GLStateUseProgram(program->program);
+            GLStateUniform4f(program->multiplyColorLocation, 1.0f, 1.0f, 1.0f, 1.0f);
+            currentProgram = command->program;
+        }
+
+        switch (command->kind)
+        {
+        case RenderCommand_Sprite:
+            SpriteBatchBegin(batch, command->texture);
+            SpriteBatchPush(batch, &command->sprite);
+            break;
+        case RenderCommand_Instanced:
+            SpriteBatchFlush(batch);
+            GLStateBindTexture(command->texture);
+            GLStateBindVertexArray(command->instanced.vao);
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 6, command->instanced.instanceCount);
+            GLStateCountDraw();
+            break;
+        case RenderCommand_SpriteRun:
+            SpriteBatchDrawRun(batch, command->texture, command->run.sprites, command->run.count);
+            break;
+        }
+    }
+
+    SpriteBatchFlush(batch);
+
+    // Leave depth writes on so glClear clears depth next frame
+    GLStateSetDepthWrite(true);
+}
@@ -0,0 +1,92 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+// Per-frame list of draw commands. Submitters push commands in any order
+// with a 64-bit sort key; the queue radix-sorts them once and executes them
+// through the GL state cache, merging consecutive sprites into batches.
+//
+// Key layout, most significant bits first:
+//
+//   opaque:      layer:4 | 0 | program:8 | texture:16 | depth:24 front to back | unused:11
+//   translucent: layer:4 | 1 | depth:24 back to front | program:8 | texture:16 | unused:11
+//
+// So each layer draws its opaque commands first, grouped by state with depth
+// writes on, then its translucent ones in back-to-front order with blending
+// on and depth writes off. The sort is stable, so commands with equal keys
+// keep their submission order.
+
+#include "common.h"
+#include "allocator.h"
+#include "sprite_batch.h"
+
+#define RENDER_QUEUE_MAX_PROGRAMS 16
+
+enum RenderCommandKind
+{
+    RenderCommand_Sprite,
+    RenderCommand_Instanced, // a prebuilt vertex array of sprite instances
+    RenderCommand_SpriteRun, // an array of sprites streamed and drawn in one call
+};
+
+struct RenderCommand
+{
+    u32 kind;
+    u32 program; // index into RenderQueue.programs
+    u32 texture;
+    union
+    {
+        struct SpriteInstance sprite;
+        struct
+        {
+            u32 vao;
+            u32 instanceCount;
+        } instanced;
+        struct
+        {
+            const struct SpriteInstance *sprites; // must stay valid until Execute
+            u32 count;
+        } run;
+    };
+};
+
+// A sprite sheet shader program and where its uniforms live. The camera
+// matrices come from the Camera uniform block, not per program.
+struct RenderProgram
+{
+    u32 program;
+    s32 multiplyColorLocation;
+};
+
+struct RenderQueue
+{
+    struct RenderCommand *commands;
+    u64 *keys;
+    u32 *order; // command indices, sorted along with keys
+    u64 *scratchKeys;
+    u32 *scratchOrder;
+    u32 count;
+    u32 capacity;
+
+    struct RenderProgram programs[RENDER_QUEUE_MAX_PROGRAMS];
+};
+
+void RenderQueueInit(struct RenderQueue *queue, u32 capacity, Allocator *alloc, void *user);
+void RenderQueueFree(struct RenderQueue *queue, Allocator *alloc, void *user);
+
+// Registers or updates (e.g. after a shader reload) program slot `index`
+void RenderQueueSetProgram(struct RenderQueue *queue, u32 index, const struct RenderProgram *program);
+
+// `depth` is the normalized distance from the camera, 0 at the near plane
+u64 RenderKeyOpaque(u32 layer, u32 program, u32 texture, f32 depth);
+u64 RenderKeyTranslucent(u32 layer, u32 program, u32 texture, f32 depth);
+bool RenderKeyIsTranslucent(u64 key);
+
+void RenderQueueReset(struct RenderQueue *queue);
+// Returns false and drops the command when the queue is full
+bool RenderQueuePush(struct RenderQueue *queue, u64 key, const struct RenderCommand *command);
+void RenderQueueSort(struct RenderQueue *queue);
+
+// Runs the sorted commands. The camera's uniform block must be current.
+void RenderQueueExecute(struct RenderQueue *queue, struct SpriteBatch *batch);
+
+#endif // RENDER_QUEUE_H
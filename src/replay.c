@@ -0,0 +1,195 @@
+#include "replay.h"
+#include <string.h>
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ull
+#define FNV_PRIME 0x100000001b3ull
+
+enum ReplayKeyBit
+{
+    ReplayKey_Left = 1 << 0,
+    ReplayKey_Right = 1 << 1,
+    ReplayKey_Up = 1 << 2,
+    ReplayKey_Down = 1 << 3,
+};
+
+u64 ReplayHashMemory(const struct GameMemory *memory)
+{
+    // FNV-1a a word at a time; a byte at a time is too slow for the whole block
+    const u64 *words = memory->base;
+    usize wordCount = memory->size / sizeof(u64);
+
+    u64 hash = FNV_OFFSET_BASIS ^ (u64)memory->isInitialized;
+    for (usize i = 0; i < wordCount; ++i)
+    {
+        hash ^= words[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+static bool PageIsZero(const u8 *page)
+{
+    const u64 *words = (const u64 *)page;
+    for (u32 i = 0; i < REPLAY_PAGE_SIZE / sizeof(u64); ++i)
+    {
+        if (words[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ReplayBeginRecording(struct Replay *replay, const char *path, const struct GameMemory *memory, f64 tickRate)
+{
+    memset(replay, 0, sizeof(*replay));
+
+    replay->file = fopen(path, "wb");
+    if (!replay->file)
+    {
+        return false;
+    }
+
+    replay->header = (struct ReplayHeader){
+        .magic = REPLAY_MAGIC,
+        .version = REPLAY_VERSION,
+        .memoryBase = (u64)(uintptr_t)memory->base,
+        .memorySize = memory->size,
+        .tickRate = tickRate,
+        .isInitialized = memory->isInitialized,
+    };
+    bool ok = fwrite(&replay->header, sizeof(replay->header), 1, replay->file) == 1;
+
+    // Most of the block is untouched arena, so only store pages with data
+    const u8 *base = memory->base;
+    u32 pageCount = (u32)(memory->size / REPLAY_PAGE_SIZE);
+    for (u32 page = 0; page < pageCount && ok; ++page)
+    {
+        const u8 *data = base + (usize)page * REPLAY_PAGE_SIZE;
+        if (!PageIsZero(data))
+        {
+            ok = fwrite(&page, sizeof(page), 1, replay->file) == 1 &&
+                 fwrite(data, REPLAY_PAGE_SIZE, 1, replay->file) == 1;
+        }
+    }
+
+    u32 endOfPages = REPLAY_END_OF_PAGES;
+    ok = ok && fwrite(&endOfPages, sizeof(endOfPages), 1, replay->file) == 1;
+    if (!ok)
+    {
+        fclose(replay->file);
+        replay->file = NULL;
+        return false;
+    }
+
+    replay->recording = true;
+    return true;
+}
+
+void ReplayRecordTick(struct Replay *replay, const struct GameInput *input)
+{
+    u8 keys = (u8)((input->keyLeft ? ReplayKey_Left : 0) |
+                   (input->keyRight ? ReplayKey_Right : 0) |
+                   (input->keyUp ? ReplayKey_Up : 0) |
+                   (input->keyDown ? ReplayKey_Down : 0));
+    fputc(keys, replay->file);
+    replay->tickCount += 1;
+}
+
+bool ReplayEndRecording(struct Replay *replay, const struct GameMemory *memory)
+{
+    u64 hash = ReplayHashMemory(memory);
+    bool ok = fputc(REPLAY_END_OF_TICKS, replay->file) != EOF &&
+              fwrite(&hash, sizeof(hash), 1, replay->file) == 1;
+    ok = (fclose(replay->file) == 0) && ok;
+
+    replay->file = NULL;
+    replay->recording = false;
+    return ok;
+}
+
+bool ReplayBeginPlayback(struct Replay *replay, const char *path, struct GameMemory *memory)
+{
+    memset(replay, 0, sizeof(*replay));
+
+    replay->file = fopen(path, "rb");
+    if (!replay->file)
+    {
+        return false;
+    }
+
+    struct ReplayHeader *header = &replay->header;
+    if (fread(header, sizeof(*header), 1, replay->file) != 1 ||
+        header->magic != REPLAY_MAGIC || header->version != REPLAY_VERSION ||
+        header->memoryBase != (u64)(uintptr_t)memory->base || header->memorySize != memory->size)
+    {
+        fclose(replay->file);
+        replay->file = NULL;
+        return false;
+    }
+
+    memset(memory->base, 0, memory->size);
+    memory->isInitialized = header->isInitialized != 0;
+
+    u32 pageCount = (u32)(memory->size / REPLAY_PAGE_SIZE);
+    bool ok = true;
+    for (;;)
+    {
+        u32 page;
+        if (fread(&page, sizeof(page), 1, replay->file) != 1)
+        {
+            ok = false;
+            break;
+        }
+        if (page == REPLAY_END_OF_PAGES)
+        {
+            break;
+        }
+        if (page >= pageCount ||
+            fread((u8 *)memory->base + (usize)page * REPLAY_PAGE_SIZE, REPLAY_PAGE_SIZE, 1, replay->file) != 1)
+        {
+            ok = false;
+            break;
+        }
+    }
+
+    // The final hash is the last thing in the file
+    long ticksStart = ftell(replay->file);
+    ok = ok && ticksStart >= 0 &&
+         fseek(replay->file, -(long)sizeof(replay->expectedHash), SEEK_END) == 0 &&
+         fread(&replay->expectedHash, sizeof(replay->expectedHash), 1, replay->file) == 1 &&
+         fseek(replay->file, ticksStart, SEEK_SET) == 0;
+    if (!ok)
+    {
+        fclose(replay->file);
+        replay->file = NULL;
+        return false;
+    }
+
+    replay->playing = true;
+    return true;
+}
+
+bool ReplayNextTick(struct Replay *replay, struct GameInput *input)
+{
+    int keys = fgetc(replay->file);
+    if (keys == EOF || keys == REPLAY_END_OF_TICKS)
+    {
+        return false;
+    }
+
+    input->keyLeft = (keys & ReplayKey_Left) != 0;
+    input->keyRight = (keys & ReplayKey_Right) != 0;
+    input->keyUp = (keys & ReplayKey_Up) != 0;
+    input->keyDown = (keys & ReplayKey_Down) != 0;
+    replay->tickCount += 1;
+    return true;
+}
+
+bool ReplayEndPlayback(struct Replay *replay, const struct GameMemory *memory)
+{
+    fclose(replay->file);
+    replay->file = NULL;
+    replay->playing = false;
+    return ReplayHashMemory(memory) == replay->expectedHash;
+}
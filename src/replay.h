@@ -0,0 +1,68 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+// Input recording and playback. A recording starts with a snapshot of the
+// whole game memory block, then stores the GameInput of every simulation
+// tick, and ends with a hash of the game memory after the last tick.
+// Feeding the same inputs to the same snapshot at the same tick rate must
+// reproduce that hash, so every recording doubles as a determinism check.
+//
+// File layout, little-endian:
+//
+//   struct ReplayHeader
+//   snapshot: pages of REPLAY_PAGE_SIZE bytes that aren't all zero, each
+//             preceded by its u32 page index; u32 REPLAY_END_OF_PAGES ends it
+//   ticks:    one byte of key bits per tick, REPLAY_END_OF_TICKS ends it
+//   u64 FNV-1a hash of game memory after the last tick
+//
+// The game keeps pointers into its memory block, so a snapshot can only be
+// restored at the address it was taken from. The platform maps game memory
+// at a fixed address to make that the same across runs.
+
+#include "common.h"
+#include "game.h"
+
+#define REPLAY_MAGIC 0x50524a46u // "FJRP"
+#define REPLAY_VERSION 1
+#define REPLAY_PAGE_SIZE 4096
+#define REPLAY_END_OF_PAGES UINT32_MAX
+#define REPLAY_END_OF_TICKS 0xFF
+
+struct ReplayHeader
+{
+    u32 magic;
+    u32 version;
+    u64 memoryBase;
+    u64 memorySize;
+    f64 tickRate;
+    u32 isInitialized;
+    u32 reserved;
+};
+
+struct Replay
+{
+    FILE *file;
+    bool recording;
+    bool playing;
+    struct ReplayHeader header;
+    u32 tickCount;
+    u64 expectedHash; // playback: hash stored at the end of the file
+};
+
+u64 ReplayHashMemory(const struct GameMemory *memory);
+
+// Writes the header and snapshot. `memory` must be between ticks.
+bool ReplayBeginRecording(struct Replay *replay, const char *path, const struct GameMemory *memory, f64 tickRate);
+void ReplayRecordTick(struct Replay *replay, const struct GameInput *input);
+// Writes the final hash and closes the file
+bool ReplayEndRecording(struct Replay *replay, const struct GameMemory *memory);
+
+// Opens a recording and restores its snapshot into `memory`. Fails if the
+// memory block's address or size differ from the recorded one.
+bool ReplayBeginPlayback(struct Replay *replay, const char *path, struct GameMemory *memory);
+// Returns false once the recorded ticks run out
+bool ReplayNextTick(struct Replay *replay, struct GameInput *input);
+// Closes the file; true if `memory` matches the recorded final state
+bool ReplayEndPlayback(struct Replay *replay, const struct GameMemory *memory);
+
+#endif // REPLAY_H
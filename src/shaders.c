@@ -1,11 +1,58 @@
 #include "shaders.h"
+#include <errno.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <glad/gl.h>
 
-u32 CompileShaders(u8 *vertexShaderSource, u8 *fragmentShaderSource)
+#include "allocator.h"
+
+// ARB_get_program_binary (core in 4.1). The bundled glad only covers 3.3 core,
+// so the entry points are loaded by hand.
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+
+typedef void (GLAD_API_PTR *GetProgramBinaryFn)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+typedef void (GLAD_API_PTR *ProgramBinaryFn)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+typedef void (GLAD_API_PTR *ProgramParameteriFn)(GLuint program, GLenum pname, GLint value);
+
+static GetProgramBinaryFn GetProgramBinary;
+static ProgramBinaryFn ProgramBinary;
+static ProgramParameteriFn ProgramParameteri;
+
+#define SHADER_CACHE_MAGIC 0x48435346 // "FSCH"
+#define SHADER_CACHE_VERSION 1
+
+struct ShaderCacheHeader
+{
+    u32 magic;
+    u32 version;
+    u64 key;
+    u32 format;
+    u32 length;
+};
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ull
+#define FNV_PRIME 0x100000001b3ull
+
+static u64 HashString(u64 hash, const char *string)
+{
+    // Hash the terminator too, so ("ab", "c") and ("a", "bc") differ
+    do
+    {
+        hash ^= (u8)*string;
+        hash *= FNV_PRIME;
+    } while (*string++);
+    return hash;
+}
+
+static u32 BuildProgram(const char *vertexShaderSource, const char *fragmentShaderSource, bool retrievable)
 {
     // Create and compile the vertex shader
     GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, (const char **)&vertexShaderSource, NULL);
+    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
     glCompileShader(vertexShader);
 
     // Check for shader compilation errors
@@ -16,11 +63,13 @@ u32 CompileShaders(u8 *vertexShaderSource, u8 *fragmentShaderSource)
     {
         glGetShaderInfoLog(vertexShader, sizeof(infoLog), NULL, infoLog);
         fprintf(stderr, "Vertex shader compilation error: %s\n", infoLog);
+        glDeleteShader(vertexShader);
+        return 0;
     }
 
     // Create and compile the fragment shader
     GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, (const char **)&fragmentShaderSource, NULL);
+    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
     glCompileShader(fragmentShader);
 
     // Check for shader compilation errors
@@ -29,24 +78,380 @@ u32 CompileShaders(u8 *vertexShaderSource, u8 *fragmentShaderSource)
     {
         glGetShaderInfoLog(fragmentShader, sizeof(infoLog), NULL, infoLog);
         fprintf(stderr, "Fragment shader compilation error: %s\n", infoLog);
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+        return 0;
     }
 
     // Create and link the shader program
     GLuint shaderProgram = glCreateProgram();
+    if (retrievable)
+    {
+        ProgramParameteri(shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
     glAttachShader(shaderProgram, vertexShader);
     glAttachShader(shaderProgram, fragmentShader);
     glLinkProgram(shaderProgram);
 
+    glDetachShader(shaderProgram, vertexShader);
+    glDetachShader(shaderProgram, fragmentShader);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
     // Check for shader program linking errors
     glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
     if (!success)
     {
         glGetProgramInfoLog(shaderProgram, sizeof(infoLog), NULL, infoLog);
         fprintf(stderr, "Shader program linking error: %s\n", infoLog);
+        glDeleteProgram(shaderProgram);
+        return 0;
     }
 
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-
     return shaderProgram;
 }
+
+u32 CompileShaders(u8 *vertexShaderSource, u8 *fragmentShaderSource)
+{
+    return BuildProgram((const char *)vertexShaderSource, (const char *)fragmentShaderSource, false);
+}
+
+static bool HasProgramBinarySupport(void)
+{
+    GLint major = 0;
+    GLint minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    bool supported = major > 4 || (major == 4 && minor >= 1);
+
+    GLint extensionCount = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+    for (GLint i = 0; i < extensionCount && !supported; ++i)
+    {
+        const char *extension = (const char *)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+        supported = extension && strcmp(extension, "GL_ARB_get_program_binary") == 0;
+    }
+
+    if (!supported || !GetProgramBinary || !ProgramBinary || !ProgramParameteri)
+    {
+        return false;
+    }
+
+    // Some drivers expose the entry points but no formats to store
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    return formatCount > 0;
+}
+
+bool ShaderManagerInit(struct ShaderManager *manager, ShaderGetProcAddressFn getProcAddress,
+                       const char *cacheDirectory, const char *watchDirectory)
+{
+    memset(manager, 0, sizeof(*manager));
+    manager->inotifyFd = -1;
+    manager->watchDescriptor = -1;
+
+    *(ShaderLoadFn *)&GetProgramBinary = getProcAddress("glGetProgramBinary");
+    *(ShaderLoadFn *)&ProgramBinary = getProcAddress("glProgramBinary");
+    *(ShaderLoadFn *)&ProgramParameteri = getProcAddress("glProgramParameteri");
+
+    snprintf(manager->cacheDirectory, sizeof(manager->cacheDirectory), "%s", cacheDirectory);
+    manager->binaryCacheSupported = HasProgramBinarySupport();
+    if (manager->binaryCacheSupported && mkdir(cacheDirectory, 0755) != 0 && errno != EEXIST)
+    {
+        fprintf(stderr, "Could not create shader cache directory %s.\n", cacheDirectory);
+        manager->binaryCacheSupported = false;
+    }
+
+    // A binary is only valid for the driver that produced it
+    u64 driverHash = FNV_OFFSET_BASIS;
+    driverHash = HashString(driverHash, (const char *)glGetString(GL_VENDOR));
+    driverHash = HashString(driverHash, (const char *)glGetString(GL_RENDERER));
+    driverHash = HashString(driverHash, (const char *)glGetString(GL_VERSION));
+    manager->driverHash = driverHash;
+
+    if (watchDirectory)
+    {
+        snprintf(manager->watchDirectory, sizeof(manager->watchDirectory), "%s", watchDirectory);
+        manager->inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (manager->inotifyFd >= 0)
+        {
+            // Editors either write in place or write a temporary file and rename it over
+            manager->watchDescriptor = inotify_add_watch(manager->inotifyFd, watchDirectory, IN_CLOSE_WRITE | IN_MOVED_TO);
+        }
+        if (manager->watchDescriptor < 0)
+        {
+            fprintf(stderr, "Could not watch %s for shader changes.\n", watchDirectory);
+        }
+    }
+
+    return true;
+}
+
+void ShaderManagerShutdown(struct ShaderManager *manager)
+{
+    for (u32 i = 0; i < manager->programCount; ++i)
+    {
+        glDeleteProgram(manager->programs[i].program);
+    }
+    manager->programCount = 0;
+
+    if (manager->inotifyFd >= 0)
+    {
+        close(manager->inotifyFd);
+        manager->inotifyFd = -1;
+    }
+}
+
+static void CachePath(const struct ShaderManager *manager, u64 key, char *path, usize pathSize)
+{
+    snprintf(path, pathSize, "%s/%016llx.bin", manager->cacheDirectory, (unsigned long long)key);
+}
+
+static u32 LoadCachedProgram(const struct ShaderManager *manager, u64 key)
+{
+    char path[SHADER_PATH_LENGTH + 32];
+    CachePath(manager, key, path, sizeof(path));
+
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        return 0;
+    }
+
+    struct ShaderCacheHeader header;
+    void *binary = NULL;
+    if (fread(&header, sizeof(header), 1, file) == 1 && header.magic == SHADER_CACHE_MAGIC &&
+        header.version == SHADER_CACHE_VERSION && header.key == key)
+    {
+        binary = MemAlloc(DefaultAllocator, header.length);
+        if (binary && fread(binary, 1, header.length, file) != header.length)
+        {
+            MemFree(DefaultAllocator, binary);
+            binary = NULL;
+        }
+    }
+    fclose(file);
+
+    if (!binary)
+    {
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    ProgramBinary(program, header.format, binary, (GLsizei)header.length);
+    MemFree(DefaultAllocator, binary);
+
+    // Fails after a driver update that changed the format; just rebuild then
+    GLint success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    return program;
+}
+
+static void SaveCachedProgram(const struct ShaderManager *manager, u64 key, u32 program)
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+    {
+        return;
+    }
+
+    void *binary = MemAlloc(DefaultAllocator, (usize)length);
+    if (!binary)
+    {
+        return;
+    }
+
+    struct ShaderCacheHeader header = {
+        .magic = SHADER_CACHE_MAGIC,
+        .version = SHADER_CACHE_VERSION,
+        .key = key,
+    };
+    GLsizei written = 0;
+    GetProgramBinary(program, length, &written, &header.format, binary);
+    header.length = (u32)written;
+
+    // Write to the side and rename, so a crash never leaves a torn cache entry
+    char path[SHADER_PATH_LENGTH + 32];
+    char temporaryPath[SHADER_PATH_LENGTH + 40];
+    CachePath(manager, key, path, sizeof(path));
+    snprintf(temporaryPath, sizeof(temporaryPath), "%s.tmp", path);
+
+    FILE *file = fopen(temporaryPath, "wb");
+    if (file)
+    {
+        bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                  fwrite(binary, 1, header.length, file) == header.length;
+        ok = fclose(file) == 0 && ok;
+        if (!ok || rename(temporaryPath, path) != 0)
+        {
+            remove(temporaryPath);
+        }
+    }
+
+    MemFree(DefaultAllocator, binary);
+}
+
+// Links a program, going through the binary cache when the driver supports it
+static u32 BuildCachedProgram(struct ShaderManager *manager, const char *vertexSource, const char *fragmentSource)
+{
+    if (!manager->binaryCacheSupported)
+    {
+        return BuildProgram(vertexSource, fragmentSource, false);
+    }
+
+    u64 key = HashString(HashString(manager->driverHash, vertexSource), fragmentSource);
+    u32 program = LoadCachedProgram(manager, key);
+    if (!program)
+    {
+        program = BuildProgram(vertexSource, fragmentSource, true);
+        if (program)
+        {
+            SaveCachedProgram(manager, key, program);
+        }
+    }
+
+    return program;
+}
+
+u32 ShaderManagerLoad(struct ShaderManager *manager, const char *vertexSource, const char *fragmentSource,
+                      const char *vertexPath, const char *fragmentPath)
+{
+    if (manager->programCount >= SHADER_MAX_PROGRAMS)
+    {
+        return SHADER_INVALID_HANDLE;
+    }
+
+    u32 program = BuildCachedProgram(manager, vertexSource, fragmentSource);
+    if (!program)
+    {
+        return SHADER_INVALID_HANDLE;
+    }
+
+    u32 handle = manager->programCount++;
+    struct ShaderProgram *entry = &manager->programs[handle];
+    memset(entry, 0, sizeof(*entry));
+    entry->program = program;
+    entry->generation = 1;
+    snprintf(entry->vertexPath, sizeof(entry->vertexPath), "%s", vertexPath);
+    snprintf(entry->fragmentPath, sizeof(entry->fragmentPath), "%s", fragmentPath);
+
+    return handle;
+}
+
+static char *ReadSource(const struct ShaderManager *manager, const char *name)
+{
+    char path[2 * SHADER_PATH_LENGTH];
+    snprintf(path, sizeof(path), "%s/%s", manager->watchDirectory, name);
+
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    char *source = length >= 0 ? MemAlloc(DefaultAllocator, (usize)length + 1) : NULL;
+    if (source && fread(source, 1, (usize)length, file) != (usize)length)
+    {
+        MemFree(DefaultAllocator, source);
+        source = NULL;
+    }
+    fclose(file);
+
+    if (source)
+    {
+        source[length] = '\0';
+    }
+    return source;
+}
+
+static void MarkChangedFile(struct ShaderManager *manager, const char *name)
+{
+    for (u32 i = 0; i < manager->programCount; ++i)
+    {
+        struct ShaderProgram *entry = &manager->programs[i];
+        if (strcmp(entry->vertexPath, name) == 0 || strcmp(entry->fragmentPath, name) == 0)
+        {
+            entry->dirty = true;
+        }
+    }
+}
+
+bool ShaderManagerUpdate(struct ShaderManager *manager)
+{
+    if (manager->inotifyFd < 0)
+    {
+        return false;
+    }
+
+    _Alignas(struct inotify_event) char buffer[4096];
+    for (;;)
+    {
+        ssize_t length = read(manager->inotifyFd, buffer, sizeof(buffer));
+        if (length <= 0)
+        {
+            break;
+        }
+
+        for (char *cursor = buffer; cursor < buffer + length;)
+        {
+            struct inotify_event *event = (struct inotify_event *)cursor;
+            if (event->len > 0)
+            {
+                MarkChangedFile(manager, event->name);
+            }
+            cursor += sizeof(*event) + event->len;
+        }
+    }
+
+    bool replaced = false;
+    for (u32 i = 0; i < manager->programCount; ++i)
+    {
+        struct ShaderProgram *entry = &manager->programs[i];
+        if (!entry->dirty)
+        {
+            continue;
+        }
+        entry->dirty = false;
+
+        char *vertexSource = ReadSource(manager, entry->vertexPath);
+        char *fragmentSource = ReadSource(manager, entry->fragmentPath);
+        u32 program = vertexSource && fragmentSource ? BuildCachedProgram(manager, vertexSource, fragmentSource) : 0;
+        MemFree(DefaultAllocator, vertexSource);
+        MemFree(DefaultAllocator, fragmentSource);
+
+        if (!program)
+        {
+            fprintf(stderr, "Keeping the previous %s / %s program.\n", entry->vertexPath, entry->fragmentPath);
+            continue;
+        }
+
+        glDeleteProgram(entry->program);
+        entry->program = program;
+        ++entry->generation;
+        replaced = true;
+        printf("Reloaded %s / %s (generation %u).\n", entry->vertexPath, entry->fragmentPath, entry->generation);
+    }
+
+    return replaced;
+}
+
+u32 ShaderManagerProgram(const struct ShaderManager *manager, u32 handle)
+{
+    return handle < manager->programCount ? manager->programs[handle].program : 0;
+}
+
+u32 ShaderManagerGeneration(const struct ShaderManager *manager, u32 handle)
+{
+    return handle < manager->programCount ? manager->programs[handle].generation : 0;
+}
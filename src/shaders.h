@@ -3,6 +3,60 @@
 
 #include "common.h"
 
+#define SHADER_MAX_PROGRAMS 16
+#define SHADER_PATH_LENGTH 256
+#define SHADER_INVALID_HANDLE UINT32_MAX
+
+typedef void (*ShaderLoadFn)(void);
+typedef ShaderLoadFn (*ShaderGetProcAddressFn)(const char *name);
+
+// Returns the linked program, or 0 if compiling or linking failed
 u32 CompileShaders(u8 *vertexShaderSource, u8 *fragmentShaderSource);
 
+struct ShaderProgram
+{
+    u32 program;    // last program that linked successfully
+    u32 generation; // bumped whenever `program` is replaced
+    char vertexPath[SHADER_PATH_LENGTH];   // file names inside the watched directory
+    char fragmentPath[SHADER_PATH_LENGTH];
+    bool dirty;
+};
+
+// Owns the linked programs. Programs are cached on disk as driver binaries,
+// keyed by their sources and the driver, so warm starts skip compilation,
+// and their source files are watched so edits get recompiled live.
+struct ShaderManager
+{
+    struct ShaderProgram programs[SHADER_MAX_PROGRAMS];
+    u32 programCount;
+
+    char cacheDirectory[SHADER_PATH_LENGTH];
+    u64 driverHash;
+
+    bool binaryCacheSupported;
+
+    char watchDirectory[SHADER_PATH_LENGTH];
+    int inotifyFd;
+    int watchDescriptor;
+};
+
+// `cacheDirectory` is created if missing. `watchDirectory` is where the
+// source files live; pass NULL to disable hot reload.
+bool ShaderManagerInit(struct ShaderManager *manager, ShaderGetProcAddressFn getProcAddress,
+                       const char *cacheDirectory, const char *watchDirectory);
+void ShaderManagerShutdown(struct ShaderManager *manager);
+
+// Builds a program from the given sources, or from the binary cache when it
+// has a match. The paths name the files in the watched directory to reload it
+// from when they change. Returns SHADER_INVALID_HANDLE if it can't be built.
+u32 ShaderManagerLoad(struct ShaderManager *manager, const char *vertexSource, const char *fragmentSource,
+                      const char *vertexPath, const char *fragmentPath);
+
+// Recompiles programs whose sources changed on disk. A program that fails to
+// build keeps its last good version. Returns true if any program was replaced.
+bool ShaderManagerUpdate(struct ShaderManager *manager);
+
+u32 ShaderManagerProgram(const struct ShaderManager *manager, u32 handle);
+u32 ShaderManagerGeneration(const struct ShaderManager *manager, u32 handle);
+
 #endif // SHADERS_H
@@ -0,0 +1,317 @@
+#include "spatial_hash.h"
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+static u32 NextPowerOfTwo(u32 value)
+{
+    u32 result = 1;
+    while (result < value)
+    {
+        result <<= 1;
+    }
+    return result;
+}
+
+void SpatialHashInit(struct SpatialHash *hash, u32 capacity, f32 cellSize, Allocator *alloc, void *user)
+{
+    // Twice as many buckets as items keeps aliasing cells rare
+    u32 bucketCount = NextPowerOfTwo(capacity < 8 ? 16 : 2 * capacity);
+
+    usize totalSize = (bucketCount + 1) * sizeof(u32) + capacity * (sizeof(u32) + sizeof(struct SpatialEntry));
+
+    memset(hash, 0, sizeof(*hash));
+    hash->cellSize = cellSize;
+    hash->invCellSize = 1.0f / cellSize;
+
+    hash->memory = MemAllocUser(alloc, totalSize, user);
+    if (!hash->memory)
+    {
+        return;
+    }
+
+    // Entries first, where the allocation's alignment is
+    u8 *at = hash->memory;
+    hash->entries = (struct SpatialEntry *)at;
+    at += capacity * sizeof(struct SpatialEntry);
+    hash->bucketOf = (u32 *)at;
+    at += capacity * sizeof(u32);
+    hash->bucketStart = (u32 *)at;
+
+    u32 bucketBits = 0;
+    while ((1u << bucketBits) < bucketCount)
+    {
+        ++bucketBits;
+    }
+
+    hash->capacity = capacity;
+    hash->bucketMask = bucketCount - 1;
+    hash->bucketColumnShift = (bucketBits + 1) / 2;
+    hash->bucketColumnMask = (1u << hash->bucketColumnShift) - 1;
+    memset(hash->bucketStart, 0, (bucketCount + 1) * sizeof(u32));
+}
+
+void SpatialHashFree(struct SpatialHash *hash, Allocator *alloc, void *user)
+{
+    MemFreeUser(alloc, hash->memory, user);
+    memset(hash, 0, sizeof(*hash));
+}
+
+// floorf is a library call without SSE4.1, and this runs several times per item
+static s32 CellOf(const struct SpatialHash *hash, f32 value)
+{
+    f32 scaled = value * hash->invCellSize;
+    s32 truncated = (s32)scaled;
+    return truncated - (scaled < (f32)truncated);
+}
+
+// The grid wraps around a bucketColumns wide table rather than being
+// scrambled, so neighboring cells are neighboring buckets and a sweep in
+// bucket order stays on the same few cache lines. Far apart cells alias,
+// which the cell check in every query sorts out.
+static u32 BucketOf(const struct SpatialHash *hash, s32 cellX, s32 cellY)
+{
+    return ((((u32)cellY << hash->bucketColumnShift) | ((u32)cellX & hash->bucketColumnMask))) & hash->bucketMask;
+}
+
+void SpatialHashBuild(struct SpatialHash *hash, u32 count, const f32 *x, const f32 *y, const f32 *width, const f32 *height)
+{
+    if (count > hash->capacity)
+    {
+        count = hash->capacity;
+    }
+
+    u32 bucketCount = hash->bucketMask + 1;
+    u32 *bucketStart = hash->bucketStart;
+    memset(bucketStart, 0, (bucketCount + 1) * sizeof(u32));
+
+    f32 maxHalfExtent = 0.0f;
+    for (u32 i = 0; i < count; ++i)
+    {
+        u32 bucket = BucketOf(hash, CellOf(hash, x[i]), CellOf(hash, y[i]));
+        hash->bucketOf[i] = bucket;
+        bucketStart[bucket] += 1;
+
+        f32 halfExtent = 0.5f * (width[i] > height[i] ? width[i] : height[i]);
+        maxHalfExtent = halfExtent > maxHalfExtent ? halfExtent : maxHalfExtent;
+    }
+
+    // Running totals make each entry the end of its bucket...
+    for (u32 b = 1; b < bucketCount; ++b)
+    {
+        bucketStart[b] += bucketStart[b - 1];
+    }
+    bucketStart[bucketCount] = count;
+
+    // ...and filling back to front walks it down to the start, keeping
+    // input order within a bucket
+    for (u32 i = count; i > 0; --i)
+    {
+        u32 item = i - 1;
+        u32 slot = --bucketStart[hash->bucketOf[item]];
+        f32 halfWidth = 0.5f * width[item];
+        f32 halfHeight = 0.5f * height[item];
+
+        hash->entries[slot] = (struct SpatialEntry){
+            .minX = x[item] - halfWidth,
+            .minY = y[item] - halfHeight,
+            .maxX = x[item] + halfWidth,
+            .maxY = y[item] + halfHeight,
+            .cellX = CellOf(hash, x[item]),
+            .cellY = CellOf(hash, y[item]),
+            .index = item,
+        };
+    }
+
+    hash->count = count;
+    hash->maxHalfExtent = maxHalfExtent;
+}
+
+u32 SpatialHashOverlapPairs(const struct SpatialHash *hash, struct SpatialPair *pairs, u32 capacity)
+{
+    u32 found = 0;
+    f32 reach = hash->maxHalfExtent;
+
+    // Walking in bucket order keeps the neighbor lookups of consecutive
+    // items on the same few cache lines
+    for (u32 e = 0; e < hash->count; ++e)
+    {
+        const struct SpatialEntry *entry = &hash->entries[e];
+        u32 a = entry->index;
+        f32 minX = entry->minX;
+        f32 minY = entry->minY;
+        f32 maxX = entry->maxX;
+        f32 maxY = entry->maxY;
+
+        s32 firstX = CellOf(hash, minX - reach);
+        s32 lastX = CellOf(hash, maxX + reach);
+        s32 firstY = CellOf(hash, minY - reach);
+        s32 lastY = CellOf(hash, maxY + reach);
+
+        for (s32 cy = firstY; cy <= lastY; ++cy)
+        {
+            for (s32 cx = firstX; cx <= lastX; ++cx)
+            {
+                u32 bucket = BucketOf(hash, cx, cy);
+                for (u32 k = hash->bucketStart[bucket]; k < hash->bucketStart[bucket + 1]; ++k)
+                {
+                    // Other cells can share the bucket; only this one's items
+                    // count, so none is seen twice. Half the candidates pass,
+                    // so the tests are combined without branches and the pair
+                    // is written either way, then kept or overwritten.
+                    const struct SpatialEntry *other = &hash->entries[k];
+                    u32 overlaps = (u32)(other->cellX == cx) & (u32)(other->cellY == cy) & (u32)(other->index > a) &
+                                   (u32)(minX < other->maxX) & (u32)(other->minX < maxX) &
+                                   (u32)(minY < other->maxY) & (u32)(other->minY < maxY);
+                    if (found < capacity)
+                    {
+                        pairs[found] = (struct SpatialPair){a, other->index};
+                    }
+                    found += overlaps;
+                }
+            }
+        }
+    }
+
+    return found;
+}
+
+u32 SpatialHashQueryRadius(const struct SpatialHash *hash, f32 x, f32 y, f32 radius, u32 *results, u32 capacity)
+{
+    u32 found = 0;
+    f32 reach = radius + hash->maxHalfExtent;
+    f32 radiusSquared = radius * radius;
+
+    s32 firstX = CellOf(hash, x - reach);
+    s32 lastX = CellOf(hash, x + reach);
+    s32 firstY = CellOf(hash, y - reach);
+    s32 lastY = CellOf(hash, y + reach);
+
+    for (s32 cy = firstY; cy <= lastY; ++cy)
+    {
+        for (s32 cx = firstX; cx <= lastX; ++cx)
+        {
+            u32 bucket = BucketOf(hash, cx, cy);
+            for (u32 k = hash->bucketStart[bucket]; k < hash->bucketStart[bucket + 1]; ++k)
+            {
+                const struct SpatialEntry *entry = &hash->entries[k];
+                if (entry->cellX != cx || entry->cellY != cy)
+                {
+                    continue;
+                }
+
+                // Distance to the closest point of the box
+                f32 closestX = x < entry->minX ? entry->minX : (x > entry->maxX ? entry->maxX : x);
+                f32 closestY = y < entry->minY ? entry->minY : (y > entry->maxY ? entry->maxY : y);
+                f32 dx = x - closestX;
+                f32 dy = y - closestY;
+                if (dx*dx + dy*dy <= radiusSquared)
+                {
+                    if (found < capacity)
+                    {
+                        results[found] = entry->index;
+                    }
+                    found += 1;
+                }
+            }
+        }
+    }
+
+    return found;
+}
+
+// Slab test; the distance at which the ray enters the box, or -1 for a miss
+static f32 RayBoxDistance(f32 originX, f32 originY, f32 invDirectionX, f32 invDirectionY,
+                          f32 minX, f32 minY, f32 maxX, f32 maxY)
+{
+    f32 tx0 = (minX - originX) * invDirectionX;
+    f32 tx1 = (maxX - originX) * invDirectionX;
+    f32 ty0 = (minY - originY) * invDirectionY;
+    f32 ty1 = (maxY - originY) * invDirectionY;
+
+    f32 enter = fmaxf(fminf(tx0, tx1), fminf(ty0, ty1));
+    f32 exit = fminf(fmaxf(tx0, tx1), fmaxf(ty0, ty1));
+
+    if (exit < 0.0f || enter > exit)
+    {
+        return -1.0f;
+    }
+    return enter > 0.0f ? enter : 0.0f;
+}
+
+bool SpatialHashRaycast(const struct SpatialHash *hash, f32 originX, f32 originY, f32 directionX, f32 directionY,
+                        f32 maxDistance, struct SpatialRayHit *hit)
+{
+    hit->index = SPATIAL_INDEX_INVALID;
+    hit->distance = maxDistance;
+
+    if (directionX == 0.0f && directionY == 0.0f)
+    {
+        return false;
+    }
+
+    // Division by zero gives infinities, which the slab test handles
+    f32 invDirectionX = 1.0f / directionX;
+    f32 invDirectionY = 1.0f / directionY;
+
+    // A box is at most this many cells from the cell holding its center
+    s32 margin = (s32)ceilf(hash->maxHalfExtent * hash->invCellSize);
+
+    // Grid traversal (Amanatides & Woo): step to whichever cell boundary
+    // the ray crosses next
+    s32 cellX = CellOf(hash, originX);
+    s32 cellY = CellOf(hash, originY);
+    s32 stepX = directionX > 0.0f ? 1 : -1;
+    s32 stepY = directionY > 0.0f ? 1 : -1;
+    f32 nextX = directionX != 0.0f
+        ? ((f32)(cellX + (stepX > 0)) * hash->cellSize - originX) * invDirectionX : FLT_MAX;
+    f32 nextY = directionY != 0.0f
+        ? ((f32)(cellY + (stepY > 0)) * hash->cellSize - originY) * invDirectionY : FLT_MAX;
+    f32 deltaX = directionX != 0.0f ? hash->cellSize * fabsf(invDirectionX) : FLT_MAX;
+    f32 deltaY = directionY != 0.0f ? hash->cellSize * fabsf(invDirectionY) : FLT_MAX;
+
+    // A hit at distance t is found in the ray cell holding that point, so
+    // once the ray enters cells beyond the best hit, nothing closer is left
+    f32 enter = 0.0f;
+    while (enter <= hit->distance)
+    {
+        for (s32 cy = cellY - margin; cy <= cellY + margin; ++cy)
+        {
+            for (s32 cx = cellX - margin; cx <= cellX + margin; ++cx)
+            {
+                u32 bucket = BucketOf(hash, cx, cy);
+                for (u32 k = hash->bucketStart[bucket]; k < hash->bucketStart[bucket + 1]; ++k)
+                {
+                    const struct SpatialEntry *entry = &hash->entries[k];
+                    if (entry->cellX != cx || entry->cellY != cy)
+                    {
+                        continue;
+                    }
+
+                    f32 distance = RayBoxDistance(originX, originY, invDirectionX, invDirectionY,
+                                                  entry->minX, entry->minY, entry->maxX, entry->maxY);
+                    if (distance >= 0.0f && distance <= hit->distance)
+                    {
+                        hit->index = entry->index;
+                        hit->distance = distance;
+                    }
+                }
+            }
+        }
+
+        if (nextX < nextY)
+        {
+            enter = nextX;
+            nextX += deltaX;
+            cellX += stepX;
+        }
+        else
+        {
+            enter = nextY;
+            nextY += deltaY;
+            cellY += stepY;
+        }
+    }
+
+    return hit->index != SPATIAL_INDEX_INVALID;
+}
@@ -0,0 +1,98 @@
+#ifndef SPATIAL_HASH_H
+#define SPATIAL_HASH_H
+
+// Uniform grid broadphase over axis aligned boxes. Cells wrap around a fixed
+// table of buckets, so the world needs no bounds. Each item goes into the one
+// cell holding its center; queries widen their search by the largest half
+// extent seen in the build, so boxes that straddle cells are still found.
+//
+// A build is a counting sort: items are counted per bucket, the counts are
+// prefix summed and the items scattered into one array in bucket order,
+// along with copies of their bounds. A bucket is then a contiguous range
+// of that array, everything a query tests about an item is in one place,
+// and nothing is allocated per cell or per build.
+//
+// Items are whatever indices the caller builds from, e.g. EntityStore dense
+// indices. The grid is rebuilt from scratch every tick; with one entry per
+// item, that is linear and cheaper than tracking which items changed cell.
+
+#include "common.h"
+#include "allocator.h"
+
+#define SPATIAL_INDEX_INVALID UINT32_MAX
+
+struct SpatialPair
+{
+    u32 a; // a < b
+    u32 b;
+};
+
+struct SpatialRayHit
+{
+    u32 index;
+    f32 distance; // along the ray, to where it enters the box
+};
+
+// One item as stored in its bucket; two to a cache line
+struct SpatialEntry
+{
+    f32 minX;
+    f32 minY;
+    f32 maxX;
+    f32 maxY;
+    s32 cellX;
+    s32 cellY;
+    u32 index;
+    u32 padding;
+};
+
+struct SpatialHash
+{
+    f32 cellSize;
+    f32 invCellSize;
+    f32 maxHalfExtent; // over the items of the last build
+
+    u32 count;
+    u32 capacity;
+    u32 bucketMask; // bucket count - 1
+    u32 bucketColumnShift;
+    u32 bucketColumnMask;
+
+    // Counts, then start offsets; bucket b is [bucketStart[b], bucketStart[b + 1])
+    u32 *bucketStart;
+
+    // Build input order
+    u32 *bucketOf;
+
+    // Bucket order
+    struct SpatialEntry *entries;
+
+    void *memory;
+};
+
+// `cellSize` is in world units; about twice the typical item size works well
+void SpatialHashInit(struct SpatialHash *hash, u32 capacity, f32 cellSize, Allocator *alloc, void *user);
+void SpatialHashFree(struct SpatialHash *hash, Allocator *alloc, void *user);
+
+// Replaces the contents with `count` boxes centered on (x, y) with full
+// width and height (width, height), as EntityStore keeps them. Items past
+// `capacity` are left out.
+void SpatialHashBuild(struct SpatialHash *hash, u32 count, const f32 *x, const f32 *y, const f32 *width, const f32 *height);
+
+// Every pair of overlapping boxes, once each. Returns the number found;
+// only the first `capacity` are written.
+u32 SpatialHashOverlapPairs(const struct SpatialHash *hash, struct SpatialPair *pairs, u32 capacity);
+
+// Items whose box touches the circle. Returns the number found; only the
+// first `capacity` are written.
+u32 SpatialHashQueryRadius(const struct SpatialHash *hash, f32 x, f32 y, f32 radius, u32 *results, u32 capacity);
+
+// Closest box along the ray from (originX, originY) in direction
+// (directionX, directionY), within `maxDistance` in units of the direction's
+// length. The walk visits every cell up to there, so keep `maxDistance`
+// finite and modest. Returns false, with hit->index SPATIAL_INDEX_INVALID,
+// when nothing is hit.
+bool SpatialHashRaycast(const struct SpatialHash *hash, f32 originX, f32 originY, f32 directionX, f32 directionY,
+                        f32 maxDistance, struct SpatialRayHit *hit);
+
+#endif // SPATIAL_HASH_H
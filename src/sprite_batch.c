@@ -0,0 +1,219 @@
+#include "sprite_batch.h"
+#include <string.h>
+#include <glad/gl.h>
+
+#include "gl_state.h"
+#include "gpu_stream.h"
+
+// Attribute locations, must match the layout qualifiers in sprite_sheet.shader.vert
+enum SpriteAttrib
+{
+    SpriteAttrib_Position = 0,
+    SpriteAttrib_UV = 1,
+    SpriteAttrib_InstancePositionScale = 2,
+    SpriteAttrib_InstanceUVRect = 3,
+    SpriteAttrib_InstanceTint = 4,
+};
+
+struct SpriteVertex
+{
+    f32 pos[3];
+    f32 uv[2];
+};
+
+static const struct SpriteVertex quadVertices[] = {
+    {.pos = {-1.0f,-1.0f,-1.0f}, .uv = {0.0f, 0.0f}},
+    {.pos = { 1.0f,-1.0f,-1.0f}, .uv = {1.0f, 0.0f}},
+    {.pos = { 1.0f, 1.0f,-1.0f}, .uv = {1.0f, 1.0f}},
+    {.pos = { 1.0f, 1.0f,-1.0f}, .uv = {1.0f, 1.0f}},
+    {.pos = {-1.0f, 1.0f,-1.0f}, .uv = {0.0f, 1.0f}},
+    {.pos = {-1.0f,-1.0f,-1.0f}, .uv = {0.0f, 0.0f}},
+};
+
+u32 SpriteCreateQuadBuffer(void)
+{
+    GLuint quadVbo;
+    glGenBuffers(1, &quadVbo);
+    glBindBuffer(GL_ARRAY_BUFFER, quadVbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices, GL_STATIC_DRAW);
+    return quadVbo;
+}
+
+u32 SpriteCreateVertexArray(u32 quadVbo, u32 instanceVbo)
+{
+    GLuint vao;
+    glGenVertexArrays(1, &vao);
+    GLStateBindVertexArray(vao);
+
+    // Shared unit quad, one vertex per corner
+    glBindBuffer(GL_ARRAY_BUFFER, quadVbo);
+
+    glVertexAttribPointer(SpriteAttrib_Position, 3, GL_FLOAT, GL_FALSE, sizeof(*quadVertices), (void *)OFFSET_OF(struct SpriteVertex, pos));
+    glEnableVertexAttribArray(SpriteAttrib_Position);
+
+    glVertexAttribPointer(SpriteAttrib_UV, 2, GL_FLOAT, GL_FALSE, sizeof(*quadVertices), (void *)OFFSET_OF(struct SpriteVertex, uv));
+    glEnableVertexAttribArray(SpriteAttrib_UV);
+
+    // Per-instance attributes, advanced once per sprite
+    SpriteSetInstanceBuffer(instanceVbo, 0);
+
+    glEnableVertexAttribArray(SpriteAttrib_InstancePositionScale);
+    glVertexAttribDivisor(SpriteAttrib_InstancePositionScale, 1);
+    glEnableVertexAttribArray(SpriteAttrib_InstanceUVRect);
+    glVertexAttribDivisor(SpriteAttrib_InstanceUVRect, 1);
+    glEnableVertexAttribArray(SpriteAttrib_InstanceTint);
+    glVertexAttribDivisor(SpriteAttrib_InstanceTint, 1);
+
+    GLStateBindVertexArray(0);
+    return vao;
+}
+
+void SpriteSetInstanceBuffer(u32 instanceVbo, usize offset)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+
+    const GLsizei stride = sizeof(struct SpriteInstance);
+    glVertexAttribPointer(SpriteAttrib_InstancePositionScale, 4, GL_FLOAT, GL_FALSE, stride, (void *)(offset + OFFSET_OF(struct SpriteInstance, position)));
+    glVertexAttribPointer(SpriteAttrib_InstanceUVRect, 4, GL_FLOAT, GL_FALSE, stride, (void *)(offset + OFFSET_OF(struct SpriteInstance, uv)));
+    glVertexAttribPointer(SpriteAttrib_InstanceTint, 4, GL_FLOAT, GL_FALSE, stride, (void *)(offset + OFFSET_OF(struct SpriteInstance, tint)));
+}
+
+void SpriteBatchInit(struct SpriteBatch *batch, u32 capacity, Allocator *alloc, void *user)
+{
+    batch->instances = MemAllocUser(alloc, capacity * sizeof(*batch->instances), user);
+    batch->count = 0;
+    batch->capacity = capacity;
+    batch->texture = 0;
+    batch->drawCalls = 0;
+    batch->stream = NULL;
+    batch->write = NULL;
+
+    batch->quadVbo = SpriteCreateQuadBuffer();
+
+    glGenBuffers(1, &batch->instanceVbo);
+    glBindBuffer(GL_ARRAY_BUFFER, batch->instanceVbo);
+    glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(*batch->instances), NULL, GL_STREAM_DRAW);
+
+    batch->vao = SpriteCreateVertexArray(batch->quadVbo, batch->instanceVbo);
+}
+
+void SpriteBatchFree(struct SpriteBatch *batch, Allocator *alloc, void *user)
+{
+    glDeleteVertexArrays(1, &batch->vao);
+    glDeleteBuffers(1, &batch->quadVbo);
+    glDeleteBuffers(1, &batch->instanceVbo);
+
+    MemFreeUser(alloc, batch->instances, user);
+    batch->instances = NULL;
+    batch->count = 0;
+    batch->capacity = 0;
+}
+
+void SpriteBatchBegin(struct SpriteBatch *batch, u32 texture)
+{
+    if (batch->texture != texture)
+    {
+        SpriteBatchFlush(batch);
+        batch->texture = texture;
+    }
+}
+
+// Picks where the next run of sprites is written: straight into the stream
+// buffer when there is room, else into our own array
+static void BeginWrite(struct SpriteBatch *batch)
+{
+    if (batch->stream)
+    {
+        batch->write = GpuStreamMap(batch->stream, batch->capacity * sizeof(*batch->instances),
+                                    SPRITE_BATCH_STREAM_ALIGNMENT, &batch->streamOffset);
+    }
+    if (!batch->write)
+    {
+        batch->write = batch->instances;
+    }
+}
+
+void SpriteBatchPush(struct SpriteBatch *batch, const struct SpriteInstance *sprite)
+{
+    if (batch->count == batch->capacity)
+    {
+        SpriteBatchFlush(batch);
+    }
+    if (!batch->write)
+    {
+        BeginWrite(batch);
+    }
+
+    batch->write[batch->count++] = *sprite;
+}
+
+void SpriteBatchFlush(struct SpriteBatch *batch)
+{
+    bool streamed = batch->write && batch->write != batch->instances;
+    if (streamed)
+    {
+        GpuStreamUnmap(batch->stream, batch->count * sizeof(*batch->instances));
+    }
+    batch->write = NULL;
+
+    if (batch->count == 0)
+    {
+        return;
+    }
+
+    GLStateBindTexture(batch->texture);
+    GLStateBindVertexArray(batch->vao);
+
+    if (streamed)
+    {
+        SpriteSetInstanceBuffer(batch->stream->buffer, batch->streamOffset);
+    }
+    else
+    {
+        // Orphan the previous storage so the driver doesn't have to wait for
+        // last frame's draw to finish reading it
+        SpriteSetInstanceBuffer(batch->instanceVbo, 0);
+        glBufferData(GL_ARRAY_BUFFER, batch->capacity * sizeof(*batch->instances), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, batch->count * sizeof(*batch->instances), batch->instances);
+    }
+
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 6, batch->count);
+    GLStateCountDraw();
+    batch->drawCalls += 1;
+
+    batch->count = 0;
+}
+
+void SpriteBatchDrawRun(struct SpriteBatch *batch, u32 texture, const struct SpriteInstance *sprites, u32 count)
+{
+    SpriteBatchFlush(batch);
+    if (count == 0)
+    {
+        return;
+    }
+
+    usize size = count * sizeof(*sprites);
+    usize offset = 0;
+    void *write = batch->stream ? GpuStreamMap(batch->stream, size, SPRITE_BATCH_STREAM_ALIGNMENT, &offset) : NULL;
+    if (!write)
+    {
+        SpriteBatchBegin(batch, texture);
+        for (u32 i = 0; i < count; ++i)
+        {
+            SpriteBatchPush(batch, &sprites[i]);
+        }
+        SpriteBatchFlush(batch);
+        return;
+    }
+
+    memcpy(write, sprites, size);
+    GpuStreamUnmap(batch->stream, size);
+
+    GLStateBindTexture(texture);
+    GLStateBindVertexArray(batch->vao);
+    SpriteSetInstanceBuffer(batch->stream->buffer, offset);
+
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 6, count);
+    GLStateCountDraw();
+    batch->drawCalls += 1;
+}
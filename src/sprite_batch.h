@@ -0,0 +1,65 @@
+#ifndef SPRITE_BATCH_H
+#define SPRITE_BATCH_H
+
+#include "common.h"
+#include "allocator.h"
+
+#define SPRITE_BATCH_STREAM_ALIGNMENT 64
+
+struct GpuStreamBuffer;
+
+// Per-instance data, laid out exactly as the sprite sheet vertex shader reads it.
+struct SpriteInstance
+{
+    f32 position[3];
+    f32 scale;
+    f32 uv[4]; // atlas rect: minU, minV, maxU, maxV
+    f32 tint[4];
+};
+
+struct SpriteBatch
+{
+    struct SpriteInstance *instances;
+    u32 count;
+    u32 capacity;
+
+    u32 texture;
+
+    u32 vao;
+    u32 quadVbo;
+    u32 instanceVbo;
+
+    u32 drawCalls; // since the caller last reset it
+
+    // Optional. When set, sprites are written straight into the stream
+    // buffer; `instances` is only used when the frame's region is full.
+    struct GpuStreamBuffer *stream;
+    struct SpriteInstance *write; // where Push writes, NULL between flushes
+    usize streamOffset;
+};
+
+// Unit quad the sprite sheet shader expands every instance from
+u32 SpriteCreateQuadBuffer(void);
+// Vertex array reading the quad from `quadVbo` and one SpriteInstance per
+// instance from `instanceVbo`
+u32 SpriteCreateVertexArray(u32 quadVbo, u32 instanceVbo);
+// Points the bound vertex array's instance attributes at `offset` in `instanceVbo`
+void SpriteSetInstanceBuffer(u32 instanceVbo, usize offset);
+
+void SpriteBatchInit(struct SpriteBatch *batch, u32 capacity, Allocator *alloc, void *user);
+void SpriteBatchFree(struct SpriteBatch *batch, Allocator *alloc, void *user);
+
+// Starts collecting sprites drawn with `texture`. Anything still pending for a
+// different texture is flushed first.
+void SpriteBatchBegin(struct SpriteBatch *batch, u32 texture);
+void SpriteBatchPush(struct SpriteBatch *batch, const struct SpriteInstance *sprite);
+
+// Uploads the pending instances and draws them with one instanced call.
+// Expects the sprite sheet shader program to be bound.
+void SpriteBatchFlush(struct SpriteBatch *batch);
+
+// Flushes, then draws `count` prebuilt instances with a single call when
+// the stream buffer has room for all of them, else in batch-sized pieces
+void SpriteBatchDrawRun(struct SpriteBatch *batch, u32 texture, const struct SpriteInstance *sprites, u32 count);
+
+#endif // SPRITE_BATCH_H
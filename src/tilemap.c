@@ -0,0 +1,169 @@
+#include "tilemap.h"
+#include <math.h>
+#include <glad/gl.h>
+
+void TilemapInit(struct Tilemap *map, u32 width, u32 height, f32 tileSize, Allocator *alloc, void *user)
+{
+    map->width = width;
+    map->height = height;
+    map->tiles = MemZeroAllocUser(alloc, (usize)width * height * sizeof(*map->tiles), user);
+
+    map->chunksX = (width + TILEMAP_CHUNK_SIZE - 1) / TILEMAP_CHUNK_SIZE;
+    map->chunksY = (height + TILEMAP_CHUNK_SIZE - 1) / TILEMAP_CHUNK_SIZE;
+    map->chunks = MemZeroAllocUser(alloc, (usize)map->chunksX * map->chunksY * sizeof(*map->chunks), user);
+    for (u32 i = 0; i < map->chunksX * map->chunksY; ++i)
+    {
+        map->chunks[i].dirty = true;
+    }
+
+    map->originX = 0.0f;
+    map->originY = 0.0f;
+    map->depth = -1.0f;
+    map->tileSize = tileSize;
+    map->palette = NULL;
+
+    map->quadVbo = SpriteCreateQuadBuffer();
+    map->bakeScratch = MemAllocUser(alloc, TILEMAP_CHUNK_SIZE * TILEMAP_CHUNK_SIZE * sizeof(*map->bakeScratch), user);
+    map->drawCalls = 0;
+}
+
+void TilemapFree(struct Tilemap *map, Allocator *alloc, void *user)
+{
+    for (u32 i = 0; i < map->chunksX * map->chunksY; ++i)
+    {
+        struct TilemapChunk *chunk = &map->chunks[i];
+        if (chunk->vao)
+        {
+            glDeleteVertexArrays(1, &chunk->vao);
+            glDeleteBuffers(1, &chunk->instanceVbo);
+        }
+    }
+    glDeleteBuffers(1, &map->quadVbo);
+
+    MemFreeUser(alloc, map->tiles, user);
+    MemFreeUser(alloc, map->chunks, user);
+    MemFreeUser(alloc, map->bakeScratch, user);
+    map->tiles = NULL;
+    map->chunks = NULL;
+    map->bakeScratch = NULL;
+    map->chunksX = 0;
+    map->chunksY = 0;
+}
+
+Tile TilemapGet(const struct Tilemap *map, u32 x, u32 y)
+{
+    if (x >= map->width || y >= map->height)
+    {
+        return TILEMAP_EMPTY;
+    }
+    return map->tiles[(usize)y * map->width + x];
+}
+
+void TilemapSet(struct Tilemap *map, u32 x, u32 y, Tile tile)
+{
+    if (x >= map->width || y >= map->height)
+    {
+        return;
+    }
+
+    Tile *slot = &map->tiles[(usize)y * map->width + x];
+    if (*slot != tile)
+    {
+        *slot = tile;
+        map->chunks[(y / TILEMAP_CHUNK_SIZE) * map->chunksX + x / TILEMAP_CHUNK_SIZE].dirty = true;
+    }
+}
+
+static void BakeChunk(struct Tilemap *map, u32 chunkX, u32 chunkY, struct TilemapChunk *chunk)
+{
+    u32 startX = chunkX * TILEMAP_CHUNK_SIZE;
+    u32 startY = chunkY * TILEMAP_CHUNK_SIZE;
+    u32 endX = startX + TILEMAP_CHUNK_SIZE < map->width ? startX + TILEMAP_CHUNK_SIZE : map->width;
+    u32 endY = startY + TILEMAP_CHUNK_SIZE < map->height ? startY + TILEMAP_CHUNK_SIZE : map->height;
+
+    // The sprite quad spans [-1, 1], so half a tile of scale covers one tile
+    f32 halfTile = 0.5f*map->tileSize;
+
+    u32 count = 0;
+    for (u32 y = startY; y < endY; ++y)
+    {
+        for (u32 x = startX; x < endX; ++x)
+        {
+            Tile tile = map->tiles[(usize)y * map->width + x];
+            if (tile == TILEMAP_EMPTY)
+            {
+                continue;
+            }
+
+            const f32 *uv = map->palette[tile - 1u].uv;
+            map->bakeScratch[count++] = (struct SpriteInstance){
+                .position = {map->originX + (f32)x*map->tileSize + halfTile, map->originY + (f32)y*map->tileSize + halfTile, map->depth},
+                .scale = halfTile,
+                .uv = {uv[0], uv[1], uv[2], uv[3]},
+                .tint = {1.0f, 1.0f, 1.0f, 1.0f},
+            };
+        }
+    }
+
+    if (!chunk->vao && count > 0)
+    {
+        glGenBuffers(1, &chunk->instanceVbo);
+        chunk->vao = SpriteCreateVertexArray(map->quadVbo, chunk->instanceVbo);
+    }
+
+    if (chunk->vao)
+    {
+        // Edits are rare, so reallocating the whole buffer is fine
+        glBindBuffer(GL_ARRAY_BUFFER, chunk->instanceVbo);
+        glBufferData(GL_ARRAY_BUFFER, count * sizeof(*map->bakeScratch), count ? map->bakeScratch : NULL, GL_STATIC_DRAW);
+    }
+
+    chunk->instanceCount = count;
+    chunk->dirty = false;
+}
+
+// Range of chunks along one axis overlapping [min, max] in world space
+static void VisibleChunkRange(f32 min, f32 max, f32 origin, f32 chunkExtent, u32 chunkCount, u32 *first, u32 *end)
+{
+    f32 firstChunk = floorf((min - origin) / chunkExtent);
+    f32 lastChunk = floorf((max - origin) / chunkExtent);
+
+    *first = firstChunk <= 0.0f ? 0 : (firstChunk >= (f32)chunkCount ? chunkCount : (u32)firstChunk);
+    *end = lastChunk < 0.0f ? 0 : (lastChunk >= (f32)chunkCount ? chunkCount : (u32)lastChunk + 1);
+}
+
+void TilemapSubmit(struct Tilemap *map, struct RenderQueue *queue, u64 key, u32 program, u32 texture,
+                   f32 minX, f32 minY, f32 maxX, f32 maxY)
+{
+    f32 chunkExtent = map->tileSize * TILEMAP_CHUNK_SIZE;
+
+    u32 firstX, endX, firstY, endY;
+    VisibleChunkRange(minX, maxX, map->originX, chunkExtent, map->chunksX, &firstX, &endX);
+    VisibleChunkRange(minY, maxY, map->originY, chunkExtent, map->chunksY, &firstY, &endY);
+
+    for (u32 chunkY = firstY; chunkY < endY; ++chunkY)
+    {
+        for (u32 chunkX = firstX; chunkX < endX; ++chunkX)
+        {
+            struct TilemapChunk *chunk = &map->chunks[chunkY * map->chunksX + chunkX];
+            if (chunk->dirty)
+            {
+                BakeChunk(map, chunkX, chunkY, chunk);
+            }
+
+            if (chunk->instanceCount > 0)
+            {
+                struct RenderCommand command = {
+                    .kind = RenderCommand_Instanced,
+                    .program = program,
+                    .texture = texture,
+                    .instanced = {chunk->vao, chunk->instanceCount},
+                };
+                if (RenderQueuePush(queue, key, &command))
+                {
+                    map->drawCalls += 1;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef TILEMAP_H
+#define TILEMAP_H
+
+#include "common.h"
+#include "allocator.h"
+#include "atlas.h"
+#include "sprite_batch.h"
+#include "render_queue.h"
+
+// Tiles per chunk side
+#define TILEMAP_CHUNK_SIZE 32
+#define TILEMAP_EMPTY 0
+
+// Tiles are 1 + an index into the map's palette, 0 is empty
+typedef u8 Tile;
+
+// Each chunk's non-empty tiles are baked once into a static instance buffer
+// and drawn with a single instanced call of the sprite sheet shader.
+struct TilemapChunk
+{
+    u32 vao;
+    u32 instanceVbo;
+    u32 instanceCount;
+    bool dirty; // tiles changed since the last bake
+};
+
+struct Tilemap
+{
+    Tile *tiles; // row-major, width * height
+    u32 width;
+    u32 height;
+
+    struct TilemapChunk *chunks;
+    u32 chunksX;
+    u32 chunksY;
+
+    // World position of tile (0, 0)'s lower left corner, and tile side length
+    f32 originX;
+    f32 originY;
+    f32 depth;
+    f32 tileSize;
+
+    // Atlas rects tile 1, 2, ... draw with. Set before the first submit.
+    const struct AtlasRect *palette;
+
+    u32 quadVbo;
+    struct SpriteInstance *bakeScratch;
+    u32 drawCalls; // chunks submitted since the caller last reset it
+};
+
+void TilemapInit(struct Tilemap *map, u32 width, u32 height, f32 tileSize, Allocator *alloc, void *user);
+void TilemapFree(struct Tilemap *map, Allocator *alloc, void *user);
+
+Tile TilemapGet(const struct Tilemap *map, u32 x, u32 y);
+// Marks the tile's chunk for rebaking the next time it's drawn
+void TilemapSet(struct Tilemap *map, u32 x, u32 y, Tile tile);
+
+// Queues a draw for each chunk overlapping the world rectangle
+// [minX, maxX] x [minY, maxY]. Chunks are baked lazily, so chunks that are
+// never seen never get a buffer. `program` is a RenderQueue program slot.
+void TilemapSubmit(struct Tilemap *map, struct RenderQueue *queue, u64 key, u32 program, u32 texture,
+                   f32 minX, f32 minY, f32 maxX, f32 maxY);
+
+#endif // TILEMAP_H